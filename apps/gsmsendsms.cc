@@ -44,6 +44,7 @@ static struct option longOpts[] =
   {"concatenate", required_argument, (int*)NULL, 'c'},
   {"baudrate", required_argument, (int*)NULL, 'b'},
   {"test", no_argument, (int*)NULL, 't'},
+  {"utf8", no_argument, (int*)NULL, 'u'},
   {"help", no_argument, (int*)NULL, 'h'},
   {"version", no_argument, (int*)NULL, 'v'},
   {(char*)NULL, 0, (int*)NULL, 0}
@@ -101,6 +102,7 @@ int main(int argc, char *argv[])
     std::string initString = gsmlib::DEFAULT_INIT_STRING;
     bool swHandshake = false;
     bool requestStatusReport = false;
+    bool utf8 = false;
     // service centre address (set on command line)
     std::string serviceCentreAddress;
     gsmlib::MeTa *m = NULL;
@@ -109,7 +111,7 @@ int main(int argc, char *argv[])
 
     int opt;
     int dummy = 0;
-    while((opt = getopt_long(argc, argv, "c:C:I:d:b:thvXr", longOpts, &dummy))
+    while((opt = getopt_long(argc, argv, "c:C:I:d:b:thuvXr", longOpts, &dummy))
           != -1)
       switch (opt)
       {
@@ -137,6 +139,9 @@ int main(int argc, char *argv[])
       case 'r':
         requestStatusReport = true;
         break;
+      case 'u':
+        utf8 = true;
+        break;
       case 'v':
 	std::cerr << argv[0] << gsmlib::stringPrintf(_(": version %s [compiled %s]"),
 						     VERSION, __DATE__) << std::endl;
@@ -145,7 +150,7 @@ int main(int argc, char *argv[])
       case 'h':
 	std::cerr << argv[0] << _(": [-b baudrate][-c concatenatedID]"
                              "[-C sca][-d device][-h][-I init string]\n"
-                             "  [-t][-v][-X] phonenumber [text]") << std::endl
+                             "  [-t][-u][-v][-X] phonenumber [text]") << std::endl
              << std::endl
              << _("  -b, --baudrate    baudrate to use for device "
                   "(default: 38400)")
@@ -161,6 +166,8 @@ int main(int argc, char *argv[])
              << _("  -t, --test        convert text to GSM alphabet and "
                   "vice\n"
                   "                    versa, no SMS message is sent") << std::endl
+             << _("  -u, --utf8        text is UTF-8, choose alphabet with "
+                  "fewest SMSs") << std::endl
              << _("  -v, --version     prints version and exits")
              << std::endl
              << _("  -X, --xonxoff     switch on software handshake") << std::endl
@@ -219,14 +226,32 @@ int main(int argc, char *argv[])
       char s[1000];
       std::cin.get(s, 1000);
       text = unescapeString(s);
-      if (text.length() > 160)
+      if (! utf8 && text.length() > 160)
         throw gsmlib::GsmException(_("text is larger than 160 characters"),
 				   gsmlib::ParameterError);
     }
     else
       text = argv[optind + 1];
 
-    if (test)
+    // choose alphabet and split UTF-8 text
+    gsmlib::SMSTextSegments segments;
+    if (utf8)
+    {
+      // IDs beyond 255 need a 16-bit reference
+      segments = gsmlib::segmentSMSText(text, concatenatedMessageId != -1,
+                                        true, false,
+                                        concatenatedMessageId > 255);
+      if (concatenatedMessageId == -1 && segments.size() > 1)
+        throw gsmlib::GsmException(_("text does not fit into one SMS"),
+                                   gsmlib::ParameterError);
+    }
+
+    if (test && utf8)
+      std::cout << gsmlib::stringPrintf(_("%d SMS, %s"), segments.size(),
+                                        gsmlib::DataCodingScheme(
+                                          segments._alphabet).toString().c_str())
+                << std::endl;
+    else if (test)
       std::cout << gsmlib::gsmToLatin1(gsmlib::latin1ToGsm(text)) << std::endl;
     else
     {
@@ -247,7 +272,9 @@ int main(int argc, char *argv[])
       submitSMS->setStatusReportRequest(requestStatusReport);
       gsmlib::Address destAddr(phoneNumber);
       submitSMS->setDestinationAddress(destAddr);
-      if (concatenatedMessageId == -1)
+      if (utf8)
+        m->sendSMSs(submitSMS, segments, concatenatedMessageId);
+      else if (concatenatedMessageId == -1)
         m->sendSMSs(submitSMS, text, true);
       else
         m->sendSMSs(submitSMS, text, false, concatenatedMessageId);
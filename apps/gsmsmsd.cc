@@ -40,7 +40,12 @@
 #include <iostream>
 #include <gsmlib/gsm_me_ta.h>
 #include <gsmlib/gsm_event.h>
+#include <gsmlib/gsm_sms_reassembly.h>
+#include <gsmlib/gsm_cb_aggregator.h>
 #include <cstring>
+#include <algorithm>
+#include <map>
+#include <time.h>
 
 #ifdef HAVE_GETOPT_LONG
 static struct option longOpts[] =
@@ -61,6 +66,9 @@ static struct option longOpts[] =
   {"sca", required_argument, (int*)NULL, 'C'},
   {"flush", no_argument, (int*)NULL, 'f'},
   {"concatenate", required_argument, (int*)NULL, 'c'},
+  {"reassemble", required_argument, (int*)NULL, 'R'},
+  {"broadcast", required_argument, (int*)NULL, 'B'},
+  {"channels", required_argument, (int*)NULL, 'M'},
   {"action", required_argument, (int*)NULL, 'a'},
   {"baudrate", required_argument, (int*)NULL, 'b'},
   {"help", no_argument, (int*)NULL, 'h'},
@@ -81,9 +89,17 @@ std::string receiveStoreName;        // store name for received SMSs
 
 static std::string serviceCentreAddress;
 
-// ID if concatenated messages should be sent
+// reference numbers if concatenated messages should be sent
 
-static int concatenatedMessageId = -1;
+static gsmlib::SMSReferenceAllocator *references = NULL;
+
+// collects parts of incoming concatenated SMSs (if enabled)
+
+static gsmlib::SMSReassembler *reassembler = NULL;
+
+// collects pages of incoming CB messages and drops repeats (if enabled)
+
+static gsmlib::CBAggregator *cbAggregator = NULL;
 
 // signal handler for terminate signal
 
@@ -158,6 +174,87 @@ void EventHandler::SMSReceptionIndication(std::string storeName, unsigned int in
   newMessages.push_back(m);
 }
 
+// wait for further reception indications while a burst of SMSs comes
+// in, until no indication arrives for a second or maxSeconds have passed
+
+void waitForIndications(int maxSeconds)
+{
+  time_t start = time(NULL);
+  while (time(NULL) - start < maxSeconds)
+  {
+    unsigned int pending = newMessages.size();
+#ifdef WIN32
+    ::timeval timeoutVal;
+    timeoutVal.tv_sec = 1;
+    timeoutVal.tv_usec = 0;
+    me->waitEvent((gsmlib::GsmTime)&timeoutVal);
+#else
+    struct timeval timeoutVal;
+    timeoutVal.tv_sec = 1;
+    timeoutVal.tv_usec = 0;
+    me->waitEvent(&timeoutVal);
+#endif
+    if (newMessages.size() == pending)
+      break;
+  }
+}
+
+// read the SMSs of several reception indications for the same store with
+// one +CMGL and erase them together (one +CMGD if the ME supports it)
+// indications that could not be handled this way are left in newMessages
+// to be read one by one
+
+void readIndicatedMessages()
+{
+  std::map<std::string, std::vector<int> > indications;
+  std::vector<int> duplicates;
+  for (unsigned int i = 0; i < newMessages.size(); ++i)
+    if (newMessages[i]._index >= 0 &&
+        newMessages[i]._messageType != gsmlib::GsmEvent::CellBroadcastSMS)
+      indications[newMessages[i]._storeName].push_back(i);
+
+  for (std::map<std::string, std::vector<int> >::iterator s =
+         indications.begin(); s != indications.end(); ++s)
+  {
+    if (s->second.size() < 2)
+      continue;
+    gsmlib::SMSStoreRef store = me->getSMSStore(s->first);
+    std::vector<int> listed;
+    try
+    {
+      listed = store->readAll();
+    }
+    catch (gsmlib::GsmException &)
+    {
+      continue;
+    }
+    store->setCaching(true);
+    std::sort(listed.begin(), listed.end());
+
+    std::vector<int> read;
+    for (std::vector<int>::iterator i = s->second.begin();
+         i != s->second.end(); ++i)
+    {
+      IncomingMessage &m = newMessages[*i];
+      if (std::find(read.begin(), read.end(), m._index) != read.end())
+        duplicates.push_back(*i);
+      else if (std::binary_search(listed.begin(), listed.end(), m._index))
+      {
+        m._newSMSMessage = (*store.getptr())[m._index].message();
+        read.push_back(m._index);
+      }
+    }
+    store->setCaching(false);
+    store->erase(read);
+  }
+
+  // drop repeated indications for the same entry
+  std::sort(duplicates.begin(), duplicates.end());
+  for (std::vector<int>::reverse_iterator i = duplicates.rbegin();
+       i != duplicates.rend(); ++i)
+    newMessages.erase(newMessages.begin() + *i);
+}
+
 // execute action on std::string
 
 void doAction(std::string action, std::string result)
@@ -179,6 +276,32 @@ void doAction(std::string action, std::string result)
     std::cout << result << std::endl;
 }
 
+// execute action on all messages the reassembler has ready
+
+void doReassembledAction(std::string action)
+{
+  gsmlib::ReassembledSMS m;
+  while (reassembler->next(m))
+  {
+    std::string result = _("Type of message: SMS message\n");
+    if (m._parts.size() == 1)
+      result += m.firstPart()->toString();
+    else
+      result += m.toString();
+    doAction(action, result);
+  }
+}
+
+// execute action on all CB messages the aggregator has ready
+
+void doAggregatedCBAction(std::string action)
+{
+  gsmlib::ReassembledCBM m;
+  while (cbAggregator->next(m))
+    doAction(action, _("Type of message: cell broadcast message\n") +
+             m.toString());
+}
+
 // send all SMS messages in spool dir
 
 bool requestStatusReport = false;
@@ -216,137 +339,172 @@ void sendSMS(std::string spoolDirBase, std::string sentDirBase, std::string fail
 				 gsmlib::OSError);
 #endif
 
+    // keep the link to the SMSC open while the spool directory is
+    // being emptied, started with the first message to send
+    bool smsBurst = false;
+
+    try
+    {
 #ifdef WIN32
-    while (moreFiles)
-	{
-      if (strcmp(fileInfo.name, ".") != 0 &&
-          strcmp(fileInfo.name, "..") != 0)
+      while (moreFiles)
+          {
+        if (strcmp(fileInfo.name, ".") != 0 &&
+            strcmp(fileInfo.name, "..") != 0)
 #else
-    struct dirent *entry;
-    while ((entry = readdir(dir)) != (struct dirent*)NULL)
-      if (strcmp(entry->d_name, ".") != 0 &&
-          strcmp(entry->d_name, "..") != 0)
+      struct dirent *entry;
+      while ((entry = readdir(dir)) != (struct dirent*)NULL)
+        if (strcmp(entry->d_name, ".") != 0 &&
+            strcmp(entry->d_name, "..") != 0)
 #endif
-      {
-        if ( priority > 1 )
-          sendSMS(spoolDirBase, sentDirBase, failedDirBase, priority-1, enableSyslog, at);
-        // read in file
-        // the first line is interpreted as the phone number
-        // the rest is the message
+        {
+          if ( priority > 1 )
+            sendSMS(spoolDirBase, sentDirBase, failedDirBase, priority-1, enableSyslog, at);
+          // read in file
+          // the first line is interpreted as the phone number
+          // the rest is the message
 #ifdef WIN32
-        std::string filename = spoolDir + "\\" + fileInfo.name;
+          std::string filename = spoolDir + "\\" + fileInfo.name;
 #else
-        std::string filename = spoolDir + "/" + entry->d_name;
+          std::string filename = spoolDir + "/" + entry->d_name;
 #endif
-	std::ifstream ifs(filename.c_str());
-        if (! ifs)
-	  {
+          std::ifstream ifs(filename.c_str());
+          if (! ifs)
+            {
 #ifndef WIN32
-	    if (enableSyslog)
-	      {
-		syslog(LOG_WARNING, "Could not open SMS spool file %s",
-		       filename.c_str());
-		if (failedDirBase != "") {
-		  std::string failedfilename = failedDir + "/" + entry->d_name;
-		  rename(filename.c_str(),failedfilename.c_str());
-		}
-		continue;
-	      }
-	    else
+              if (enableSyslog)
+                {
+                  syslog(LOG_WARNING, "Could not open SMS spool file %s",
+                         filename.c_str());
+                  if (failedDirBase != "") {
+                    std::string failedfilename = failedDir + "/" + entry->d_name;
+                    rename(filename.c_str(),failedfilename.c_str());
+                  }
+                  continue;
+                }
+              else
 #endif
-	      throw gsmlib::GsmException(
-					 gsmlib::stringPrintf(_("count not open SMS spool file %s"),
-							      filename.c_str()), gsmlib::ParameterError);
-	  }
-        char phoneBuf[1001];
-        ifs.getline(phoneBuf, 1000);
-        for (int i=0;i<1000;i++)
-          if (phoneBuf[i]=='\t' || phoneBuf[i]==0)
-          { // ignore everything after a <TAB> in the phone number
-            phoneBuf[i]=0;
-            break;
+                throw gsmlib::GsmException(
+                                           gsmlib::stringPrintf(_("count not open SMS spool file %s"),
+                                                                filename.c_str()), gsmlib::ParameterError);
+            }
+          char phoneBuf[1001];
+          ifs.getline(phoneBuf, 1000);
+          for (int i=0;i<1000;i++)
+            if (phoneBuf[i]=='\t' || phoneBuf[i]==0)
+            { // ignore everything after a <TAB> in the phone number
+              phoneBuf[i]=0;
+              break;
+            }
+          std::string text;
+          while (!ifs.eof())
+          {
+            char c;
+            ifs.get(c);
+            text += c;
           }
-        std::string text;
-        while (!ifs.eof())
-        {
-          char c;
-          ifs.get(c);
-          text += c;
-        }
-        ifs.close();
+          ifs.close();
         
-        // remove trailing newline/linefeed
-        while (text[text.length() - 1] == '\n' ||
-               text[text.length() - 1] == '\r')
-          text = text.substr(0, text.length() - 1);
-
-        // send the message
-        std::string phoneNumber(phoneBuf);
-	gsmlib::Ref<gsmlib::SMSSubmitMessage> submitSMS = new gsmlib::SMSSubmitMessage();
-        // set service centre address in new submit PDU if requested by user
-        if (serviceCentreAddress != "")
-        {
-	  gsmlib::Address sca(serviceCentreAddress);
-          submitSMS->setServiceCentreAddress(sca);
-        }
-        submitSMS->setStatusReportRequest(requestStatusReport);
-	gsmlib::Address destAddr(phoneNumber);
-        submitSMS->setDestinationAddress(destAddr);
-        try
-        {
-          if (concatenatedMessageId == -1)
-            me->sendSMSs(submitSMS, text, true);
-          else
+          // remove trailing newline/linefeed
+          while (text[text.length() - 1] == '\n' ||
+                 text[text.length() - 1] == '\r')
+            text = text.substr(0, text.length() - 1);
+
+          // send the message
+          std::string phoneNumber(phoneBuf);
+          gsmlib::Ref<gsmlib::SMSSubmitMessage> submitSMS = new gsmlib::SMSSubmitMessage();
+          // set service centre address in new submit PDU if requested by user
+          if (serviceCentreAddress != "")
           {
-            // maximum for concatenatedMessageId is 255
-            if (concatenatedMessageId > 256)
-              concatenatedMessageId = 0;
-            me->sendSMSs(submitSMS, text, false, concatenatedMessageId++);
+            gsmlib::Address sca(serviceCentreAddress);
+            submitSMS->setServiceCentreAddress(sca);
           }
+          submitSMS->setStatusReportRequest(requestStatusReport);
+          gsmlib::Address destAddr(phoneNumber);
+          submitSMS->setDestinationAddress(destAddr);
+          try
+          {
+            if (! smsBurst)
+            {
+              me->beginSMSBurst(true);
+              smsBurst = true;
+            }
+            if (references == NULL)
+              me->sendSMSs(submitSMS, text, true);
+            else
+            {
+              // 16-bit references, counted per destination
+              gsmlib::SMSTextSegments segments =
+                gsmlib::segmentSMSUserData(
+                  text, submitSMS->dataCodingScheme().getAlphabet(),
+                  true, references->sixteenBit());
+              me->sendSMSs(submitSMS, segments, segments.size() > 1 ?
+                           (int)references->next(destAddr) : -1);
+            }
 #ifndef WIN32
-          if (enableSyslog)
-            syslog(LOG_NOTICE, "Sent SMS to %s from file %s", phoneBuf, filename.c_str());
+            if (enableSyslog)
+              syslog(LOG_NOTICE, "Sent SMS to %s from file %s", phoneBuf, filename.c_str());
 #endif
-          if (sentDirBase != "") {
+            if (sentDirBase != "") {
 #ifdef WIN32
-          std::string sentfilename = sentDir + "\\" + fileInfo.name;
+            std::string sentfilename = sentDir + "\\" + fileInfo.name;
 #else
-          std::string sentfilename = sentDir + "/" + entry->d_name;
+            std::string sentfilename = sentDir + "/" + entry->d_name;
 #endif
-            rename(filename.c_str(),sentfilename.c_str());
-          } else {
-            _unlink(filename.c_str());
+              rename(filename.c_str(),sentfilename.c_str());
+            } else {
+              _unlink(filename.c_str());
+            }
           }
-        }
-        catch (gsmlib::GsmException &me)
-        {
+          catch (gsmlib::GsmException &me)
+          {
 #ifndef WIN32
-          if (enableSyslog)
-            syslog(LOG_WARNING, "Failed sending SMS to %s from file %s: %s", phoneBuf,
-                   filename.c_str(), me.what());
-          else
+            if (enableSyslog)
+              syslog(LOG_WARNING, "Failed sending SMS to %s from file %s: %s", phoneBuf,
+                     filename.c_str(), me.what());
+            else
 #endif
-	    std::cerr << "Failed sending SMS to " << phoneBuf << " from "
-		      << filename << ": " << me.what() << std::endl;
-          if (failedDirBase != "") {
+              std::cerr << "Failed sending SMS to " << phoneBuf << " from "
+                        << filename << ": " << me.what() << std::endl;
+            if (failedDirBase != "") {
 #ifdef WIN32
-            std::string failedfilename = failedDir + "\\" + fileInfo.name;
+              std::string failedfilename = failedDir + "\\" + fileInfo.name;
 #else
-            std::string failedfilename = failedDir + "/" + entry->d_name;
+              std::string failedfilename = failedDir + "/" + entry->d_name;
 #endif
-            rename(filename.c_str(),failedfilename.c_str());
+              rename(filename.c_str(),failedfilename.c_str());
+            }
           }
-        }
 #ifdef WIN32
+        }
+        moreFiles = _findnext(fileHandle, &fileInfo) == 0; 
+#endif
       }
-      moreFiles = _findnext(fileHandle, &fileInfo) == 0; 
+    }
+    catch (gsmlib::GsmException &)
+    {
+#ifdef WIN32
+      _findclose(fileHandle);
+#else
+      closedir(dir);
 #endif
+      // an error ending the burst must not replace the original error
+      if (smsBurst)
+        try
+        {
+          me->endSMSBurst();
+        }
+        catch (gsmlib::GsmException &)
+        {
+        }
+      throw;
     }
 #ifdef WIN32
     _findclose(fileHandle);
 #else
     closedir(dir);
 #endif
+    if (smsBurst)
+      me->endSMSBurst();
   }
 }
 
@@ -379,10 +537,13 @@ int main(int argc, char *argv[])
     std::string initString = gsmlib::DEFAULT_INIT_STRING;
     bool swHandshake = false;
     std::string concatenatedMessageIdStr;
+    std::string reassemblyTimeoutStr;
+    std::string broadcastTimeoutStr;
+    std::string cbChannels;
 
     int opt;
     int dummy = 0;
-    while((opt = getopt_long(argc, argv, "c:C:I:t:fd:a:b:hvs:S:F:P:LXDr",
+    while((opt = getopt_long(argc, argv, "c:C:I:t:fd:a:b:hvs:S:F:P:LXDrR:B:M:",
                              longOpts, &dummy)) != -1)
       switch (opt)
       {
@@ -392,6 +553,15 @@ int main(int argc, char *argv[])
       case 'r':
         requestStatusReport = true;
         break;
+      case 'R':
+        reassemblyTimeoutStr = optarg;
+        break;
+      case 'B':
+        broadcastTimeoutStr = optarg;
+        break;
+      case 'M':
+        cbChannels = optarg;
+        break;
       case 'D':
         onlyReceptionIndication = false;
         break;
@@ -451,6 +621,10 @@ int main(int argc, char *argv[])
              << _("  -b, --baudrate    baudrate to use for device "
                   "(default: 38400)")
              << std::endl
+             << _("  -B, --broadcast   merge pages of cell broadcast messages\n"
+                  "                    and drop repeated broadcasts, give\n"
+                  "                    timeout in seconds for missing pages")
+             << std::endl
              << _("  -c, --concatenate start ID for concatenated SMS messages")
              << std::endl
              << _("  -C, --sca         SMS service centre address") << std::endl
@@ -461,6 +635,8 @@ int main(int argc, char *argv[])
              << _("                    if unset, the SMS will be deleted") << std::endl
              << _("  -h, --help        prints this message") << std::endl
              << _("  -I, --init        device AT init sequence") << std::endl
+             << _("  -M, --channels    cell broadcast message identifiers to\n"
+                  "                    accept (e.g. \"0-3,50\")") << std::endl
 #ifndef WIN32
              << _("  -L, --syslog      log errors and information to syslog")
              << std::endl
@@ -468,6 +644,9 @@ int main(int argc, char *argv[])
              << _("  -P, --priorities  number of priority levels to use,") << std::endl
              << _("                    (default: none)") << std::endl
              << _("  -r, --requeststat request SMS status report") << std::endl
+             << _("  -R, --reassemble  reassemble concatenated SMSs, give\n"
+                  "                    timeout in seconds for missing parts")
+             << std::endl
              << _("  -s, --spool       spool directory for outgoing SMS")
              << std::endl
              << _("  -S, --sent        directory to move sent SMS to,") << std::endl
@@ -523,7 +702,23 @@ int main(int argc, char *argv[])
 
     // check parameters
     if (concatenatedMessageIdStr != "")
-      concatenatedMessageId = gsmlib::checkNumber(concatenatedMessageIdStr);
+    {
+      int concatenatedMessageId =
+        gsmlib::checkNumber(concatenatedMessageIdStr);
+      if (concatenatedMessageId < 0 || concatenatedMessageId > 65535)
+        throw gsmlib::GsmException(
+          gsmlib::stringPrintf(_("invalid concatenated message ID %d"),
+                               concatenatedMessageId),
+          gsmlib::ParameterError);
+      references =
+        new gsmlib::SMSReferenceAllocator(true, concatenatedMessageId);
+    }
+    if (reassemblyTimeoutStr != "")
+      reassembler = new gsmlib::SMSReassembler(
+        gsmlib::checkNumber(reassemblyTimeoutStr));
+    if (broadcastTimeoutStr != "")
+      cbAggregator = new gsmlib::CBAggregator(
+        gsmlib::checkNumber(broadcastTimeoutStr));
     
     // register signal handler for terminate signal
 #ifndef WIN32
@@ -603,6 +798,22 @@ int main(int argc, char *argv[])
     me->setSMSRoutingToTA(enableSMS, enableCB, enableStat,
                         onlyReceptionIndication);
 
+    // restrict cell broadcast channels, filter in the library only
+    // if the ME does not support this
+    if (cbChannels != "")
+    {
+      gsmlib::CBChannelFilter filter;
+      filter.addMessageIdentifiers(cbChannels);
+      try
+      {
+        me->setCBChannels(filter);
+      }
+      catch (gsmlib::GsmException &)
+      {
+        me->setCBChannels(filter, false);
+      }
+    }
+
     // register event handler to handle routed SMSs, CBMs, and status reports
     me->setEventHandler(new EventHandler());
     
@@ -621,6 +832,14 @@ int main(int argc, char *argv[])
       timeoutVal.tv_usec = 0;
       me->waitEvent(&timeoutVal);
 #endif
+      // collect the reception indications of a burst of incoming SMSs
+      // and read them together
+      if (newMessages.size() > 0 && ! terminateSent)
+      {
+        waitForIndications(5);
+        readIndicatedMessages();
+      }
+
       // if it returns, there was an event or a timeout
       while (newMessages.size() > 0)
       {
@@ -657,17 +876,53 @@ int main(int argc, char *argv[])
           store->setCaching(false);
 
           if (messageType == gsmlib::GsmEvent::CellBroadcastSMS)
-            result += (*store.getptr())[index].cbMessage()->toString();
+          {
+            newCBMessage = (*store.getptr())[index].cbMessage();
+            result += newCBMessage->toString();
+          }
           else
-            result += (*store.getptr())[index].message()->toString();
+          {
+            newSMSMessage = (*store.getptr())[index].message();
+            result += newSMSMessage->toString();
+          }
             
           store->erase(store->begin() + index);
         }
+
+        // parts of concatenated SMSs are collected first
+        if (reassembler != NULL &&
+            messageType == gsmlib::GsmEvent::NormalSMS &&
+            ! newSMSMessage.isnull())
+        {
+          reassembler->add(newSMSMessage);
+          continue;
+        }
+
+        // pages of CB messages as well
+        if (cbAggregator != NULL && ! newCBMessage.isnull())
+        {
+          cbAggregator->add(newCBMessage);
+          continue;
+        }
         
         // call the action
         doAction(action, result);
       }
 
+      // dispatch reassembled messages, incomplete ones after timeout
+      if (reassembler != NULL)
+      {
+        reassembler->expire();
+        if (exitScheduled)
+          reassembler->flush();
+        doReassembledAction(action);
+      }
+      if (cbAggregator != NULL)
+      {
+        cbAggregator->expire();
+        doAggregatedCBAction(action);
+      }
+
       // if no new SMS came in and program exit was scheduled, then exit
       if (exitScheduled)
         exit(0);
@@ -271,7 +271,7 @@ int main(int argc, char *argv[])
 	if (source == "-")
 	  sourceStore = new gsmlib::SortedSMSStore(true);
 	else if (gsmlib::isFile(source))
-	  sourceStore = new gsmlib::SortedSMSStore(source);
+	  sourceStore = new gsmlib::SortedSMSStore(source, true);
 	else
 	  {
 	    if (storeName == "")
@@ -0,0 +1,566 @@
+// *************************************************************************
+// * GSM TA/ME library
+// *
+// * File:    gsm_alphabet.cc
+// *
+// * Purpose: GSM 7-bit default alphabet with extension and national
+// *          language shift tables, UTF-8 and UCS2 conversion
+// *          (ETSI GSM 03.38, 3GPP TS 23.038)
+// *
+// * Created: 18.10.2026
+// *************************************************************************
+
+#ifdef HAVE_CONFIG_H
+#include <gsm_config.h>
+#endif
+#include <gsmlib/gsm_sysdep.h>
+#include <gsmlib/gsm_alphabet.h>
+#include <algorithm>
+#include <cstring>
+
+using namespace gsmlib;
+
+// conversion tables, GSM septet to Unicode
+// (3GPP TS 23.038 section 6.2.1 and annex A)
+
+// default alphabet (locking shift table of the default language)
+// 0x1b (escape) has no character
+static const unsigned short defaultTable[128] =
+{
+  /*   0 */ 0x0040, 0x00a3, 0x0024, 0x00a5, 0x00e8, 0x00e9, 0x00f9, 0x00ec,
+  /*   8 */ 0x00f2, 0x00c7, 0x000a, 0x00d8, 0x00f8, 0x000d, 0x00c5, 0x00e5,
+  /*  16 */ 0x0394, 0x005f, 0x03a6, 0x0393, 0x039b, 0x03a9, 0x03a0, 0x03a8,
+  /*  24 */ 0x03a3, 0x0398, 0x039e, 0x0000, 0x00c6, 0x00e6, 0x00df, 0x00c9,
+  /*  32 */ 0x0020, 0x0021, 0x0022, 0x0023, 0x00a4, 0x0025, 0x0026, 0x0027,
+  /*  40 */ 0x0028, 0x0029, 0x002a, 0x002b, 0x002c, 0x002d, 0x002e, 0x002f,
+  /*  48 */ 0x0030, 0x0031, 0x0032, 0x0033, 0x0034, 0x0035, 0x0036, 0x0037,
+  /*  56 */ 0x0038, 0x0039, 0x003a, 0x003b, 0x003c, 0x003d, 0x003e, 0x003f,
+  /*  64 */ 0x00a1, 0x0041, 0x0042, 0x0043, 0x0044, 0x0045, 0x0046, 0x0047,
+  /*  72 */ 0x0048, 0x0049, 0x004a, 0x004b, 0x004c, 0x004d, 0x004e, 0x004f,
+  /*  80 */ 0x0050, 0x0051, 0x0052, 0x0053, 0x0054, 0x0055, 0x0056, 0x0057,
+  /*  88 */ 0x0058, 0x0059, 0x005a, 0x00c4, 0x00d6, 0x00d1, 0x00dc, 0x00a7,
+  /*  96 */ 0x00bf, 0x0061, 0x0062, 0x0063, 0x0064, 0x0065, 0x0066, 0x0067,
+  /* 104 */ 0x0068, 0x0069, 0x006a, 0x006b, 0x006c, 0x006d, 0x006e, 0x006f,
+  /* 112 */ 0x0070, 0x0071, 0x0072, 0x0073, 0x0074, 0x0075, 0x0076, 0x0077,
+  /* 120 */ 0x0078, 0x0079, 0x007a, 0x00e4, 0x00f6, 0x00f1, 0x00fc, 0x00e0
+};
+
+// Turkish locking shift table
+static const unsigned short turkishTable[128] =
+{
+  /*   0 */ 0x0040, 0x00a3, 0x0024, 0x00a5, 0x20ac, 0x00e9, 0x00f9, 0x0131,
+  /*   8 */ 0x00f2, 0x00c7, 0x000a, 0x011e, 0x011f, 0x000d, 0x00c5, 0x00e5,
+  /*  16 */ 0x0394, 0x005f, 0x03a6, 0x0393, 0x039b, 0x03a9, 0x03a0, 0x03a8,
+  /*  24 */ 0x03a3, 0x0398, 0x039e, 0x0000, 0x015e, 0x015f, 0x00df, 0x00c9,
+  /*  32 */ 0x0020, 0x0021, 0x0022, 0x0023, 0x00a4, 0x0025, 0x0026, 0x0027,
+  /*  40 */ 0x0028, 0x0029, 0x002a, 0x002b, 0x002c, 0x002d, 0x002e, 0x002f,
+  /*  48 */ 0x0030, 0x0031, 0x0032, 0x0033, 0x0034, 0x0035, 0x0036, 0x0037,
+  /*  56 */ 0x0038, 0x0039, 0x003a, 0x003b, 0x003c, 0x003d, 0x003e, 0x003f,
+  /*  64 */ 0x0130, 0x0041, 0x0042, 0x0043, 0x0044, 0x0045, 0x0046, 0x0047,
+  /*  72 */ 0x0048, 0x0049, 0x004a, 0x004b, 0x004c, 0x004d, 0x004e, 0x004f,
+  /*  80 */ 0x0050, 0x0051, 0x0052, 0x0053, 0x0054, 0x0055, 0x0056, 0x0057,
+  /*  88 */ 0x0058, 0x0059, 0x005a, 0x00c4, 0x00d6, 0x00d1, 0x00dc, 0x00a7,
+  /*  96 */ 0x00e7, 0x0061, 0x0062, 0x0063, 0x0064, 0x0065, 0x0066, 0x0067,
+  /* 104 */ 0x0068, 0x0069, 0x006a, 0x006b, 0x006c, 0x006d, 0x006e, 0x006f,
+  /* 112 */ 0x0070, 0x0071, 0x0072, 0x0073, 0x0074, 0x0075, 0x0076, 0x0077,
+  /* 120 */ 0x0078, 0x0079, 0x007a, 0x00e4, 0x00f6, 0x00f1, 0x00fc, 0x00e0
+};
+
+// Portuguese locking shift table
+static const unsigned short portugueseTable[128] =
+{
+  /*   0 */ 0x0040, 0x00a3, 0x0024, 0x00a5, 0x00ea, 0x00e9, 0x00fa, 0x00ed,
+  /*   8 */ 0x00f3, 0x00e7, 0x000a, 0x00d4, 0x00f4, 0x000d, 0x00c1, 0x00e1,
+  /*  16 */ 0x0394, 0x005f, 0x00aa, 0x00c7, 0x00c0, 0x221e, 0x005e, 0x005c,
+  /*  24 */ 0x20ac, 0x00d3, 0x007c, 0x0000, 0x00c2, 0x00e2, 0x00ca, 0x00c9,
+  /*  32 */ 0x0020, 0x0021, 0x0022, 0x0023, 0x00ba, 0x0025, 0x0026, 0x0027,
+  /*  40 */ 0x0028, 0x0029, 0x002a, 0x002b, 0x002c, 0x002d, 0x002e, 0x002f,
+  /*  48 */ 0x0030, 0x0031, 0x0032, 0x0033, 0x0034, 0x0035, 0x0036, 0x0037,
+  /*  56 */ 0x0038, 0x0039, 0x003a, 0x003b, 0x003c, 0x003d, 0x003e, 0x003f,
+  /*  64 */ 0x00cd, 0x0041, 0x0042, 0x0043, 0x0044, 0x0045, 0x0046, 0x0047,
+  /*  72 */ 0x0048, 0x0049, 0x004a, 0x004b, 0x004c, 0x004d, 0x004e, 0x004f,
+  /*  80 */ 0x0050, 0x0051, 0x0052, 0x0053, 0x0054, 0x0055, 0x0056, 0x0057,
+  /*  88 */ 0x0058, 0x0059, 0x005a, 0x00c3, 0x00d5, 0x00da, 0x00dc, 0x00a7,
+  /*  96 */ 0x007e, 0x0061, 0x0062, 0x0063, 0x0064, 0x0065, 0x0066, 0x0067,
+  /* 104 */ 0x0068, 0x0069, 0x006a, 0x006b, 0x006c, 0x006d, 0x006e, 0x006f,
+  /* 112 */ 0x0070, 0x0071, 0x0072, 0x0073, 0x0074, 0x0075, 0x0076, 0x0077,
+  /* 120 */ 0x0078, 0x0079, 0x007a, 0x00e3, 0x00f5, 0x0060, 0x00fc, 0x00e0
+};
+
+// default extension table (0 = undefined)
+static const unsigned short defaultExtensionTable[128] =
+{
+  /*   0 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+  /*   8 */ 0x0000, 0x0000, 0x000c, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+  /*  16 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x005e, 0x0000, 0x0000, 0x0000,
+  /*  24 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+  /*  32 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+  /*  40 */ 0x007b, 0x007d, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x005c,
+  /*  48 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+  /*  56 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x005b, 0x007e, 0x005d, 0x0000,
+  /*  64 */ 0x007c, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+  /*  72 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+  /*  80 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+  /*  88 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+  /*  96 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x20ac, 0x0000, 0x0000,
+  /* 104 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+  /* 112 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+  /* 120 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000
+};
+
+// Turkish single shift table
+static const unsigned short turkishExtensionTable[128] =
+{
+  /*   0 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+  /*   8 */ 0x0000, 0x0000, 0x000c, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+  /*  16 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x005e, 0x0000, 0x0000, 0x0000,
+  /*  24 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+  /*  32 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+  /*  40 */ 0x007b, 0x007d, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x005c,
+  /*  48 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+  /*  56 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x005b, 0x007e, 0x005d, 0x0000,
+  /*  64 */ 0x007c, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x011e,
+  /*  72 */ 0x0000, 0x0130, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+  /*  80 */ 0x0000, 0x0000, 0x0000, 0x015e, 0x0000, 0x0000, 0x0000, 0x0000,
+  /*  88 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+  /*  96 */ 0x0000, 0x0000, 0x0000, 0x00e7, 0x0000, 0x20ac, 0x0000, 0x011f,
+  /* 104 */ 0x0000, 0x0131, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+  /* 112 */ 0x0000, 0x0000, 0x0000, 0x015f, 0x0000, 0x0000, 0x0000, 0x0000,
+  /* 120 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000
+};
+
+// Spanish single shift table
+static const unsigned short spanishExtensionTable[128] =
+{
+  /*   0 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+  /*   8 */ 0x0000, 0x00e7, 0x000c, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+  /*  16 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x005e, 0x0000, 0x0000, 0x0000,
+  /*  24 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+  /*  32 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+  /*  40 */ 0x007b, 0x007d, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x005c,
+  /*  48 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+  /*  56 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x005b, 0x007e, 0x005d, 0x0000,
+  /*  64 */ 0x007c, 0x00c1, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+  /*  72 */ 0x0000, 0x00cd, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x00d3,
+  /*  80 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x00da, 0x0000, 0x0000,
+  /*  88 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+  /*  96 */ 0x0000, 0x00e1, 0x0000, 0x0000, 0x0000, 0x20ac, 0x0000, 0x0000,
+  /* 104 */ 0x0000, 0x00ed, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x00f3,
+  /* 112 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x00fa, 0x0000, 0x0000,
+  /* 120 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000
+};
+
+// Portuguese single shift table
+static const unsigned short portugueseExtensionTable[128] =
+{
+  /*   0 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x00ea, 0x0000, 0x0000,
+  /*   8 */ 0x0000, 0x00e7, 0x000c, 0x00d4, 0x00f4, 0x0000, 0x00c1, 0x00e1,
+  /*  16 */ 0x0000, 0x0000, 0x03a6, 0x0393, 0x005e, 0x03a9, 0x03a0, 0x03a8,
+  /*  24 */ 0x03a3, 0x0398, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x00ca,
+  /*  32 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+  /*  40 */ 0x007b, 0x007d, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x005c,
+  /*  48 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+  /*  56 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x005b, 0x007e, 0x005d, 0x0000,
+  /*  64 */ 0x007c, 0x00c0, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+  /*  72 */ 0x0000, 0x00cd, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x00d3,
+  /*  80 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x00da, 0x0000, 0x0000,
+  /*  88 */ 0x0000, 0x0000, 0x0000, 0x00c3, 0x00d5, 0x0000, 0x0000, 0x0000,
+  /*  96 */ 0x0000, 0x00c2, 0x0000, 0x0000, 0x0000, 0x20ac, 0x0000, 0x0000,
+  /* 104 */ 0x0000, 0x00ed, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x00f3,
+  /* 112 */ 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x00fa, 0x0000, 0x0000,
+  /* 120 */ 0x0000, 0x0000, 0x0000, 0x00e3, 0x00f5, 0x0000, 0x0000, 0x00e2
+};
+
+// characters of code 256 and above of the tables above with their
+// septet (the first one if a character occurs twice), sorted by
+// character
+
+static const GsmCharacterSeptet defaultOthers[] =
+{
+  {0x0393,  19}, {0x0394,  16}, {0x0398,  25}, {0x039b,  20}, {0x039e,  26},
+  {0x03a0,  22}, {0x03a3,  24}, {0x03a6,  18}, {0x03a8,  23}, {0x03a9,  21}
+};
+
+static const GsmCharacterSeptet turkishOthers[] =
+{
+  {0x011e,  11}, {0x011f,  12}, {0x0130,  64}, {0x0131,   7}, {0x015e,  28},
+  {0x015f,  29}, {0x0393,  19}, {0x0394,  16}, {0x0398,  25}, {0x039b,  20},
+  {0x039e,  26}, {0x03a0,  22}, {0x03a3,  24}, {0x03a6,  18}, {0x03a8,  23},
+  {0x03a9,  21}, {0x20ac,   4}
+};
+
+static const GsmCharacterSeptet portugueseOthers[] =
+{
+  {0x0394,  16}, {0x20ac,  24}, {0x221e,  21}
+};
+
+static const GsmCharacterSeptet defaultExtensionOthers[] =
+{
+  {0x20ac, 101}
+};
+
+static const GsmCharacterSeptet turkishExtensionOthers[] =
+{
+  {0x011e,  71}, {0x011f, 103}, {0x0130,  73}, {0x0131, 105}, {0x015e,  83},
+  {0x015f, 115}, {0x20ac, 101}
+};
+
+static const GsmCharacterSeptet spanishExtensionOthers[] =
+{
+  {0x20ac, 101}
+};
+
+static const GsmCharacterSeptet portugueseExtensionOthers[] =
+{
+  {0x0393,  19}, {0x0398,  25}, {0x03a0,  22}, {0x03a3,  24}, {0x03a6,  18},
+  {0x03a8,  23}, {0x03a9,  21}, {0x20ac, 101}
+};
+
+// tables of the national languages, there is no Spanish locking shift
+// table
+
+struct LanguageTables
+{
+  const unsigned short *_table;
+  const GsmCharacterSeptet *_others;
+  unsigned int _othersLength;
+};
+
+#define TABLES(name) \
+  {name##Table, name##Others, \
+   sizeof(name##Others) / sizeof(GsmCharacterSeptet)}
+
+static const LanguageTables lockingShiftTables[] =
+  {TABLES(default), TABLES(turkish), {NULL, NULL, 0}, TABLES(portuguese)};
+
+static const LanguageTables singleShiftTables[] =
+  {TABLES(defaultExtension), TABLES(turkishExtension),
+   TABLES(spanishExtension), TABLES(portugueseExtension)};
+
+#undef TABLES
+
+// GsmAlphabet members
+
+static bool lessCharacter(const GsmCharacterSeptet &x,
+                          const GsmCharacterSeptet &y)
+{
+  return x._character < y._character;
+}
+
+GsmAlphabet::GsmAlphabet(NationalLanguage lockingShift,
+                         NationalLanguage singleShift) :
+  _lockingShift(lockingShift), _singleShift(singleShift)
+{
+  const LanguageTables *basic = &lockingShiftTables[DefaultLanguage];
+  if (lockingShift > DefaultLanguage && lockingShift <= Portuguese &&
+      lockingShiftTables[lockingShift]._table != NULL)
+    basic = &lockingShiftTables[lockingShift];
+  const LanguageTables *extension = &singleShiftTables[DefaultLanguage];
+  if (singleShift > DefaultLanguage && singleShift <= Portuguese)
+    extension = &singleShiftTables[singleShift];
+  _basic = basic->_table;
+  _extension = extension->_table;
+  _basicOthers = basic->_others;
+  _basicOthersEnd = basic->_others + basic->_othersLength;
+  _extensionOthers = extension->_others;
+  _extensionOthersEnd = extension->_others + extension->_othersLength;
+
+  // reverse mapping of the characters below 256, basic characters
+  // take precedence over escaped ones
+  for (unsigned int i = 0; i < 256; ++i)
+    _latin[i] = NoSeptet;
+  for (int pass = 0; pass < 2; ++pass)
+  {
+    const unsigned short *table = pass == 0 ? _basic : _extension;
+    unsigned short flag = pass == 0 ? 0 : EscapedSeptet;
+    for (unsigned short s = 0; s < 128; ++s)
+    {
+      unsigned short c = table[s];
+      if (c != 0 && c < 256 && _latin[c] == NoSeptet)
+        _latin[c] = s | flag;
+    }
+  }
+}
+
+unsigned short GsmAlphabet::lookup(unsigned long c) const
+{
+  if (c < 256)
+    return _latin[c];
+  if (c > 0xffff)
+    return NoSeptet;
+  GsmCharacterSeptet key = {(unsigned short)c, 0};
+  const GsmCharacterSeptet *i =
+    std::lower_bound(_basicOthers, _basicOthersEnd, key, lessCharacter);
+  if (i != _basicOthersEnd && i->_character == c)
+    return i->_septet;
+  i = std::lower_bound(_extensionOthers, _extensionOthersEnd, key,
+                       lessCharacter);
+  if (i != _extensionOthersEnd && i->_character == c)
+    return i->_septet | EscapedSeptet;
+  return NoSeptet;
+}
+
+unsigned long GsmAlphabet::character(unsigned char septet,
+                                     bool escaped) const
+{
+  septet &= 0x7f;
+  return escaped ? _extension[septet] : _basic[septet];
+}
+
+std::string GsmAlphabet::toUtf8(const std::string &septets) const
+{
+  std::string result;
+  result.reserve(septets.length());
+  for (std::string::size_type i = 0; i < septets.length(); ++i)
+  {
+    unsigned char s = septets[i] & 0x7f;
+    unsigned long c;
+    if (s == GSM_ESCAPE)
+    {
+      if (++i == septets.length())
+        break;                  // trailing escape
+      s = septets[i] & 0x7f;
+      c = _extension[s];
+      if (c == 0)
+        c = _basic[s];
+      if (c == 0)
+        continue;               // escape followed by escape
+    }
+    else
+      c = _basic[s];
+    if (c < 0x80)
+      result += (char)c;
+    else
+      appendUtf8Character(result, c);
+  }
+  return result;
+}
+
+// return true if the 8 octets at s are all 7-bit ASCII
+static inline bool asciiOctets(const char *s)
+{
+  unsigned_int_8 octets;
+  memcpy(&octets, s, sizeof(octets));
+  return (octets & 0x8080808080808080ULL) == 0;
+}
+
+std::string GsmAlphabet::fromUtf8(const std::string &utf8,
+                                  unsigned int *unconvertible) const
+{
+  std::string result;
+  result.reserve(utf8.length());
+  unsigned int bad = 0;
+  std::string::size_type i = 0;
+  while (i < utf8.length())
+  {
+    // fast path for runs of ASCII characters, no UTF-8 decoding needed
+    while (i + 8 <= utf8.length() && asciiOctets(utf8.data() + i))
+      for (std::string::size_type end = i + 8; i < end; ++i)
+      {
+        unsigned short s = _latin[(unsigned char)utf8[i]];
+        if (s == NoSeptet)
+        {
+          result += '?';
+          ++bad;
+        }
+        else
+        {
+          if (s & EscapedSeptet)
+            result += (char)GSM_ESCAPE;
+          result += (char)(s & 0x7f);
+        }
+      }
+    if (i == utf8.length())
+      break;
+
+    unsigned long c = (unsigned char)utf8[i];
+    if (c < 0x80)
+      ++i;
+    else
+      c = nextUtf8Character(utf8, i);
+    unsigned short s = septet(c);
+    if (s == NoSeptet)
+    {
+      result += '?';
+      ++bad;
+      continue;
+    }
+    if (s & EscapedSeptet)
+      result += (char)GSM_ESCAPE;
+    result += (char)(s & 0x7f);
+  }
+  if (unconvertible != NULL)
+    *unconvertible = bad;
+  return result;
+}
+
+int GsmAlphabet::septetCount(const std::string &utf8) const
+{
+  int result = 0;
+  std::string::size_type i = 0;
+  while (i < utf8.length())
+  {
+    unsigned long c = (unsigned char)utf8[i];
+    if (c < 0x80)
+      ++i;
+    else
+      c = nextUtf8Character(utf8, i);
+    unsigned short s = septet(c);
+    if (s == NoSeptet)
+      return -1;
+    result += (s & EscapedSeptet) ? 2 : 1;
+  }
+  return result;
+}
+
+// UTF-8 and UCS2 functions
+
+unsigned long gsmlib::nextUtf8Character(const std::string &s,
+                                        std::string::size_type &pos)
+{
+  unsigned char c = s[pos++];
+  if (c < 0x80)
+    return c;
+
+  unsigned int following;
+  unsigned long result, minimum;
+  if ((c & 0xe0) == 0xc0)
+  {
+    following = 1;
+    result = c & 0x1f;
+    minimum = 0x80;
+  }
+  else if ((c & 0xf0) == 0xe0)
+  {
+    following = 2;
+    result = c & 0x0f;
+    minimum = 0x800;
+  }
+  else if ((c & 0xf8) == 0xf0)
+  {
+    following = 3;
+    result = c & 0x07;
+    minimum = 0x10000;
+  }
+  else
+    return UnicodeReplacement;  // continuation octet or invalid
+
+  for (unsigned int i = 0; i < following; ++i)
+  {
+    if (pos == s.length() || ((unsigned char)s[pos] & 0xc0) != 0x80)
+      return UnicodeReplacement;
+    result = (result << 6) | ((unsigned char)s[pos++] & 0x3f);
+  }
+  // reject overlong forms, surrogates, and values beyond Unicode
+  if (result < minimum || (result >= 0xd800 && result <= 0xdfff) ||
+      result > 0x10ffff)
+    return UnicodeReplacement;
+  return result;
+}
+
+void gsmlib::appendUtf8Character(std::string &s, unsigned long c)
+{
+  if (c < 0x80)
+    s += (char)c;
+  else if (c < 0x800)
+  {
+    s += (char)(0xc0 | (c >> 6));
+    s += (char)(0x80 | (c & 0x3f));
+  }
+  else if (c < 0x10000)
+  {
+    s += (char)(0xe0 | (c >> 12));
+    s += (char)(0x80 | ((c >> 6) & 0x3f));
+    s += (char)(0x80 | (c & 0x3f));
+  }
+  else
+  {
+    s += (char)(0xf0 | (c >> 18));
+    s += (char)(0x80 | ((c >> 12) & 0x3f));
+    s += (char)(0x80 | ((c >> 6) & 0x3f));
+    s += (char)(0x80 | (c & 0x3f));
+  }
+}
+
+// append 16-bit code unit u to big endian UCS2 string s
+static inline void appendUcs2(std::string &s, unsigned long u)
+{
+  s += (char)(u >> 8);
+  s += (char)(u & 0xff);
+}
+
+std::string gsmlib::utf8ToUcs2(const std::string &utf8)
+{
+  std::string result;
+  result.reserve(utf8.length() * 2);
+  std::string::size_type i = 0;
+  while (i < utf8.length())
+  {
+    unsigned long c = nextUtf8Character(utf8, i);
+    if (c >= 0x10000)
+    {
+      c -= 0x10000;
+      appendUcs2(result, 0xd800 | (c >> 10));
+      appendUcs2(result, 0xdc00 | (c & 0x3ff));
+    }
+    else
+      appendUcs2(result, c);
+  }
+  return result;
+}
+
+std::string gsmlib::ucs2ToUtf8(const std::string &ucs2)
+{
+  std::string result;
+  result.reserve(ucs2.length());
+  for (std::string::size_type i = 0; i + 1 < ucs2.length(); i += 2)
+  {
+    unsigned long c =
+      ((unsigned char)ucs2[i] << 8) | (unsigned char)ucs2[i + 1];
+    if (c >= 0xd800 && c <= 0xdbff && i + 3 < ucs2.length())
+    {
+      unsigned long low =
+        ((unsigned char)ucs2[i + 2] << 8) | (unsigned char)ucs2[i + 3];
+      if (low >= 0xdc00 && low <= 0xdfff)
+      {
+        c = 0x10000 + ((c - 0xd800) << 10) + (low - 0xdc00);
+        i += 2;
+      }
+    }
+    if (c >= 0xd800 && c <= 0xdfff)
+      c = UnicodeReplacement;   // unpaired surrogate
+    appendUtf8Character(result, c);
+  }
+  return result;
+}
+
+unsigned int gsmlib::ucs2Length(const std::string &utf8)
+{
+  unsigned int result = 0;
+  std::string::size_type i = 0;
+  while (i < utf8.length())
+    result += nextUtf8Character(utf8, i) >= 0x10000 ? 2 : 1;
+  return result;
+}
+
+std::string gsmlib::latin1ToUtf8(const std::string &latin1)
+{
+  std::string result;
+  result.reserve(latin1.length());
+  for (std::string::size_type i = 0; i < latin1.length(); ++i)
+    appendUtf8Character(result, (unsigned char)latin1[i]);
+  return result;
+}
+
+std::string gsmlib::utf8ToLatin1(const std::string &utf8)
+{
+  std::string result;
+  result.reserve(utf8.length());
+  std::string::size_type i = 0;
+  while (i < utf8.length())
+  {
+    unsigned long c = nextUtf8Character(utf8, i);
+    result += c < 256 ? (char)c : '?';
+  }
+  return result;
+}
@@ -0,0 +1,130 @@
+// *************************************************************************
+// * GSM TA/ME library
+// *
+// * File:    gsm_alphabet.h
+// *
+// * Purpose: GSM 7-bit default alphabet with extension and national
+// *          language shift tables, UTF-8 and UCS2 conversion
+// *          (ETSI GSM 03.38, 3GPP TS 23.038)
+// *
+// * Created: 18.10.2026
+// *************************************************************************
+
+#ifndef GSM_ALPHABET_H
+#define GSM_ALPHABET_H
+
+#include <string>
+
+namespace gsmlib
+{
+  // national language identifiers of the shift tables
+  // (as used in the national language shift information elements)
+  enum NationalLanguage {DefaultLanguage = 0, Turkish = 1, Spanish = 2,
+                         Portuguese = 3};
+
+  // GSM escape to extension table
+  const unsigned char GSM_ESCAPE = 0x1b;
+
+  // Unicode replacement character for undecodable input
+  const unsigned long UnicodeReplacement = 0xfffd;
+
+  // Unicode character and septet of a shift table
+  struct GsmCharacterSeptet
+  {
+    unsigned short _character;
+    unsigned char _septet;
+  };
+
+  // a GSM 7-bit alphabet consisting of a locking shift table (the
+  // basic characters) and a single shift table (the characters reached
+  // by GSM_ESCAPE)
+  // septet strings contain one septet per character, including the
+  // escapes (as returned by SMSDecoder::getString())
+  class GsmAlphabet
+  {
+  private:
+    NationalLanguage _lockingShift;
+    NationalLanguage _singleShift;
+    const unsigned short *_basic; // septet -> Unicode
+    const unsigned short *_extension; // escaped septet -> Unicode (0 = none)
+
+    // Unicode -> septet (or'ed with EscapedSeptet),
+    // direct for code points below 256, sorted static tables for the
+    // others
+    unsigned short _latin[256];
+    const GsmCharacterSeptet *_basicOthers, *_basicOthersEnd;
+    const GsmCharacterSeptet *_extensionOthers, *_extensionOthersEnd;
+
+  public:
+    // flag for septets that must be preceded by GSM_ESCAPE
+    static const unsigned short EscapedSeptet = 0x100;
+
+    // flag for characters that are not in this alphabet
+    static const unsigned short NoSeptet = 0xffff;
+
+    // create alphabet with the given locking and single shift tables
+    // (Spanish has no locking shift table, the default one is used)
+    GsmAlphabet(NationalLanguage lockingShift = DefaultLanguage,
+                NationalLanguage singleShift = DefaultLanguage);
+
+    NationalLanguage lockingShift() const {return _lockingShift;}
+    NationalLanguage singleShift() const {return _singleShift;}
+
+    // return septet for Unicode character c, or'ed with EscapedSeptet
+    // if it is in the single shift table, NoSeptet if not in alphabet
+    unsigned short septet(unsigned long c) const
+    {
+      if (c < 256)
+        return _latin[c];
+      return lookup(c);
+    }
+
+    // same as above for code points of 256 and above
+    unsigned short lookup(unsigned long c) const;
+
+    // return Unicode character of (possibly escaped) septet,
+    // 0 if undefined
+    unsigned long character(unsigned char septet, bool escaped = false) const;
+
+    // convert septet string to UTF-8
+    // escapes followed by a septet not in the single shift table
+    // yield the basic character of that septet
+    std::string toUtf8(const std::string &septets) const;
+
+    // convert UTF-8 to septet string
+    // characters that are not in the alphabet are replaced by '?',
+    // their number is returned in unconvertible (if given)
+    std::string fromUtf8(const std::string &utf8,
+                         unsigned int *unconvertible = NULL) const;
+
+    // return number of septets needed for the UTF-8 text,
+    // -1 if a character is not in the alphabet
+    int septetCount(const std::string &utf8) const;
+  };
+
+  // return next Unicode character from UTF-8 string s starting at pos,
+  // advance pos to the following character
+  // invalid sequences yield UnicodeReplacement
+  unsigned long nextUtf8Character(const std::string &s,
+                                  std::string::size_type &pos);
+
+  // append Unicode character c to UTF-8 string s
+  void appendUtf8Character(std::string &s, unsigned long c);
+
+  // convert UTF-8 to UCS2 octets (big endian, characters beyond the
+  // basic multilingual plane as UTF-16 surrogate pairs)
+  std::string utf8ToUcs2(const std::string &utf8);
+
+  // convert UCS2/UTF-16 octets (big endian) to UTF-8
+  std::string ucs2ToUtf8(const std::string &ucs2);
+
+  // return number of 16-bit code units needed for the UTF-8 text
+  unsigned int ucs2Length(const std::string &utf8);
+
+  // convert between Latin-1 and UTF-8
+  // characters outside Latin-1 are converted to '?'
+  std::string latin1ToUtf8(const std::string &latin1);
+  std::string utf8ToLatin1(const std::string &utf8);
+};
+
+#endif // GSM_ALPHABET_H
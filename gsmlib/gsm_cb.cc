@@ -17,6 +17,8 @@
 #include <gsmlib/gsm_cb.h>
 #include <gsmlib/gsm_nls.h>
 #include <sstream>
+#include <string.h>
+#include <ctype.h>
 
 using namespace gsmlib;
 
@@ -176,3 +178,112 @@ std::string CBMessage::toString() const
      << dashes << std::endl << std::endl << std::ends;
   return os.str();
 }
+
+// CBChannelFilter members
+
+CBChannelFilter::CBChannelFilter(bool acceptAll) :
+  _anyDataCodingScheme(true), _inverted(false)
+{
+  memset(_messageIdentifiers, acceptAll ? 0xff : 0,
+         sizeof(_messageIdentifiers));
+  memset(_dataCodingSchemes, 0, sizeof(_dataCodingSchemes));
+}
+
+void CBChannelFilter::addMessageIdentifiers(int first, int last)
+  throw(GsmException)
+{
+  addRanges(_messageIdentifiers, 65535, stringPrintf("%d-%d", first, last));
+}
+
+void CBChannelFilter::addDataCodingSchemes(int first, int last)
+  throw(GsmException)
+{
+  addDataCodingSchemes(stringPrintf("%d-%d", first, last));
+}
+
+void CBChannelFilter::addDataCodingSchemes(std::string ranges)
+  throw(GsmException)
+{
+  addRanges(_dataCodingSchemes, 255, ranges);
+  _anyDataCodingScheme = false;
+}
+
+void CBChannelFilter::addRanges(unsigned long *bits, int maxValue,
+                                std::string ranges) throw(GsmException)
+{
+  // some MEs put spaces after the commas
+  std::string::size_type i;
+  while ((i = ranges.find(' ')) != std::string::npos)
+    ranges.erase(i, 1);
+
+  i = 0;
+  while (i < ranges.length())
+  {
+    int value[2] = {0, -1};
+    for (int j = 0; j < 2; ++j)
+    {
+      if (i == ranges.length() || ! isdigit(ranges[i]))
+        throw GsmException(stringPrintf(_("invalid range list '%s'"),
+                                        ranges.c_str()), ParameterError);
+      value[j] = 0;
+      while (i < ranges.length() && isdigit(ranges[i]) &&
+             value[j] <= maxValue)
+        value[j] = value[j] * 10 + ranges[i++] - '0';
+      if (j == 1 || i == ranges.length() || ranges[i] != '-')
+        break;
+      ++i;
+    }
+    if (value[1] == -1)
+      value[1] = value[0];
+    if (value[0] > value[1] || value[1] > maxValue)
+      throw GsmException(stringPrintf(_("invalid range list '%s'"),
+                                      ranges.c_str()), ParameterError);
+    for (int v = value[0]; v <= value[1]; ++v)
+      bits[v / BitsPerWord] |= 1UL << v % BitsPerWord;
+    if (i < ranges.length() && ranges[i++] != ',')
+      throw GsmException(stringPrintf(_("invalid range list '%s'"),
+                                      ranges.c_str()), ParameterError);
+  }
+}
+
+std::string CBChannelFilter::ranges(const unsigned long *bits, int maxValue)
+{
+  std::string result;
+  for (int v = 0; v <= maxValue; ++v)
+    if (isSet(bits, v))
+    {
+      int first = v;
+      while (v < maxValue && isSet(bits, v + 1))
+        ++v;
+      if (result.length() != 0)
+        result += ',';
+      result += first == v ? stringPrintf("%d", v) :
+        stringPrintf("%d-%d", first, v);
+    }
+  return result;
+}
+
+bool CBChannelFilter::accept(const std::string &pdu) const
+{
+  // message identifier and data coding scheme are octets 3 to 5
+  // (ETSI GSM 03.41, section 9.3)
+  if (pdu.length() < 10)
+    return true;
+  int octets[3];
+  for (int i = 0; i < 3; ++i)
+  {
+    int o = 0;
+    for (int j = 4 + 2 * i; j < 6 + 2 * i; ++j)
+    {
+      char c = pdu[j];
+      if (c >= '0' && c <= '9')
+        o = o << 4 | (c - '0');
+      else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+        o = o << 4 | ((c | 0x20) - 'a' + 10);
+      else
+        return true;
+    }
+    octets[i] = o;
+  }
+  return accept(octets[0] << 8 | octets[1], octets[2]);
+}
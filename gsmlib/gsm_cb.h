@@ -99,6 +99,72 @@ namespace gsmlib
 
   // some useful typdefs
   typedef Ref<CBMessage> CBMessageRef;
+
+  // set of accepted CB message identifiers (channels) and data coding
+  // schemes as configured with +CSCB (ETSI GSM 07.05, section 3.3.4)
+  // Ranges are given as strings like "0-3,50,4370-4399". The filter
+  // can be applied to the CB TPDU before it is decoded.
+
+  class CBChannelFilter
+  {
+  private:
+    static const int BitsPerWord = sizeof(unsigned long) * 8;
+
+    unsigned long _messageIdentifiers[65536 / BitsPerWord];
+    unsigned long _dataCodingSchemes[256 / BitsPerWord];
+    bool _anyDataCodingScheme;  // no data coding scheme given
+    bool _inverted;             // the given message identifiers and data
+                                // coding schemes are excluded (mode 1)
+
+    static bool isSet(const unsigned long *bits, int bit)
+      {return (bits[bit / BitsPerWord] >> bit % BitsPerWord) & 1;}
+    static void addRanges(unsigned long *bits, int maxValue,
+                          std::string ranges) throw(GsmException);
+    static std::string ranges(const unsigned long *bits, int maxValue);
+
+  public:
+    // create filter that accepts no message identifier (or all message
+    // identifiers if acceptAll is set) and all data coding schemes
+    CBChannelFilter(bool acceptAll = false);
+
+    // add message identifiers (0..65535) to the accepted ones
+    void addMessageIdentifiers(int first, int last) throw(GsmException);
+    void addMessageIdentifiers(std::string ranges) throw(GsmException)
+      {addRanges(_messageIdentifiers, 65535, ranges);}
+
+    // restrict the accepted data coding schemes (0..255), the first call
+    // excludes all data coding schemes not given
+    void addDataCodingSchemes(int first, int last) throw(GsmException);
+    void addDataCodingSchemes(std::string ranges) throw(GsmException);
+
+    // accept exactly the messages that were not accepted before, ie.
+    // exclude the given combinations of message identifiers and data
+    // coding schemes (+CSCB mode 1)
+    void invert() {_inverted = ! _inverted;}
+
+    // return true if the given ranges are excluded (+CSCB mode 1)
+    bool inverted() const {return _inverted;}
+
+    // return accepted ranges in +CSCB format
+    std::string messageIdentifierRanges() const
+      {return ranges(_messageIdentifiers, 65535);}
+    std::string dataCodingSchemeRanges() const
+      {return _anyDataCodingScheme ? "" : ranges(_dataCodingSchemes, 255);}
+
+    // return true if messages with the given identifier and data coding
+    // scheme are accepted
+    bool accept(int messageIdentifier, unsigned char dcs) const
+    {
+      return (isSet(_messageIdentifiers, messageIdentifier) &&
+              (_anyDataCodingScheme || isSet(_dataCodingSchemes, dcs))) !=
+        _inverted;
+    }
+
+    // return true if the CB TPDU given in hexadecimal is accepted
+    // (TPDUs too short to contain the header are accepted and left to
+    // CBMessage to report)
+    bool accept(const std::string &pdu) const;
+  };
 };
 
 #endif // GSM_CB_H
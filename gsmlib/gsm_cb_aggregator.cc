@@ -0,0 +1,204 @@
+// *************************************************************************
+// * GSM TA/ME library
+// *
+// * File:    gsm_cb_aggregator.cc
+// *
+// * Purpose: Reassembly of multi-page cell broadcast messages and
+// *          suppression of repeated broadcasts (ETSI GSM 03.41)
+// *
+// * Created: 18.10.2026
+// *************************************************************************
+
+#ifdef HAVE_CONFIG_H
+#include <gsm_config.h>
+#endif
+#include <gsmlib/gsm_nls.h>
+#include <gsmlib/gsm_cb_aggregator.h>
+#include <sstream>
+
+using namespace gsmlib;
+
+// ReassembledCBM members
+
+std::string ReassembledCBM::getData() const
+{
+  std::string result;
+  for (std::vector<CBMessageRef>::const_iterator i = _pages.begin();
+       i != _pages.end(); ++i)
+    result += (*i)->getData();
+  return result;
+}
+
+std::string ReassembledCBM::toString() const
+{
+  if (_pages.size() == 1)
+    return firstPage()->toString();
+
+  // remove trailing \r characters (padding of the last page) for output
+  std::string data = getData();
+  std::string::size_type end = data.find_last_not_of('\r');
+  data.erase(end == std::string::npos ? 0 : end + 1);
+
+  CBMessageRef page = firstPage();
+  std::ostringstream os;
+  os << "------------------------------------------------------------"
+    "---------------" << std::endl
+     << _("Message type: CB") << std::endl
+     << _("Message Code: ") << page->getMessageCode() << std::endl
+     << _("Update Number: ") << page->getUpdateNumber() << std::endl
+     << _("Message Identifer: ") << page->getMessageIdentifier() << std::endl
+     << _("Data coding scheme: ") << page->getDataCodingScheme().toString()
+     << std::endl
+     << _("Pages: ") << _pages.size() << std::endl
+     << _("Data: '") << data << "'" << std::endl
+     << "------------------------------------------------------------"
+    "---------------" << std::endl << std::endl;
+  return os.str();
+}
+
+// CBAggregator members
+
+CBAggregator::CBAggregator(unsigned int timeout, unsigned int repeatPeriod,
+                           unsigned int maxMessages,
+                           unsigned int maxRepeats) :
+  _timeout(timeout), _repeatPeriod(repeatPeriod),
+  _maxMessages(maxMessages == 0 ? 1 : maxMessages),
+  _maxRepeats(maxRepeats == 0 ? 1 : maxRepeats)
+{
+}
+
+void CBAggregator::drop(std::map<Key, Partial>::iterator i)
+{
+  _partialList.erase(i->second._lru);
+  _partials.erase(i);
+}
+
+void CBAggregator::remember(const Key &key, time_t now)
+{
+  while (_seen.size() >= _maxRepeats)
+  {
+    _seen.erase(_seenList.front());
+    _seenList.pop_front();
+  }
+  Seen &seen = _seen[key];
+  seen._lastSeen = now;
+  seen._lru = _seenList.insert(_seenList.end(), key);
+}
+
+bool CBAggregator::add(CBMessageRef page, time_t now)
+{
+  if (now == 0)
+    now = time(NULL);
+  ++_statistics._pages;
+
+  Key key;
+  key._messageIdentifier = page->getMessageIdentifier();
+  key._serialNumber = page->getGeographicalScope() << 14 |
+    page->getMessageCode() << 4 | page->getUpdateNumber();
+
+  // repetition of a message that has already been returned
+  std::map<Key, Seen>::iterator s = _seen.find(key);
+  if (s != _seen.end())
+  {
+    ++_statistics._repeats;
+    s->second._lastSeen = now;
+    _seenList.splice(_seenList.end(), _seenList, s->second._lru);
+    return false;
+  }
+
+  // a page parameter of 0000 means one page (GSM 03.41 section 9.3.2.4)
+  unsigned int total = page->getTotalPageNumber();
+  unsigned int current = page->getCurrentPageNumber();
+  if (total == 0)
+    total = current = 1;
+  if (current == 0 || current > total)
+    return false;
+
+  if (total == 1)
+  {
+    ++_statistics._completed;
+    _ready.push_back(ReassembledCBM());
+    _ready.back()._pages.push_back(page);
+    remember(key, now);
+    return true;
+  }
+
+  std::map<Key, Partial>::iterator i = _partials.find(key);
+  if (i != _partials.end() && i->second._pages.size() != total)
+  {
+    // same serial number with a different number of pages, start again
+    drop(i);
+    i = _partials.end();
+  }
+  if (i == _partials.end())
+  {
+    // make room for a new partial message
+    while (_partials.size() >= _maxMessages)
+    {
+      ++_statistics._evicted;
+      drop(_partials.find(_partialList.front()));
+    }
+    i = _partials.insert(std::make_pair(key, Partial())).first;
+    i->second._pages.resize(total);
+    i->second._received = 0;
+    i->second._lru = _partialList.insert(_partialList.end(), key);
+  }
+  else
+    _partialList.splice(_partialList.end(), _partialList, i->second._lru);
+  Partial &partial = i->second;
+  partial._lastActivity = now;
+
+  CBMessageRef &p = partial._pages[current - 1];
+  if (! p.isnull())
+  {
+    ++_statistics._duplicates;
+    return false;
+  }
+  p = page;
+  if (++partial._received < total)
+    return false;
+
+  ++_statistics._completed;
+  _ready.push_back(ReassembledCBM());
+  _ready.back()._pages.swap(partial._pages);
+  drop(i);
+  remember(key, now);
+  return true;
+}
+
+void CBAggregator::expire(time_t now)
+{
+  if (now == 0)
+    now = time(NULL);
+
+  // least recently active partial messages come first
+  if (_timeout != 0)
+    while (! _partialList.empty())
+    {
+      std::map<Key, Partial>::iterator i =
+        _partials.find(_partialList.front());
+      if (now - i->second._lastActivity < (time_t)_timeout)
+        break;
+      ++_statistics._expired;
+      drop(i);
+    }
+
+  if (_repeatPeriod != 0)
+    while (! _seenList.empty())
+    {
+      std::map<Key, Seen>::iterator i = _seen.find(_seenList.front());
+      if (now - i->second._lastSeen < (time_t)_repeatPeriod)
+        break;
+      _seen.erase(i);
+      _seenList.pop_front();
+    }
+}
+
+bool CBAggregator::next(ReassembledCBM &message)
+{
+  if (_ready.empty())
+    return false;
+  message = _ready.front();
+  _ready.pop_front();
+  return true;
+}
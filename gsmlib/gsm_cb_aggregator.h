@@ -0,0 +1,149 @@
+// *************************************************************************
+// * GSM TA/ME library
+// *
+// * File:    gsm_cb_aggregator.h
+// *
+// * Purpose: Reassembly of multi-page cell broadcast messages and
+// *          suppression of repeated broadcasts (ETSI GSM 03.41)
+// *
+// * Created: 18.10.2026
+// *************************************************************************
+
+#ifndef GSM_CB_AGGREGATOR_H
+#define GSM_CB_AGGREGATOR_H
+
+#include <gsmlib/gsm_cb.h>
+#include <gsmlib/gsm_util.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <list>
+#include <map>
+#include <time.h>
+
+namespace gsmlib
+{
+  // cell broadcast message consisting of all its pages
+  struct ReassembledCBM
+  {
+    std::vector<CBMessageRef> _pages; // pages in page number order
+
+    // return first page (carries message identifier, serial number
+    // and data coding scheme)
+    CBMessageRef firstPage() const {return _pages.front();}
+
+    // return data of all pages
+    std::string getData() const;
+
+    // create textual representation
+    std::string toString() const;
+  };
+
+  // Collects the pages of cell broadcast messages and returns each
+  // message once when all its pages have been received. Messages are
+  // identified by message identifier and serial number (geographical
+  // scope, message code and update number). The network repeats
+  // broadcasts periodically: pages missing from one repetition are
+  // taken from the next one, and repetitions of a message that has
+  // already been returned are dropped for repeatPeriod seconds after
+  // the last repetition was seen. Partial messages without a new page
+  // for timeout seconds are dropped by expire(). At most maxMessages
+  // partial messages and maxRepeats returned messages are remembered,
+  // the least recently active ones are forgotten first.
+
+  class CBAggregator : public NoCopy
+  {
+  public:
+    // statistics
+    struct Statistics
+    {
+      unsigned long _pages;     // pages added
+      unsigned long _duplicates; // pages of partial messages already present
+      unsigned long _repeats;   // pages of messages already returned
+      unsigned long _completed; // messages returned
+      unsigned long _expired;   // partial messages dropped after timeout
+      unsigned long _evicted;   // partial messages dropped due to limits
+
+      Statistics() : _pages(0), _duplicates(0), _repeats(0), _completed(0),
+        _expired(0), _evicted(0) {}
+    };
+
+  private:
+    // identification of a CB message
+    struct Key
+    {
+      int _messageIdentifier;
+      int _serialNumber;        // geographical scope, message code,
+                                // update number as in the CB TPDU
+
+      bool operator<(const Key &k) const
+      {
+        return _messageIdentifier < k._messageIdentifier ||
+          (_messageIdentifier == k._messageIdentifier &&
+           _serialNumber < k._serialNumber);
+      }
+    };
+
+    // partial message
+    struct Partial
+    {
+      std::vector<CBMessageRef> _pages;
+      unsigned int _received;   // number of pages received
+      time_t _lastActivity;     // time last page was added
+      std::list<Key>::iterator _lru; // position in _partialList
+    };
+
+    // message that has been returned
+    struct Seen
+    {
+      time_t _lastSeen;         // time a page was last received
+      std::list<Key>::iterator _lru; // position in _seenList
+    };
+
+    unsigned int _timeout;
+    unsigned int _repeatPeriod;
+    unsigned int _maxMessages;
+    unsigned int _maxRepeats;
+    std::map<Key, Partial> _partials;
+    std::list<Key> _partialList; // least recently active first
+    std::map<Key, Seen> _seen;
+    std::list<Key> _seenList;   // least recently seen first
+    std::deque<ReassembledCBM> _ready;
+    Statistics _statistics;
+
+    // drop partial message i
+    void drop(std::map<Key, Partial>::iterator i);
+
+    // remember returned message key
+    void remember(const Key &key, time_t now);
+
+  public:
+    CBAggregator(unsigned int timeout = 600,
+                 unsigned int repeatPeriod = 24 * 3600,
+                 unsigned int maxMessages = 64,
+                 unsigned int maxRepeats = 1024);
+
+    // add received CB page, return true if a message is ready to be
+    // retrieved with next()
+    // now is the current time (0 = time(NULL))
+    bool add(CBMessageRef page, time_t now = 0);
+
+    // drop partial messages that have timed out and forget returned
+    // messages that have not been repeated within the repeat period
+    void expire(time_t now = 0);
+
+    // return next complete message, false if none
+    bool next(ReassembledCBM &message);
+
+    // number of messages ready to be retrieved
+    unsigned int ready() const {return _ready.size();}
+
+    // number of partial messages and of remembered returned messages
+    unsigned int pendingMessages() const {return _partials.size();}
+    unsigned int rememberedMessages() const {return _seen.size();}
+
+    const Statistics &statistics() const {return _statistics;}
+  };
+};
+
+#endif // GSM_CB_AGGREGATOR_H
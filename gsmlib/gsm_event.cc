@@ -115,6 +115,10 @@ void GsmEvent::dispatch(std::string s, GsmAt &at) throw(GsmException)
       // handle CB message
       std::string pdu = at.getLine();
 
+      // drop channels the ME should not have routed to the TA
+      if (! at.getMeTa().getCBChannelFilter().accept(pdu))
+        return;
+
       CBMessageRef cb = new CBMessage(pdu);
 
       // call the event handler
@@ -15,6 +15,8 @@
 #define GSM_MAP_KEY_H
 
 #include <gsmlib/gsm_sms_codec.h>
+#include <gsmlib/gsm_util.h>
+#include <string>
 
 namespace gsmlib
 {
@@ -23,45 +25,104 @@ namespace gsmlib
   enum SortOrder {ByText = 0, ByTelephone = 1, ByIndex = 2, ByDate = 3,
                   ByType = 4, ByAddress = 5};
 
-  // wrapper for map key, can access Sortedtore to get sortOrder()
+  // aux functions for the keys of the different sort orders
+
+  // return timestamp packed into a number that sorts like
+  // operator<(Timestamp, Timestamp), ie. ignoring the time zone
+  // (all fields but the year are two BCD digits and fit into a byte)
+  inline unsigned_int_8 timestampKey(const Timestamp &t)
+  {
+    return (unsigned_int_8)(unsigned short)(t._year + 0x8000) << 40 |
+      (unsigned_int_8)(t._month & 0xff) << 32 |
+      (unsigned_int_8)(t._day & 0xff) << 24 | (t._hour & 0xff) << 16 |
+      (t._minute & 0xff) << 8 | (t._seconds & 0xff);
+  }
+
+  // compare normalized telephone numbers ("+" prepended to international
+  // numbers) like operator<(Address, Address), ie. as if the shorter
+  // number was padded with 0s
+  inline int compareTelephoneKeys(const std::string &x, const std::string &y)
+  {
+    std::string::size_type n = x.length() < y.length() ?
+      x.length() : y.length();
+    int c = x.compare(0, n, y, 0, n);
+    if (c != 0)
+      return c;
+    for (std::string::size_type i = n; i < x.length(); ++i)
+      if (x[i] != '0')
+        return (unsigned char)x[i] < '0' ? -1 : 1;
+    for (std::string::size_type i = n; i < y.length(); ++i)
+      if (y[i] != '0')
+        return (unsigned char)y[i] < '0' ? 1 : -1;
+    return 0;
+  }
+
+  // wrapper for map key, compares according to the sort order of the
+  // store at construction time or the given sort order (for maps of
+  // other sort orders kept by the store)
+  // only the key for the sort order is set:
+  // - ByText: _strKey
+  // - ByTelephone, ByAddress: _strKey is the normalized number, _intKey
+  //   the numbering plan (shifted left by one) and bit 0 set if the number
+  //   is international (so that the "+" is not part of the number)
+  // - ByDate: _intKey is the packed timestamp (see timestampKey())
+  // - ByIndex, ByType: _intKey is the number (offset to sort unsigned)
 
   template <class SortedStore> class MapKey
   {
   public:
-    SortedStore &_myStore;   // my store
-    // different type keys
-    Address _addressKey;
-    Timestamp _timeKey;
-    int _intKey;
+    SortedStore *_myStore;   // my store
+    SortOrder _sortOrder;
     std::string _strKey;
+    unsigned_int_8 _intKey;
+
+  private:
+    void set(const Address &key)
+      {
+        bool international = key._type == Address::International;
+        _strKey = international ? "+" + key._number : key._number;
+        _intKey = (unsigned_int_8)key._plan << 1 | international;
+      }
+    // key is a telephone number if sorted ByTelephone,
+    // (like for Address(std::string)) a text otherwise
+    void set(const std::string &key)
+      {
+        if (_sortOrder == ByTelephone)
+        {
+          _strKey = removeWhiteSpace(key);
+          _intKey = (unsigned_int_8)Address::ISDN_Telephone << 1 |
+            (_strKey.length() > 0 && _strKey[0] == '+');
+        }
+        else
+          _strKey = key;
+      }
 
   public:
     // constructors for the different sort keys
-    MapKey(SortedStore &myStore, Address key) :
-      _myStore(myStore), _addressKey(key) {}
-    MapKey(SortedStore &myStore, Timestamp key) :
-      _myStore(myStore), _timeKey(key) {}
+    MapKey(SortedStore &myStore, const Address &key) :
+      _myStore(&myStore), _sortOrder(myStore.sortOrder()) {set(key);}
+    MapKey(SortedStore &myStore, const Timestamp &key) :
+      _myStore(&myStore), _sortOrder(myStore.sortOrder()),
+      _intKey(timestampKey(key)) {}
     MapKey(SortedStore &myStore, int key) :
-      _myStore(myStore), _intKey(key) {}
-    MapKey(SortedStore &myStore, std::string key) :
-      _myStore(myStore), _strKey(key) {}
-
-/*
-    friend
-    bool operator< 
-#ifndef WIN32
-	<>
-#endif
-	                 (const MapKey<SortedStore> &x,
-                      const MapKey<SortedStore> &y);
-    friend
-    bool operator==
-#ifndef WIN32
-	<>
-#endif
-	                  (const MapKey<SortedStore> &x,
-                       const MapKey<SortedStore> &y);
-*/
+      _myStore(&myStore), _sortOrder(myStore.sortOrder()),
+      _intKey((unsigned int)key ^ 0x80000000U) {}
+    MapKey(SortedStore &myStore, const std::string &key) :
+      _myStore(&myStore), _sortOrder(myStore.sortOrder()), _intKey(0)
+      {set(key);}
+
+    // constructors for the different sort keys and a given sort order
+    MapKey(SortedStore &myStore, SortOrder sortOrder, const Address &key) :
+      _myStore(&myStore), _sortOrder(sortOrder) {set(key);}
+    MapKey(SortedStore &myStore, SortOrder sortOrder,
+           const Timestamp &key) :
+      _myStore(&myStore), _sortOrder(sortOrder), _intKey(timestampKey(key)) {}
+    MapKey(SortedStore &myStore, SortOrder sortOrder, int key) :
+      _myStore(&myStore), _sortOrder(sortOrder),
+      _intKey((unsigned int)key ^ 0x80000000U) {}
+    MapKey(SortedStore &myStore, SortOrder sortOrder,
+           const std::string &key) :
+      _myStore(&myStore), _sortOrder(sortOrder), _intKey(0) {set(key);}
   };
 
   // compare two keys
@@ -71,6 +132,21 @@ namespace gsmlib
   template <class SortedStore>
     extern bool operator==(const MapKey<SortedStore> &x,
                            const MapKey<SortedStore> &y);
+
+  // remove value stored under key from a multimap with MapKeys
+  template <class Map>
+    void eraseMapValue(Map &map, const typename Map::key_type &key,
+                       const typename Map::mapped_type &value)
+    {
+      std::pair<typename Map::iterator, typename Map::iterator> range =
+        map.equal_range(key);
+      for (; range.first != range.second; ++range.first)
+        if (range.first->second == value)
+        {
+          map.erase(range.first);
+          return;
+        }
+    }
   
   // MapKey members
   
@@ -78,19 +154,17 @@ namespace gsmlib
     bool operator<(const MapKey<SortedStore> &x,
                            const MapKey<SortedStore> &y)
     {
-      assert(&x._myStore == &y._myStore);
+      assert(x._myStore == y._myStore && x._sortOrder == y._sortOrder);
 
-      switch (x._myStore.sortOrder())
+      switch (x._sortOrder)
       {
       case ByDate:
-        return x._timeKey < y._timeKey;
-      case ByAddress:
-        return x._addressKey < y._addressKey;
       case ByIndex:
       case ByType:
         return x._intKey < y._intKey;
+      case ByAddress:
       case ByTelephone:
-        return Address(x._strKey) < Address(y._strKey);
+        return compareTelephoneKeys(x._strKey, y._strKey) < 0;
       case ByText:
         return x._strKey < y._strKey;
       default:
@@ -103,19 +177,23 @@ namespace gsmlib
     bool operator==(const MapKey<SortedStore> &x,
                             const MapKey<SortedStore> &y)
     {
-      assert(&x._myStore == &y._myStore);
+      assert(x._myStore == y._myStore && x._sortOrder == y._sortOrder);
 
-      switch (x._myStore.sortOrder())
+      switch (x._sortOrder)
       {
       case ByDate:
-        return x._timeKey == y._timeKey;
-      case ByAddress:
-        return x._addressKey == y._addressKey;
       case ByIndex:
       case ByType:
         return x._intKey == y._intKey;
+      case ByAddress:
       case ByTelephone:
-        return Address(x._strKey) == Address(y._strKey);
+      {
+        // like operator==(Address, Address): same plan and number
+        std::string::size_type xstart = x._intKey & 1, ystart = y._intKey & 1;
+        return x._intKey >> 1 == y._intKey >> 1 &&
+          x._strKey.compare(xstart, std::string::npos,
+                            y._strKey, ystart, std::string::npos) == 0;
+      }
       case ByText:
         return x._strKey == y._strKey;
       default:
@@ -20,6 +20,10 @@
 #include <gsmlib/gsm_sysdep.h>
 #include <algorithm>
 #include <cstdlib>
+#include <deque>
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+#endif
 
 using namespace gsmlib;
 
@@ -34,7 +38,9 @@ Capabilities::Capabilities() :
   _wrongSMSStatusCode(false),   // Motorola Timeport 260
   _CDSmeansCDSI(false),         // Nokia Cellular Card Phone RPE-1 GSM900 and
                                 // Nokia Card Phone RPM-1 GSM900/1800
-  _sendAck(false)               // send ack for directly routed SMS
+  _sendAck(false),              // send ack for directly routed SMS
+  _maxCMMSMode(-1)              // initialize to -1, must be set later by
+                                // beginSMSBurst() function
 {
 }
 
@@ -116,7 +122,9 @@ void MeTa::init() throw(GsmException)
   _at->setEventHandler(&_defaultEventHandler);
 }
 
-MeTa::MeTa(Ref<Port> port) throw(GsmException) : _port(port)
+MeTa::MeTa(Ref<Port> port) throw(GsmException) :
+  _port(port), _smsBurstDepth(0), _savedCMMSMode(NOT_SET),
+  _cbChannelFilter(true)
 {
   // initialize AT handling
   _at = new GsmAt(*this);
@@ -946,63 +954,458 @@ void MeTa::sendSMSs(Ref<SMSSubmitMessage> smsTemplate, std::string text,
 {
   assert(! smsTemplate.isnull());
 
-  // compute maximum text length for normal SMSs and concatenated SMSs
-  unsigned int maxTextLength, concMaxTextLength;
-  switch (smsTemplate->dataCodingScheme().getAlphabet())
-  {
-  case DCS_DEFAULT_ALPHABET:
-    maxTextLength = 160;
-    concMaxTextLength = 152;
-    break;
-  case DCS_EIGHT_BIT_ALPHABET:
-    maxTextLength = 140;
-    concMaxTextLength = 134;
-    break;
-  case DCS_SIXTEEN_BIT_ALPHABET:
-    maxTextLength = 70;
-    concMaxTextLength = 67;
-    break;
-  default:
-    throw GsmException(_("unsupported alphabet for SMS"),
+  // keep the information elements of the template (eg. port addressing)
+  // except the ones the segments add: concatenation (8-bit and 16-bit
+  // reference) and national language shift tables
+  static const unsigned char segmentIEs[] = {0x00, 0x08, 0x24, 0x25};
+  UserDataHeader header = smsTemplate->userDataHeader();
+  for (unsigned int i = 0; i < sizeof(segmentIEs); ++i)
+    header.removeIE(segmentIEs[i]);
+
+  // references beyond 255 need the 16-bit concatenation element
+  SMSTextSegments segments =
+    segmentSMSUserData(text, smsTemplate->dataCodingScheme().getAlphabet(),
+                       concatenatedMessageId != -1,
+                       concatenatedMessageId > 255, header);
+  if (oneSMS && segments.size() > 1)
+    throw GsmException(_("SMS text is larger than allowed"),
                        ParameterError);
-    break;
+  sendSMSs(smsTemplate, segments, concatenatedMessageId);
+}
+
+// return data coding scheme dcs with the alphabet replaced
+static DataCodingScheme setAlphabet(DataCodingScheme dcs,
+                                    unsigned char alphabet)
+{
+  // general data coding group: keep message class, no compression
+  if ((dcs & 0xc0) == 0)
+    return DataCodingScheme((dcs & ~(DCS_COMPRESSED | DCS_RESERVED_ALPHABET)) |
+                            alphabet);
+  return DataCodingScheme(alphabet);
+}
+
+void MeTa::sendSMSs(Ref<SMSSubmitMessage> smsTemplate,
+                    const SMSTextSegments &segments,
+                    int concatenatedMessageId)
+  throw(GsmException)
+{
+  assert(! smsTemplate.isnull());
+
+  if (! segments._concatenated && concatenatedMessageId != -1 &&
+      segments.size() > 1)
+    throw GsmException(_("SMS segments leave no room for concatenation"),
+                       ParameterError);
+  if (concatenatedMessageId < -1 ||
+      concatenatedMessageId > (segments._sixteenBitReference ? 65535 : 255))
+    throw GsmException(stringPrintf(_("invalid concatenated message ID %d"),
+                                    concatenatedMessageId),
+                       ParameterError);
+  smsTemplate->setDataCodingScheme(
+    setAlphabet(smsTemplate->dataCodingScheme(), segments._alphabet));
+
+  // keep the link to the SMSC open between the parts
+  if (segments.size() > 1)
+    beginSMSBurst();
+  try
+  {
+    for (unsigned int i = 0; i < segments.size(); ++i)
+    {
+      smsTemplate->setUserDataHeader(
+        segments.userDataHeader(i, concatenatedMessageId));
+      if (segments._alphabet == DCS_DEFAULT_ALPHABET)
+        smsTemplate->setUserDataSeptets(segments._userData[i]);
+      else
+        smsTemplate->setUserData(segments._userData[i]);
+      sendSMS(smsTemplate);
+    }
+  }
+  catch (GsmException &)
+  {
+    // an error ending the burst must not replace the send error
+    if (segments.size() > 1)
+      try
+      {
+        endSMSBurst();
+      }
+      catch (GsmException &)
+      {
+      }
+    throw;
+  }
+  if (segments.size() > 1)
+    endSMSBurst();
+}
+
+void MeTa::sendSMSs(const std::vector<Ref<SMSSubmitMessage> > &smsMessages)
+  throw(GsmException)
+{
+  if (smsMessages.size() == 0)
+    return;
+
+  beginSMSBurst();
+  try
+  {
+    for (std::vector<Ref<SMSSubmitMessage> >::const_iterator i =
+           smsMessages.begin(); i != smsMessages.end(); ++i)
+      sendSMS(*i);
+  }
+  catch (GsmException &)
+  {
+    // an error ending the burst must not replace the send error
+    try
+    {
+      endSMSBurst();
+    }
+    catch (GsmException &)
+    {
+    }
+    throw;
+  }
+  endSMSBurst();
+}
+
+// auxiliary types and functions for MeTa::sendSMSBatch()
+
+// get current time
+static void getCurrentTime(struct timeval &t)
+{
+#ifdef WIN32
+  DWORD ticks = GetTickCount();
+  t.tv_sec = ticks / 1000;
+  t.tv_usec = (ticks % 1000) * 1000;
+#else
+  gettimeofday(&t, NULL);
+#endif
+}
+
+// return microseconds passed since start
+static long elapsedTime(const struct timeval &start)
+{
+  struct timeval now;
+  getCurrentTime(now);
+  return (now.tv_sec - start.tv_sec) * 1000000L +
+    (now.tv_usec - start.tv_usec);
+}
+
+// PDU handed over from the encoder to the sender
+struct EncodedSMS
+{
+  bool _end;                    // no more messages
+  std::string _pdu;             // hexadecimal PDU, empty on error
+  std::string _error;           // error text
+  GsmErrorClass _errorClass;    // error class if _error is set
+  long _encodeTime;             // time spent encoding (microseconds)
+
+  EncodedSMS() : _end(false), _errorClass(OtherError), _encodeTime(0) {}
+};
+
+// fetch and encode the next message from generator
+// errors from the generator end the batch
+static EncodedSMS encodeNextSMS(SMSSubmitGenerator &generator)
+{
+  EncodedSMS result;
+  Ref<SMSSubmitMessage> message;
+  try
+  {
+    message = generator.next();
+  }
+  catch (GsmException &e)
+  {
+    result._end = true;
+    result._error = e.what();
+    result._errorClass = e.getErrorClass();
+    return result;
+  }
+  if (message.isnull())
+  {
+    result._end = true;
+    return result;
+  }
+
+  struct timeval start;
+  getCurrentTime(start);
+  try
+  {
+    result._pdu = message->encode();
+  }
+  catch (GsmException &e)
+  {
+    result._error = e.what();
+    result._errorClass = e.getErrorClass();
+  }
+  result._encodeTime = elapsedTime(start);
+  return result;
+}
+
+// encodes messages from the generator ahead of the sender
+// without thread support messages are encoded on demand by next()
+class SMSEncoderPipeline
+{
+  SMSSubmitGenerator &_generator;
+#ifdef HAVE_LIBPTHREAD
+  unsigned int _lookahead;
+  bool _threadRunning;
+  bool _stop;                   // tell encoder thread to stop
+  std::deque<EncodedSMS> _queue; // encoded PDUs not yet sent
+  pthread_mutex_t _mutex;       // protects _queue and _stop
+  pthread_cond_t _changed;      // signalled whenever _queue or _stop change
+  pthread_t _thread;
+
+  static void *run(void *pipeline);
+#endif
+
+public:
+  SMSEncoderPipeline(SMSSubmitGenerator &generator, unsigned int lookahead);
+
+  // return next encoded message
+  EncodedSMS next();
+
+  ~SMSEncoderPipeline();
+};
+
+#ifdef HAVE_LIBPTHREAD
+void *SMSEncoderPipeline::run(void *pipeline)
+{
+  SMSEncoderPipeline &p = *(SMSEncoderPipeline*)pipeline;
+  while (true)
+  {
+    pthread_mutex_lock(&p._mutex);
+    while (p._queue.size() >= p._lookahead && ! p._stop)
+      pthread_cond_wait(&p._changed, &p._mutex);
+    bool stop = p._stop;
+    pthread_mutex_unlock(&p._mutex);
+    if (stop)
+      break;
+
+    EncodedSMS e = encodeNextSMS(p._generator);
+
+    pthread_mutex_lock(&p._mutex);
+    p._queue.push_back(e);
+    pthread_cond_broadcast(&p._changed);
+    pthread_mutex_unlock(&p._mutex);
+    if (e._end)
+      break;
+  }
+  return NULL;
+}
+
+SMSEncoderPipeline::SMSEncoderPipeline(SMSSubmitGenerator &generator,
+                                       unsigned int lookahead) :
+  _generator(generator), _lookahead(lookahead), _threadRunning(false),
+  _stop(false)
+{
+  if (_lookahead > 0)
+  {
+    pthread_mutex_init(&_mutex, NULL);
+    pthread_cond_init(&_changed, NULL);
+    // fall back to encoding on demand if no thread can be created
+    _threadRunning = pthread_create(&_thread, NULL, run, this) == 0;
+    if (! _threadRunning)
+    {
+      pthread_cond_destroy(&_changed);
+      pthread_mutex_destroy(&_mutex);
+    }
   }
+}
 
-  // simple case, only send one SMS
-  if (oneSMS || text.length() <= maxTextLength)
+EncodedSMS SMSEncoderPipeline::next()
+{
+  if (! _threadRunning)
+    return encodeNextSMS(_generator);
+
+  pthread_mutex_lock(&_mutex);
+  while (_queue.empty())
+    pthread_cond_wait(&_changed, &_mutex);
+  EncodedSMS result = _queue.front();
+  _queue.pop_front();
+  pthread_cond_broadcast(&_changed);
+  pthread_mutex_unlock(&_mutex);
+  return result;
+}
+
+SMSEncoderPipeline::~SMSEncoderPipeline()
+{
+  if (_threadRunning)
   {
-    if (text.length() > maxTextLength)
-      throw GsmException(_("SMS text is larger than allowed"),
-                         ParameterError);
-    smsTemplate->setUserData(text);
-    sendSMS(smsTemplate);
+    pthread_mutex_lock(&_mutex);
+    _stop = true;
+    pthread_cond_broadcast(&_changed);
+    pthread_mutex_unlock(&_mutex);
+    pthread_join(_thread, NULL);
+    pthread_cond_destroy(&_changed);
+    pthread_mutex_destroy(&_mutex);
   }
-  else                          // send multiple SMSs
+}
+#else
+SMSEncoderPipeline::SMSEncoderPipeline(SMSSubmitGenerator &generator,
+                                       unsigned int lookahead) :
+  _generator(generator)
+{
+}
+
+EncodedSMS SMSEncoderPipeline::next()
+{
+  return encodeNextSMS(_generator);
+}
+
+SMSEncoderPipeline::~SMSEncoderPipeline()
+{
+}
+#endif
+
+// generator for a vector of messages
+class SMSVectorGenerator : public SMSSubmitGenerator
+{
+  const std::vector<Ref<SMSSubmitMessage> > &_messages;
+  unsigned int _next;
+
+public:
+  SMSVectorGenerator(const std::vector<Ref<SMSSubmitMessage> > &messages) :
+    _messages(messages), _next(0) {}
+
+  Ref<SMSSubmitMessage> next() throw(GsmException)
   {
-    if (concatenatedMessageId != -1)
-      maxTextLength = concMaxTextLength;
-
-    int numMessages = (text.length() + maxTextLength - 1) / maxTextLength;
-    if (numMessages > 255)
-      throw GsmException(_("not more than 255 concatenated SMSs allowed"),
-                         ParameterError);
-    unsigned char numMessage = 0;
+    if (_next == _messages.size())
+      return Ref<SMSSubmitMessage>();
+    return _messages[_next++];
+  }
+};
+
+std::vector<SMSSendResult>
+MeTa::sendSMSBatch(SMSSubmitGenerator &generator, unsigned int lookahead)
+  throw(GsmException)
+{
+  std::vector<SMSSendResult> result;
+
+  beginSMSBurst();
+  try
+  {
+    SMSEncoderPipeline encoder(generator, lookahead);
     while (true)
     {
-      if (concatenatedMessageId != -1)
+      EncodedSMS e = encoder.next();
+      if (e._end)
       {
-        unsigned char udhs[] = {0x00, 0x03, concatenatedMessageId,
-                                numMessages, ++numMessage};
-        UserDataHeader udh(std::string((char*)udhs, 5));
-        smsTemplate->setUserDataHeader(udh);
-      }
-      smsTemplate->setUserData(text.substr(0, maxTextLength));
-      sendSMS(smsTemplate);
-      if (text.length() < maxTextLength)
+        if (e._error.length() > 0)
+          throw GsmException(e._error, e._errorClass);
         break;
-      text.erase(0, maxTextLength);
+      }
+
+      SMSSendResult r;
+      r._encodeTime = e._encodeTime;
+      if (e._pdu.length() == 0)
+        r._error = e._error;
+      else
+      {
+        struct timeval start;
+        getCurrentTime(start);
+        try
+        {
+          r._messageReference = SMSMessage::send(_at, e._pdu, r._ackPdu);
+          r._sent = true;
+        }
+        catch (GsmException &ge)
+        {
+          // message rejected by ME/TA or network, go on with the next one
+          if (ge.getErrorClass() != ChatError)
+            throw;
+          r._error = ge.what();
+        }
+        r._sendTime = elapsedTime(start);
+      }
+      result.push_back(r);
+    }
+  }
+  catch (GsmException &)
+  {
+    // an error ending the burst must not replace the send error
+    try
+    {
+      endSMSBurst();
+    }
+    catch (GsmException &)
+    {
     }
+    throw;
   }
+  endSMSBurst();
+  return result;
+}
+
+std::vector<SMSSendResult>
+MeTa::sendSMSBatch(const std::vector<Ref<SMSSubmitMessage> > &smsMessages,
+                   unsigned int lookahead) throw(GsmException)
+{
+  SMSVectorGenerator generator(smsMessages);
+  return sendSMSBatch(generator, lookahead);
+}
+
+int MeTa::getMoreMessagesToSend() throw(GsmException)
+{
+  Parser p(_at->chat("+CMMS?", "+CMMS:"));
+  return p.parseInt();
+}
+
+void MeTa::setMoreMessagesToSend(int mode) throw(GsmException)
+{
+  if (mode < 0 || mode > 2)
+    throw GsmException(_("only more messages to send mode 0, 1, or 2 "
+                         "supported"), ParameterError);
+  _at->chat("+CMMS=" + intToStr(mode));
+}
+
+void MeTa::beginSMSBurst(bool permanent) throw(GsmException)
+{
+  if (_smsBurstDepth == 0)
+  {
+    // find out once which +CMMS modes are supported
+    // many older devices don't know +CMMS at all
+    if (_capabilities._maxCMMSMode == -1)
+    {
+      _capabilities._maxCMMSMode = 0;
+      try
+      {
+        Parser p(_at->chat("+CMMS=?", "+CMMS:", true));
+        std::vector<bool> modes = p.parseIntList();
+        for (int mode = 2; mode > 0; --mode)
+          if (isSet(modes, mode))
+          {
+            _capabilities._maxCMMSMode = mode;
+            break;
+          }
+      }
+      catch (GsmException &e)
+      {
+        if (e.getErrorClass() != ParserError)
+          throw;
+      }
+    }
+
+    if (_capabilities._maxCMMSMode > 0)
+    {
+      int mode = (permanent && _capabilities._maxCMMSMode >= 2) ? 2 : 1;
+      int previousMode = getMoreMessagesToSend();
+      if (previousMode < mode)
+      {
+        setMoreMessagesToSend(mode);
+        _savedCMMSMode = previousMode;
+      }
+    }
+  }
+  ++_smsBurstDepth;
+}
+
+void MeTa::endSMSBurst() throw(GsmException)
+{
+  assert(_smsBurstDepth > 0);
+  if (--_smsBurstDepth > 0 || _savedCMMSMode == NOT_SET)
+    return;
+
+  // restore previous setting, this also closes the relay link
+  // right away instead of waiting for the link timeout
+  int mode = _savedCMMSMode;
+  _savedCMMSMode = NOT_SET;
+  setMoreMessagesToSend(mode);
 }
 
 void MeTa::setMessageService(int serviceLevel) throw(GsmException)
@@ -1231,6 +1634,43 @@ void MeTa::setSMSRoutingToTA(bool enableSMS, bool enableCBS,
   _at->chat("+CNMI=" + chatString);
 }
 
+void MeTa::setCBChannels(const CBChannelFilter &filter, bool setInME)
+  throw(GsmException)
+{
+  if (setInME)
+  {
+    std::string chatString = std::string("+CSCB=") +
+      (filter.inverted() ? "1" : "0") + ",\"" +
+      filter.messageIdentifierRanges() + "\"";
+    std::string dcss = filter.dataCodingSchemeRanges();
+    if (dcss != "")
+      chatString += ",\"" + dcss + "\"";
+    _at->chat(chatString);
+  }
+  _cbChannelFilter = filter;
+}
+
+CBChannelFilter MeTa::getCBChannels() throw(GsmException)
+{
+  Parser p(_at->chat("+CSCB?", "+CSCB:"));
+  int mode = p.parseInt();
+  CBChannelFilter result;
+  if (p.parseComma(true))
+  {
+    result.addMessageIdentifiers(p.parseString(true));
+    if (p.parseComma(true))
+    {
+      std::string dcss = p.parseString(true);
+      if (dcss != "")
+        result.addDataCodingSchemes(dcss);
+    }
+  }
+  // mode 1: the given message identifiers are not accepted
+  if (mode == 1)
+    result.invert();
+  return result;
+}
+
 bool MeTa::getCallWaitingLockStatus(FacilityClass cl)
   throw(GsmException)
 {
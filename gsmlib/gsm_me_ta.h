@@ -38,6 +38,8 @@ namespace gsmlib
     bool _wrongSMSStatusCode;   // Motorola Timeport 260
     bool _CDSmeansCDSI;         // Nokia Cellular Card Phone RPE-1 GSM900
     bool _sendAck;              // send ack for directly routed SMS
+    int _maxCMMSMode;           // highest supported +CMMS mode, 0 if
+                                // not supported, -1 until first SMS burst
     Capabilities();             // constructor, set default behaviours
   };
   
@@ -105,6 +107,31 @@ namespace gsmlib
     ForwardReason _reason;      // reason for the forwarding
   };
 
+  // result of sending one message with MeTa::sendSMSBatch()
+  struct SMSSendResult
+  {
+    bool _sent;                 // true if accepted by the ME/TA
+    int _messageReference;      // message reference (+CMGS), or NOT_SET
+    SMSMessageRef _ackPdu;      // ACK-PDU if requested (see +CSMS)
+    std::string _error;         // error text if not sent
+    long _encodeTime;           // time spent encoding (microseconds)
+    long _sendTime;             // time spent in +CMGS (microseconds)
+
+    SMSSendResult() : _sent(false), _messageReference(NOT_SET),
+      _encodeTime(0), _sendTime(0) {}
+  };
+
+  // source of messages for MeTa::sendSMSBatch()
+  // next() returns an empty reference if there are no more messages
+  // next() may be called from another thread while the MeTa object
+  // is busy sending, so it must not use the MeTa object itself
+  class SMSSubmitGenerator
+  {
+  public:
+    virtual Ref<SMSSubmitMessage> next() throw(GsmException) = 0;
+    virtual ~SMSSubmitGenerator() {}
+  };
+
   // SMS types
   typedef Ref<SMSStore> SMSStoreRef;
   typedef std::vector<SMSStoreRef> SMSStoreVector;
@@ -127,6 +154,10 @@ namespace gsmlib
     GsmEvent _defaultEventHandler; // default event handler
                                 // see comments in MeTa::init()
     std::string _lastCharSet;        // remember last character set
+    int _smsBurstDepth;         // nesting depth of beginSMSBurst()
+    int _savedCMMSMode;         // +CMMS mode to restore at end of burst
+                                // NOT_SET if nothing to restore
+    CBChannelFilter _cbChannelFilter; // filter for incoming CB messages
 
     // init ME/TA to sensible defaults
     void init() throw(GsmException);
@@ -346,12 +377,65 @@ namespace gsmlib
     // If oneSMS is true, only one SMS is sent. Otherwise several SMSs
     // are sent. If concatenatedMessageId is != -1 this is used as the message
     // ID for concatenated SMS (for this a user data header as defined in
-    // GSM GTS 3.40 is used, the old UDH in the template is overwritten).
+    // GSM GTS 3.40 is used). Other information elements of the UDH in
+    // the template (eg. port addressing) are sent in every SMS, old
+    // concatenation and national language shift elements are replaced.
+    // IDs above 255 are sent with a 16-bit reference (up to 65535).
     void sendSMSs(Ref<SMSSubmitMessage> smsTemplate, std::string text,
                   bool oneSMS = false,
                   int concatenatedMessageId = -1)
       throw(GsmException);
 
+    // send text that has been split by segmentSMSText() (the number of
+    // SMSs is known beforehand from segments.size())
+    // concatenatedMessageId may be up to 65535 if the segments were
+    // created for 16-bit references (see SMSReferenceAllocator)
+    // As above only the userData, userDataHeader and the alphabet of the
+    // data coding scheme of the template are changed. The UDH of the
+    // template is replaced by the one of the segments (see the header
+    // argument of segmentSMSText()). The national language shift tables
+    // are indicated in the user data header.
+    void sendSMSs(Ref<SMSSubmitMessage> smsTemplate,
+                  const SMSTextSegments &segments,
+                  int concatenatedMessageId = -1)
+      throw(GsmException);
+
+    // send several SMS messages in one burst (see beginSMSBurst())
+    void sendSMSs(const std::vector<Ref<SMSSubmitMessage> > &smsMessages)
+      throw(GsmException);
+
+    // send a batch of SMS messages in one burst, return one result per
+    // message in the same order
+    // while a message is sent the PDUs of up to lookahead following
+    // messages are encoded on a separate thread (if available),
+    // lookahead 0 encodes each message just before sending it
+    // messages rejected by the ME/TA or that cannot be encoded are
+    // reported in the result, other errors abort the batch
+    std::vector<SMSSendResult> sendSMSBatch(SMSSubmitGenerator &generator,
+                                            unsigned int lookahead = 4)
+      throw(GsmException);
+    std::vector<SMSSendResult>
+    sendSMSBatch(const std::vector<Ref<SMSSubmitMessage> > &smsMessages,
+                 unsigned int lookahead = 4) throw(GsmException);
+
+    // return/set "more messages to send" mode (+CMMS):
+    // 0 disabled
+    // 1 keep relay link to the SMSC open until the time between two
+    //   send commands exceeds 1-5 seconds, then switch back to 0
+    // 2 keep relay link open permanently (link is closed after the
+    //   timeout, but mode 2 remains set)
+    int getMoreMessagesToSend() throw(GsmException); // (+CMMS?)
+    void setMoreMessagesToSend(int mode) throw(GsmException); // (+CMMS=)
+
+    // begin and end a burst of SMS submissions
+    // during the burst the relay link to the SMSC is kept open between
+    // messages (mode 2 if permanent is set, else mode 1) if the ME/TA
+    // supports +CMMS, otherwise nothing is done
+    // calls may be nested, the outermost endSMSBurst() restores the
+    // previous +CMMS setting
+    void beginSMSBurst(bool permanent = false) throw(GsmException);
+    void endSMSBurst() throw(GsmException);
+
     // set SMS service level
     // if set to 1 send commands return ACK PDU, 0 is the default
     void setMessageService(int serviceLevel) throw(GsmException);
@@ -378,6 +462,24 @@ namespace gsmlib
       throw(GsmException);
     // (+CNMI=)
 
+    // set the CB message identifiers and data coding schemes to accept
+    // in the ME (+CSCB mode 0, mode 1 if the filter is inverted) and in
+    // the library, incoming CB messages that are not accepted are
+    // dropped before they are decoded (for MEs that ignore +CSCB)
+    // if setInME is false, only the filter in the library is set
+    void setCBChannels(const CBChannelFilter &filter, bool setInME = true)
+      throw(GsmException);
+    // (+CSCB=)
+
+    // return the CB message identifiers and data coding schemes
+    // accepted by the ME
+    CBChannelFilter getCBChannels() throw(GsmException);
+    // (+CSCB?)
+
+    // return the filter applied to incoming CB messages
+    const CBChannelFilter &getCBChannelFilter() const
+      {return _cbChannelFilter;}
+
     bool getCallWaitingLockStatus(FacilityClass cl)
       throw(GsmException);
 	
@@ -21,7 +21,13 @@
 #include <gsmlib/gsm_parser.h>
 #include <gsmlib/gsm_me_ta.h>
 #include <string>
+#include <cstring>
+#include <new>
 #include <sstream>
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+#include <unistd.h>
+#endif
 
 using namespace gsmlib;
 
@@ -36,29 +42,47 @@ Ref<SMSMessage> SMSMessage::decode(std::string pdu,
                                    bool SCtoMEdirection,
                                    GsmAt *at) throw(GsmException)
 {
-  Ref<SMSMessage> result;
   SMSDecoder d(pdu);
-  d.getAddress(true);
+  Ref<SMSMessage> result = decode(d, SCtoMEdirection, at);
+
+  // the pdu is returned by encode() until the message is changed
+  // (unless it has trailing octets or is not in upper case like the
+  // output of the encoder)
+  if (! d.atEnd())
+    return result;
+  for (std::string::const_iterator i = pdu.begin(); i != pdu.end(); ++i)
+    if (*i >= 'a')
+      return result;
+  result->_encoded = pdu;
+  return result;
+}
+
+Ref<SMSMessage> SMSMessage::decode(SMSDecoder &d,
+                                   bool SCtoMEdirection,
+                                   GsmAt *at) throw(GsmException)
+{
+  Ref<SMSMessage> result;
+  Address serviceCentreAddress = d.getAddress(true);
   MessageType messageTypeIndicator = (MessageType)d.get2Bits(); // bits 0..1
   if (SCtoMEdirection)
     // TPDUs from SC to ME
     switch (messageTypeIndicator)
     {
     case SMS_DELIVER:
-      result = new SMSDeliverMessage(pdu);
+      result = new SMSDeliverMessage(d, serviceCentreAddress);
       break;
 
     case SMS_STATUS_REPORT:
-      result = new SMSStatusReportMessage(pdu);
+      result = new SMSStatusReportMessage(d, serviceCentreAddress);
       break;
 
     case SMS_SUBMIT_REPORT:
       // observed with Motorola Timeport 260, the SCtoMEdirection can
       // be wrong in this case
       if (at != NULL && at->getMeTa().getCapabilities()._wrongSMSStatusCode)
-        result = new SMSSubmitMessage(pdu);
+        result = new SMSSubmitMessage(d, serviceCentreAddress);
       else
-        result = new SMSSubmitReportMessage(pdu);
+        result = new SMSSubmitReportMessage(d, serviceCentreAddress);
       break;
 
     default:
@@ -69,15 +93,15 @@ Ref<SMSMessage> SMSMessage::decode(std::string pdu,
     switch (messageTypeIndicator)
     {
     case SMS_SUBMIT:
-      result = new SMSSubmitMessage(pdu);
+      result = new SMSSubmitMessage(d, serviceCentreAddress);
       break;
 
     case SMS_DELIVER_REPORT:
-      result = new SMSDeliverReportMessage(pdu);
+      result = new SMSDeliverReportMessage(d, serviceCentreAddress);
       break;
 
     case SMS_COMMAND:
-      result = new SMSCommandMessage(pdu);
+      result = new SMSCommandMessage(d, serviceCentreAddress);
       break;
 
     default:
@@ -109,10 +133,21 @@ unsigned char SMSMessage::send(Ref<SMSMessage> &ackPdu)
   if (_at.isnull())
     throw GsmException(_("no device given for sending SMS"), ParameterError);
 
-  std::string pdu = encode();
-  Parser p(_at->sendPdu("+CMGS=" +
-                        intToStr(pdu.length() / 2 - getSCAddressLen()),
-                        "+CMGS:", pdu));
+  return send(_at, encode(), ackPdu);
+}
+
+unsigned char SMSMessage::send(Ref<GsmAt> at, std::string pdu,
+                               Ref<SMSMessage> &ackPdu) throw(GsmException)
+{
+  // the TPDU length excludes the service centre address, whose
+  // length octet comes first
+  unsigned char scAddressLen;
+  if (pdu.length() < 2 || ! hexToBuf(pdu.substr(0, 2), &scAddressLen))
+    throw GsmException(_("bad hexadecimal PDU format"), SMSFormatError);
+
+  Parser p(at->sendPdu("+CMGS=" +
+                       intToStr(pdu.length() / 2 - scAddressLen - 1),
+                       "+CMGS:", pdu));
   unsigned char messageReference = p.parseInt();
 
   if (p.parseComma(true))
@@ -120,7 +155,7 @@ unsigned char SMSMessage::send(Ref<SMSMessage> &ackPdu)
     std::string pdu = p.parseEol();
 
     // add missing service centre address if required by ME
-    if (! _at->getMeTa().getCapabilities()._hasSMSSCAprefix)
+    if (! at->getMeTa().getCapabilities()._hasSMSSCAprefix)
       pdu = "00" + pdu;
 
     ackPdu = SMSMessage::decode(pdu);
@@ -148,7 +183,9 @@ unsigned char SMSMessage::userDataLength() const
 {
   unsigned int udhl = _userDataHeader.length();
   if (_dataCodingScheme.getAlphabet() == DCS_DEFAULT_ALPHABET)
-    return _userData.length() + (udhl ? ((1 + udhl) * 8 + 6) / 7 : 0);
+    // extension table characters take two septets
+    return gsmUserData().length() +
+      (udhl ? ((1 + udhl) * 8 + 6) / 7 : 0);
   else
     return _userData.length() + (udhl ? (1 + udhl) : 0);
 }
@@ -181,6 +218,11 @@ std::ostream& SMSMessage::operator<<(std::ostream& s)
 // {
 // }
 
+std::string SMSMessage::gsmUserData() const
+{
+  return _userDataSeptets ? _userData : latin1ToGsm(_userData);
+}
+
 SMSMessage::~SMSMessage() {}
 
 // SMSDeliverMessage members
@@ -205,6 +247,20 @@ SMSDeliverMessage::SMSDeliverMessage(std::string pdu) throw(GsmException)
   _serviceCentreAddress = d.getAddress(true);
   _messageTypeIndicator = (MessageType)d.get2Bits(); // bits 0..1
   assert(_messageTypeIndicator == SMS_DELIVER);
+  decodeBody(d);
+}
+
+SMSDeliverMessage::SMSDeliverMessage(SMSDecoder &d,
+                                     Address serviceCentreAddress)
+  throw(GsmException)
+{
+  _serviceCentreAddress = serviceCentreAddress;
+  _messageTypeIndicator = SMS_DELIVER;
+  decodeBody(d);
+}
+
+void SMSDeliverMessage::decodeBody(SMSDecoder &d) throw(GsmException)
+{
   _moreMessagesToSend = d.getBit(); // bit 2
   d.getBit();                   // bit 3
   d.getBit();                   // bit 4
@@ -245,6 +301,9 @@ SMSDeliverMessage::SMSDeliverMessage(std::string pdu) throw(GsmException)
 
 std::string SMSDeliverMessage::encode()
 {
+  if (! _encoded.empty())
+    return _encoded;
+
   SMSEncoder e;
   e.setAddress(_serviceCentreAddress, true);
   e.set2Bits(_messageTypeIndicator); // bits 0..1
@@ -262,10 +321,11 @@ std::string SMSDeliverMessage::encode()
   e.markSeptet();
   if (_userDataHeader.length()) _userDataHeader.encode(e);
   if (_dataCodingScheme.getAlphabet() == DCS_DEFAULT_ALPHABET)
-    e.setString(latin1ToGsm(_userData));
+    e.setString(gsmUserData());
   else
     e.setOctets((unsigned char*)_userData.data(), _userData.length());
-  return e.getHexString();
+  _encoded = e.getHexString();
+  return _encoded;
 }
 
 std::string SMSDeliverMessage::toString() const
@@ -330,11 +390,24 @@ SMSSubmitMessage::SMSSubmitMessage()
 }
 
 SMSSubmitMessage::SMSSubmitMessage(std::string pdu) throw(GsmException)
-{ 
+{
   SMSDecoder d(pdu);
   _serviceCentreAddress = d.getAddress(true);
   _messageTypeIndicator = (MessageType)d.get2Bits(); // bits 0..1
   assert(_messageTypeIndicator == SMS_SUBMIT);
+  decodeBody(d);
+}
+
+SMSSubmitMessage::SMSSubmitMessage(SMSDecoder &d, Address serviceCentreAddress)
+  throw(GsmException)
+{
+  _serviceCentreAddress = serviceCentreAddress;
+  _messageTypeIndicator = SMS_SUBMIT;
+  decodeBody(d);
+}
+
+void SMSSubmitMessage::decodeBody(SMSDecoder &d) throw(GsmException)
+{
   _rejectDuplicates = d.getBit(); // bit 2
   _validityPeriodFormat = (TimePeriod::Format)d.get2Bits(); // bits 3..4
   _statusReportRequest = d.getBit(); // bit 5
@@ -383,6 +456,9 @@ SMSSubmitMessage::SMSSubmitMessage(std::string text, std::string number)
 
 std::string SMSSubmitMessage::encode()
 {
+  if (! _encoded.empty())
+    return _encoded;
+
   SMSEncoder e;
   e.setAddress(_serviceCentreAddress, true);
   e.set2Bits(_messageTypeIndicator); // bits 0..1
@@ -401,10 +477,11 @@ std::string SMSSubmitMessage::encode()
   e.markSeptet();
   if (userDataHeaderIndicator) _userDataHeader.encode(e);
   if (_dataCodingScheme.getAlphabet() == DCS_DEFAULT_ALPHABET)
-    e.setString(latin1ToGsm(_userData));
+    e.setString(gsmUserData());
   else
     e.setOctets((unsigned char*)_userData.data(), _userData.length());
-  return e.getHexString();
+  _encoded = e.getHexString();
+  return _encoded;
 }
 
 std::string SMSSubmitMessage::toString() const
@@ -481,6 +558,20 @@ SMSStatusReportMessage::SMSStatusReportMessage(std::string pdu) throw(GsmExcepti
   _serviceCentreAddress = d.getAddress(true);
   _messageTypeIndicator = (MessageType)d.get2Bits(); // bits 0..1
   assert(_messageTypeIndicator == SMS_STATUS_REPORT);
+  decodeBody(d);
+}
+
+SMSStatusReportMessage::SMSStatusReportMessage(SMSDecoder &d,
+                                               Address serviceCentreAddress)
+  throw(GsmException)
+{
+  _serviceCentreAddress = serviceCentreAddress;
+  _messageTypeIndicator = SMS_STATUS_REPORT;
+  decodeBody(d);
+}
+
+void SMSStatusReportMessage::decodeBody(SMSDecoder &d) throw(GsmException)
+{
   _moreMessagesToSend = d.getBit(); // bit 2
   d.getBit();                   // bit 3
   d.getBit();                   // bit 4
@@ -494,6 +585,9 @@ SMSStatusReportMessage::SMSStatusReportMessage(std::string pdu) throw(GsmExcepti
 
 std::string SMSStatusReportMessage::encode()
 {
+  if (! _encoded.empty())
+    return _encoded;
+
   SMSEncoder e;
   e.setAddress(_serviceCentreAddress, true);
   e.set2Bits(_messageTypeIndicator); // bits 0..1
@@ -506,7 +600,8 @@ std::string SMSStatusReportMessage::encode()
   e.setTimestamp(_serviceCentreTimestamp);
   e.setTimestamp(_dischargeTime);
   e.setOctet(_status);
-  return e.getHexString();
+  _encoded = e.getHexString();
+  return _encoded;
 }
 
 std::string SMSStatusReportMessage::toString() const
@@ -558,6 +653,20 @@ SMSCommandMessage::SMSCommandMessage(std::string pdu) throw(GsmException)
   _serviceCentreAddress = d.getAddress(true);
   _messageTypeIndicator = (MessageType)d.get2Bits(); // bits 0..1
   assert(_messageTypeIndicator == SMS_COMMAND);
+  decodeBody(d);
+}
+
+SMSCommandMessage::SMSCommandMessage(SMSDecoder &d,
+                                     Address serviceCentreAddress)
+  throw(GsmException)
+{
+  _serviceCentreAddress = serviceCentreAddress;
+  _messageTypeIndicator = SMS_COMMAND;
+  decodeBody(d);
+}
+
+void SMSCommandMessage::decodeBody(SMSDecoder &d) throw(GsmException)
+{
   d.getBit();                   // bit 2
   d.getBit();                   // bit 3
   d.getBit();                   // bit 4
@@ -575,6 +684,9 @@ SMSCommandMessage::SMSCommandMessage(std::string pdu) throw(GsmException)
 
 std::string SMSCommandMessage::encode()
 {
+  if (! _encoded.empty())
+    return _encoded;
+
   SMSEncoder e;
   e.setAddress(_serviceCentreAddress, true);
   e.set2Bits(_messageTypeIndicator); // bits 0..1
@@ -590,7 +702,8 @@ std::string SMSCommandMessage::encode()
   e.setOctet(_commandData.length());
   e.setOctets((const unsigned char*)_commandData.data(),
               (short unsigned int)_commandData.length());
-  return e.getHexString();
+  _encoded = e.getHexString();
+  return _encoded;
 }
 
 std::string SMSCommandMessage::toString() const
@@ -643,6 +756,20 @@ SMSDeliverReportMessage::SMSDeliverReportMessage(std::string pdu)
   _serviceCentreAddress = d.getAddress(true);
   _messageTypeIndicator = (MessageType)d.get2Bits(); // bits 0..1
   assert(_messageTypeIndicator == SMS_DELIVER_REPORT);
+  decodeBody(d);
+}
+
+SMSDeliverReportMessage::SMSDeliverReportMessage(SMSDecoder &d,
+                                                 Address serviceCentreAddress)
+  throw(GsmException)
+{
+  _serviceCentreAddress = serviceCentreAddress;
+  _messageTypeIndicator = SMS_DELIVER_REPORT;
+  decodeBody(d);
+}
+
+void SMSDeliverReportMessage::decodeBody(SMSDecoder &d) throw(GsmException)
+{
   d.alignOctet();               // skip to parameter indicator
   _protocolIdentifierPresent = d.getBit(); // bit 0
   _dataCodingSchemePresent = d.getBit(); // bit 1
@@ -672,6 +799,9 @@ SMSDeliverReportMessage::SMSDeliverReportMessage(std::string pdu)
 
 std::string SMSDeliverReportMessage::encode()
 {
+  if (! _encoded.empty())
+    return _encoded;
+
   SMSEncoder e;
   e.setAddress(_serviceCentreAddress, true);
   e.set2Bits(_messageTypeIndicator); // bits 0..1
@@ -685,14 +815,21 @@ std::string SMSDeliverReportMessage::encode()
     e.setOctet(_dataCodingScheme);
   if (_userDataLengthPresent)
   {
-    unsigned char userDataLength = _userData.length();
-    e.setOctet(userDataLength);
     if (_dataCodingScheme.getAlphabet() == DCS_DEFAULT_ALPHABET)
-      e.setString(latin1ToGsm(_userData));
+    {
+      std::string septets = gsmUserData();
+      e.setOctet(septets.length());
+      e.setString(septets);
+    }
     else
+    {
+      unsigned char userDataLength = _userData.length();
+      e.setOctet(userDataLength);
       e.setOctets((unsigned char*)_userData.data(), userDataLength);
+    }
   }
-  return e.getHexString();
+  _encoded = e.getHexString();
+  return _encoded;
 }
 
 std::string SMSDeliverReportMessage::toString() const
@@ -747,6 +884,20 @@ SMSSubmitReportMessage::SMSSubmitReportMessage(std::string pdu) throw(GsmExcepti
   _serviceCentreAddress = d.getAddress(true);
   _messageTypeIndicator = (MessageType)d.get2Bits(); // bits 0..1
   assert(_messageTypeIndicator == SMS_SUBMIT_REPORT);
+  decodeBody(d);
+}
+
+SMSSubmitReportMessage::SMSSubmitReportMessage(SMSDecoder &d,
+                                               Address serviceCentreAddress)
+  throw(GsmException)
+{
+  _serviceCentreAddress = serviceCentreAddress;
+  _messageTypeIndicator = SMS_SUBMIT_REPORT;
+  decodeBody(d);
+}
+
+void SMSSubmitReportMessage::decodeBody(SMSDecoder &d) throw(GsmException)
+{
   _serviceCentreTimestamp = d.getTimestamp();
   _protocolIdentifierPresent = d.getBit(); // bit 0
   _dataCodingSchemePresent = d.getBit(); // bit 1
@@ -776,6 +927,9 @@ SMSSubmitReportMessage::SMSSubmitReportMessage(std::string pdu) throw(GsmExcepti
 
 std::string SMSSubmitReportMessage::encode()
 {
+  if (! _encoded.empty())
+    return _encoded;
+
   SMSEncoder e;
   e.setAddress(_serviceCentreAddress, true);
   e.set2Bits(_messageTypeIndicator); // bits 0..1
@@ -791,11 +945,12 @@ std::string SMSSubmitReportMessage::encode()
   {
     e.setOctet(userDataLength());
     if (_dataCodingScheme.getAlphabet() == DCS_DEFAULT_ALPHABET)
-      e.setString(latin1ToGsm(_userData));
+      e.setString(gsmUserData());
     else
       e.setOctets((unsigned char*)_userData.data(), _userData.length());
   }
-  return e.getHexString();
+  _encoded = e.getHexString();
+  return _encoded;
 }
 
 std::string SMSSubmitReportMessage::toString() const
@@ -835,3 +990,696 @@ Ref<SMSMessage> SMSSubmitReportMessage::clone()
   return result;
 }
 
+
+// SMSTextSegments members and text segmentation
+
+// information element identifiers of the user data header
+// (GSM 03.40 section 9.2.3.24)
+static const unsigned char IEIConcatenated = 0x00;
+static const unsigned char IEIConcatenated16Bit = 0x08;
+static const unsigned char IEISingleShift = 0x24;
+static const unsigned char IEILockingShift = 0x25;
+
+// octets of one concatenation or shift information element
+static const unsigned int ConcatenatedIELength = 5;
+static const unsigned int Concatenated16BitIELength = 6;
+static const unsigned int ShiftIELength = 3;
+
+UserDataHeader SMSTextSegments::userDataHeader(unsigned int i,
+                                               int concatenatedMessageId)
+  const
+{
+  UserDataHeader udh;
+  if (concatenatedMessageId != -1 && size() > 1)
+  {
+    std::string ie;
+    if (_sixteenBitReference)
+    {
+      ie += (char)(concatenatedMessageId >> 8);
+      ie += (char)concatenatedMessageId;
+    }
+    else
+      ie += (char)concatenatedMessageId;
+    ie += (char)size();
+    ie += (char)(i + 1);
+    udh.addIE(_sixteenBitReference ? IEIConcatenated16Bit : IEIConcatenated,
+              ie);
+  }
+  udh = UserDataHeader((std::string)udh + (std::string)_header);
+  if (_alphabet == DCS_DEFAULT_ALPHABET)
+  {
+    if (_lockingShift != DefaultLanguage)
+      udh.addIE(IEILockingShift, std::string(1, (char)_lockingShift));
+    if (_singleShift != DefaultLanguage)
+      udh.addIE(IEISingleShift, std::string(1, (char)_singleShift));
+  }
+  return udh;
+}
+
+// return number of septets (or octets) left for user data in one SMS
+// with a user data header of udhLength octets (0 = no header)
+static unsigned int userDataCapacity(bool septets, unsigned int udhLength)
+  throw(GsmException)
+{
+  // leave room for at least one UCS2 surrogate pair
+  if (udhLength + 1 > 140 - 4)
+    throw GsmException(_("user data header too long"), ParameterError);
+  if (septets)
+    return udhLength == 0 ? 160 : 160 - ((udhLength + 1) * 8 + 6) / 7;
+  else
+    return udhLength == 0 ? 140 : 140 - (udhLength + 1);
+}
+
+// split units (characters) of the given sizes into SMSs
+// all units fit into a single SMS if their sizes add up to at most
+// singleCapacity, otherwise each SMS takes at most capacity
+// return number of SMSs, store index of the first unit of each SMS
+// in starts (if given)
+static unsigned int splitUnits(const std::vector<unsigned char> &sizes,
+                               unsigned int singleCapacity,
+                               unsigned int capacity,
+                               std::vector<unsigned int> *starts = NULL)
+{
+  if (starts != NULL)
+  {
+    starts->clear();
+    starts->push_back(0);
+  }
+  unsigned int total = 0;
+  for (unsigned int i = 0; i < sizes.size(); ++i)
+    total += sizes[i];
+  if (total <= singleCapacity)
+    return 1;
+
+  unsigned int count = 1, used = 0;
+  for (unsigned int i = 0; i < sizes.size(); ++i)
+  {
+    if (used + sizes[i] > capacity)
+    {
+      ++count;
+      used = 0;
+      if (starts != NULL)
+        starts->push_back(i);
+    }
+    used += sizes[i];
+  }
+  return count;
+}
+
+// cut userData (encoded units of the given sizes) at starts into segments
+static void cutUserData(const std::string &userData,
+                        const std::vector<unsigned char> &sizes,
+                        const std::vector<unsigned int> &starts,
+                        SMSTextSegments &segments)
+{
+  segments._userData.clear();
+  unsigned int unit = 0, pos = 0;
+  for (unsigned int s = 0; s < starts.size(); ++s)
+  {
+    unsigned int end = s + 1 < starts.size() ? starts[s + 1] : sizes.size();
+    unsigned int length = 0;
+    for (; unit < end; ++unit)
+      length += sizes[unit];
+    segments._userData.push_back(userData.substr(pos, length));
+    pos += length;
+  }
+}
+
+// check number of SMSs of a concatenated message
+static void checkSegmentCount(unsigned int count, bool concatenated)
+  throw(GsmException)
+{
+  if (concatenated && count > 255)
+    throw GsmException(_("not more than 255 concatenated SMSs allowed"),
+                       ParameterError);
+}
+
+SMSTextSegments gsmlib::segmentSMSText(const std::string &utf8,
+                                       bool concatenated,
+                                       bool nationalLanguages,
+                                       bool eightBit,
+                                       bool sixteenBitReference,
+                                       UserDataHeader header)
+  throw(GsmException)
+{
+  std::vector<unsigned long> characters;
+  for (std::string::size_type pos = 0; pos < utf8.length();)
+    characters.push_back(nextUtf8Character(utf8, pos));
+  unsigned int concatenatedLength = ! concatenated ? 0 :
+    sixteenBitReference ? Concatenated16BitIELength : ConcatenatedIELength;
+  unsigned int headerLength = header.length();
+
+  // candidates are tried in order of preference, a later one must
+  // need fewer SMSs to win
+  SMSTextSegments best;
+  unsigned int bestCount = 0;
+  std::vector<unsigned char> sizes, bestSizes;
+  sizes.reserve(characters.size());
+
+  // default alphabet, then national language tables with as few shift
+  // information elements as possible; stop as soon as no table can
+  // need fewer SMSs, ie. when the best one needs as many as one septet
+  // per character without shift information elements
+  static const NationalLanguage shifts[][2] =
+    {{DefaultLanguage, DefaultLanguage},
+     {DefaultLanguage, Turkish}, {DefaultLanguage, Spanish},
+     {DefaultLanguage, Portuguese},
+     {Turkish, DefaultLanguage}, {Portuguese, DefaultLanguage},
+     {Turkish, Turkish}, {Portuguese, Portuguese},
+     {Turkish, Spanish}, {Turkish, Portuguese},
+     {Portuguese, Turkish}, {Portuguese, Spanish}};
+  unsigned int singleCapacity = userDataCapacity(true, headerLength);
+  unsigned int capacity =
+    userDataCapacity(true, headerLength + concatenatedLength);
+  unsigned int minCount = characters.size() <= singleCapacity ? 1 :
+    (characters.size() + capacity - 1) / capacity;
+  for (unsigned int t = 0; t < sizeof(shifts) / sizeof(shifts[0]); ++t)
+  {
+    if (t > 0 && (! nationalLanguages ||
+                  (bestCount != 0 && bestCount <= minCount)))
+      break;
+    GsmAlphabet alphabet(shifts[t][0], shifts[t][1]);
+    sizes.clear();
+    unsigned int i;
+    for (i = 0; i < characters.size(); ++i)
+    {
+      unsigned short septet = alphabet.septet(characters[i]);
+      if (septet == GsmAlphabet::NoSeptet)
+        break;
+      sizes.push_back(septet & GsmAlphabet::EscapedSeptet ? 2 : 1);
+    }
+    if (i < characters.size())
+      continue;
+
+    unsigned int udhLength = headerLength +
+      (shifts[t][0] != DefaultLanguage ? ShiftIELength : 0) +
+      (shifts[t][1] != DefaultLanguage ? ShiftIELength : 0);
+    unsigned int count =
+      splitUnits(sizes, userDataCapacity(true, udhLength),
+                 userDataCapacity(true, udhLength + concatenatedLength));
+    if (bestCount == 0 || count < bestCount)
+    {
+      bestCount = count;
+      bestSizes = sizes;
+      best._alphabet = DCS_DEFAULT_ALPHABET;
+      best._lockingShift = shifts[t][0];
+      best._singleShift = shifts[t][1];
+    }
+  }
+
+  // 8-bit alphabet with Latin-1 characters
+  if (eightBit)
+  {
+    sizes.clear();
+    unsigned int i;
+    for (i = 0; i < characters.size() && characters[i] < 256; ++i)
+      sizes.push_back(1);
+    if (i == characters.size())
+    {
+      unsigned int count =
+        splitUnits(sizes, userDataCapacity(false, headerLength),
+                   userDataCapacity(false,
+                                    headerLength + concatenatedLength));
+      if (bestCount == 0 || count < bestCount)
+      {
+        bestCount = count;
+        bestSizes = sizes;
+        best._alphabet = DCS_EIGHT_BIT_ALPHABET;
+      }
+    }
+  }
+
+  // UCS2, characters beyond the basic multilingual plane take two
+  // code units
+  sizes.clear();
+  for (unsigned int i = 0; i < characters.size(); ++i)
+    sizes.push_back(characters[i] > 0xffff ? 4 : 2);
+  unsigned int count =
+    splitUnits(sizes, userDataCapacity(false, headerLength),
+               userDataCapacity(false, headerLength + concatenatedLength));
+  if (bestCount == 0 || count < bestCount)
+  {
+    bestCount = count;
+    bestSizes = sizes;
+    best._alphabet = DCS_SIXTEEN_BIT_ALPHABET;
+  }
+  checkSegmentCount(bestCount, concatenated);
+
+  // encode the whole text and cut it into pieces
+  std::string userData;
+  unsigned int udhLength = headerLength;
+  switch (best._alphabet)
+  {
+  case DCS_DEFAULT_ALPHABET:
+    userData = GsmAlphabet(best._lockingShift,
+                           best._singleShift).fromUtf8(utf8);
+    udhLength +=
+      (best._lockingShift != DefaultLanguage ? ShiftIELength : 0) +
+      (best._singleShift != DefaultLanguage ? ShiftIELength : 0);
+    break;
+  case DCS_EIGHT_BIT_ALPHABET:
+    userData = utf8ToLatin1(utf8);
+    break;
+  default:
+    userData = utf8ToUcs2(utf8);
+    break;
+  }
+  bool septets = best._alphabet == DCS_DEFAULT_ALPHABET;
+  std::vector<unsigned int> starts;
+  splitUnits(bestSizes, userDataCapacity(septets, udhLength),
+             userDataCapacity(septets, udhLength + concatenatedLength),
+             &starts);
+  cutUserData(userData, bestSizes, starts, best);
+  best._concatenated = concatenated;
+  best._sixteenBitReference = sixteenBitReference;
+  best._header = header;
+  return best;
+}
+
+SMSTextSegments gsmlib::segmentSMSUserData(const std::string &userData,
+                                           unsigned char alphabet,
+                                           bool concatenated,
+                                           bool sixteenBitReference,
+                                           UserDataHeader header)
+  throw(GsmException)
+{
+  SMSTextSegments result;
+  result._alphabet = alphabet;
+  result._concatenated = concatenated;
+  result._sixteenBitReference = sixteenBitReference;
+  result._header = header;
+  std::string encoded;
+  std::vector<unsigned char> sizes;
+  switch (alphabet)
+  {
+  case DCS_DEFAULT_ALPHABET:
+    // escapes and the following septet stay together
+    encoded = latin1ToGsm(userData);
+    for (unsigned int i = 0; i < encoded.length(); ++i)
+      if (encoded[i] == GSM_ESCAPE && i + 1 < encoded.length())
+      {
+        sizes.push_back(2);
+        ++i;
+      }
+      else
+        sizes.push_back(1);
+    break;
+  case DCS_EIGHT_BIT_ALPHABET:
+    encoded = userData;
+    sizes.assign(encoded.length(), 1);
+    break;
+  case DCS_SIXTEEN_BIT_ALPHABET:
+    // surrogate pairs stay together
+    encoded = userData;
+    for (unsigned int i = 0; i < encoded.length(); i += 2)
+      if (i + 3 < encoded.length() &&
+          ((unsigned char)encoded[i] & 0xfc) == 0xd8 &&
+          ((unsigned char)encoded[i + 2] & 0xfc) == 0xdc)
+      {
+        sizes.push_back(4);
+        i += 2;
+      }
+      else
+        sizes.push_back(MIN(2, (int)(encoded.length() - i)));
+    break;
+  default:
+    throw GsmException(_("unsupported alphabet for SMS"),
+                       ParameterError);
+  }
+
+  bool septets = alphabet == DCS_DEFAULT_ALPHABET;
+  std::vector<unsigned int> starts;
+  unsigned int count =
+    splitUnits(sizes, userDataCapacity(septets, header.length()),
+               userDataCapacity(septets, header.length() +
+                                (! concatenated ? 0 :
+                                 sixteenBitReference ?
+                                 Concatenated16BitIELength :
+                                 ConcatenatedIELength)),
+               &starts);
+  checkSegmentCount(count, concatenated);
+  cutUserData(encoded, sizes, starts, result);
+  return result;
+}
+
+// SMSReferenceAllocator members
+
+unsigned int SMSReferenceAllocator::next(const Address &destination)
+{
+  unsigned int range = _sixteenBit ? 0x10000 : 0x100;
+  std::string key = destination.toString();
+  std::map<std::string, unsigned int>::iterator i = _references.find(key);
+  if (i == _references.end())
+  {
+    // forget all destinations if there are too many, they continue
+    // from the common counter
+    if (_references.size() >= _maxDestinations)
+      _references.clear();
+    i = _references.insert(std::make_pair(key, _next % range)).first;
+  }
+  unsigned int result = i->second;
+  i->second = (result + 1) % range;
+  _next = (_next + 1) % range;
+  return result;
+}
+
+// batch decoding
+
+// batch of pdus shared by the decoding threads
+struct SMSDecodeBatch
+{
+  const SMSBatchPdu *_pdus;
+  SMSDecodeResult *_results;
+  unsigned long _count;
+  unsigned long _next;          // next pdu not yet taken by a thread
+#ifdef HAVE_LIBPTHREAD
+  pthread_mutex_t _mutex;       // protects _next
+#endif
+};
+
+// pdus are handed out in chunks of this size
+const unsigned long DecodeChunkSize = 64;
+
+static void decodeSMSRange(SMSDecodeBatch &batch, unsigned long begin,
+                           unsigned long end)
+{
+  for (unsigned long i = begin; i < end; ++i)
+  {
+    SMSDecodeResult &result = batch._results[i];
+    try
+    {
+      result._message = SMSMessage::decode(batch._pdus[i]._pdu,
+                                           batch._pdus[i]._SCtoMEdirection);
+    }
+    catch (GsmException &e)
+    {
+      result._error = e.what();
+      result._errorClass = e.getErrorClass();
+    }
+    catch (std::exception &e)
+    {
+      result._error = e.what();
+      result._errorClass = OtherError;
+    }
+  }
+}
+
+#ifdef HAVE_LIBPTHREAD
+static void *decodeSMSThread(void *b)
+{
+  SMSDecodeBatch &batch = *(SMSDecodeBatch*)b;
+  while (true)
+  {
+    pthread_mutex_lock(&batch._mutex);
+    unsigned long begin = batch._next;
+    batch._next = MIN(begin + DecodeChunkSize, batch._count);
+    unsigned long end = batch._next;
+    pthread_mutex_unlock(&batch._mutex);
+    if (begin == end)
+      break;
+    decodeSMSRange(batch, begin, end);
+  }
+  return NULL;
+}
+#endif
+
+void gsmlib::decodeSMSBatch(const SMSBatchPdu *pdus, unsigned long count,
+                            SMSDecodeResult *results, unsigned int threads)
+{
+  SMSDecodeBatch batch;
+  batch._pdus = pdus;
+  batch._results = results;
+  batch._count = count;
+  batch._next = 0;
+
+#ifdef HAVE_LIBPTHREAD
+  if (threads == 0)
+  {
+#ifdef _SC_NPROCESSORS_ONLN
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = cpus > 0 ? cpus : 1;
+#else
+    threads = 1;
+#endif
+  }
+  // no more threads than chunks
+  threads = MIN((unsigned long)threads,
+                (count + DecodeChunkSize - 1) / DecodeChunkSize);
+
+  if (threads > 1)
+  {
+    pthread_mutex_init(&batch._mutex, NULL);
+    std::vector<pthread_t> workers(threads);
+    unsigned int started = 0;
+    // the calling thread takes part, so start one thread less
+    while (started < threads - 1 &&
+           pthread_create(&workers[started], NULL, decodeSMSThread,
+                          &batch) == 0)
+      ++started;
+    decodeSMSThread(&batch);
+    for (unsigned int i = 0; i < started; ++i)
+      pthread_join(workers[i], NULL);
+    pthread_mutex_destroy(&batch._mutex);
+    return;
+  }
+#endif
+  decodeSMSRange(batch, 0, count);
+}
+
+void gsmlib::decodeSMSBatch(const std::vector<SMSBatchPdu> &pdus,
+                            std::vector<SMSDecodeResult> &results,
+                            unsigned int threads)
+{
+  results.clear();
+  results.resize(pdus.size());
+  if (! pdus.empty())
+    decodeSMSBatch(&pdus[0], pdus.size(), &results[0], threads);
+}
+
+// SMSMessageView members
+
+SMSMessageView::SMSMessageView(std::string pdu, bool SCtoMEdirection)
+  throw(GsmException) :
+  _pdu(pdu.length() / 2, '\0'), _length(pdu.length() / 2),
+  _SCtoMEdirection(SCtoMEdirection), _parsed(false)
+{
+  _data = (const unsigned char*)_pdu.data();
+  if (! hexToBuf(pdu.data(), pdu.length(), (unsigned char*)&_pdu[0]))
+    throw GsmException(_("bad hexadecimal PDU format"), SMSFormatError);
+}
+
+SMSMessageView::SMSMessageView(const unsigned char *pdu,
+                               unsigned long length,
+                               bool SCtoMEdirection, bool copyPdu) :
+  _data(pdu), _length(length), _SCtoMEdirection(SCtoMEdirection),
+  _parsed(false)
+{
+  if (copyPdu)
+  {
+    _pdu.assign((const char*)pdu, length);
+    _data = (const unsigned char*)_pdu.data();
+  }
+}
+
+SMSMessageView::SMSMessageView(const SMSMessageView &v) :
+  RefBase(), _pdu(v._pdu), _data(v._data), _length(v._length),
+  _SCtoMEdirection(v._SCtoMEdirection), _parsed(v._parsed),
+  _messageTypeIndicator(v._messageTypeIndicator),
+  _serviceCentreAddress(v._serviceCentreAddress), _address(v._address),
+  _serviceCentreTimestamp(v._serviceCentreTimestamp), _message(v._message)
+{
+  if (v._data == (const unsigned char*)v._pdu.data())
+    _data = (const unsigned char*)_pdu.data();
+}
+
+SMSMessageView &SMSMessageView::operator=(const SMSMessageView &v)
+{
+  _pdu = v._pdu;
+  _data = v._data == (const unsigned char*)v._pdu.data() ?
+    (const unsigned char*)_pdu.data() : v._data;
+  _length = v._length;
+  _SCtoMEdirection = v._SCtoMEdirection;
+  _parsed = v._parsed;
+  _messageTypeIndicator = v._messageTypeIndicator;
+  _serviceCentreAddress = v._serviceCentreAddress;
+  _address = v._address;
+  _serviceCentreTimestamp = v._serviceCentreTimestamp;
+  _message = v._message;
+  return *this;
+}
+
+void SMSMessageView::parse() const throw(GsmException)
+{
+  if (_parsed)
+    return;
+
+  // decode only up to the fields of interest, this follows the
+  // SMSMessage subclass constructors
+  SMSDecoder d(_data, _length);
+  _serviceCentreAddress = d.getAddress(true);
+  _messageTypeIndicator = (SMSMessage::MessageType)d.get2Bits();
+  d.alignOctet();
+  if (_SCtoMEdirection)
+    switch (_messageTypeIndicator)
+    {
+    case SMSMessage::SMS_DELIVER:
+      _address = d.getAddress();
+      d.getOctet();             // protocol identifier
+      d.getOctet();             // data coding scheme
+      _serviceCentreTimestamp = d.getTimestamp();
+      break;
+
+    case SMSMessage::SMS_STATUS_REPORT:
+      d.getOctet();             // message reference
+      _address = d.getAddress();
+      _serviceCentreTimestamp = d.getTimestamp();
+      break;
+
+    case SMSMessage::SMS_SUBMIT_REPORT:
+      _serviceCentreTimestamp = d.getTimestamp();
+      break;
+
+    default:
+      throw GsmException(_("unhandled SMS TPDU type"), OtherError);
+    }
+  else
+    switch (_messageTypeIndicator)
+    {
+    case SMSMessage::SMS_SUBMIT:
+      d.getOctet();             // message reference
+      _address = d.getAddress();
+      break;
+
+    case SMSMessage::SMS_DELIVER_REPORT:
+      break;
+
+    case SMSMessage::SMS_COMMAND:
+      d.getOctet();             // message reference
+      d.getOctet();             // protocol identifier
+      d.getOctet();             // command type
+      d.getOctet();             // message number
+      _address = d.getAddress();
+      break;
+
+    default:
+      throw GsmException(_("unhandled SMS TPDU type"), OtherError);
+    }
+  _parsed = true;
+}
+
+SMSMessage::MessageType SMSMessageView::messageType() const
+  throw(GsmException)
+{
+  parse();
+  return _messageTypeIndicator;
+}
+
+Address SMSMessageView::serviceCentreAddress() const throw(GsmException)
+{
+  parse();
+  return _serviceCentreAddress;
+}
+
+Timestamp SMSMessageView::serviceCentreTimestamp() const throw(GsmException)
+{
+  parse();
+  return _serviceCentreTimestamp;
+}
+
+Address SMSMessageView::address() const throw(GsmException)
+{
+  parse();
+  return _address;
+}
+
+SMSMessageRef SMSMessageView::message() const throw(GsmException)
+{
+  if (_message.isnull())
+  {
+    SMSDecoder d(_data, _length);
+    _message = SMSMessage::decode(d, _SCtoMEdirection);
+  }
+  return _message;
+}
+
+// SMSDecodeArena members
+
+SMSDecodeArena::SMSDecodeArena(unsigned long blockSize) :
+  _blockSize(blockSize), _next(NULL), _available(0)
+{
+}
+
+void *SMSDecodeArena::allocate(unsigned long length)
+{
+  // keep everything aligned for any type
+  const unsigned long alignment = 2 * sizeof(void*);
+  length = (length + alignment - 1) & ~(alignment - 1);
+
+  if (length > _available)
+  {
+    // oversized requests get a block of their own
+    unsigned long size = length > _blockSize ? length : _blockSize;
+    _next = new unsigned char[size];
+    _available = size;
+    _blocks.push_back(_next);
+  }
+  void *result = _next;
+  _next += length;
+  _available -= length;
+  return result;
+}
+
+SMSMessageView &SMSDecodeArena::add(const std::string &pdu,
+                                    bool SCtoMEdirection)
+  throw(GsmException)
+{
+  unsigned long length = pdu.length() / 2;
+  unsigned char *octets = (unsigned char*)allocate(length);
+  if (pdu.length() % 2 != 0 || ! hexToBuf(pdu.data(), pdu.length(), octets))
+    throw GsmException(_("bad hexadecimal PDU format"), SMSFormatError);
+  return addView(octets, length, SCtoMEdirection);
+}
+
+SMSMessageView &SMSDecodeArena::add(const unsigned char *pdu,
+                                    unsigned long length,
+                                    bool SCtoMEdirection)
+{
+  unsigned char *octets = (unsigned char*)allocate(length);
+  memcpy(octets, pdu, length);
+  return addView(octets, length, SCtoMEdirection);
+}
+
+SMSMessageView &SMSDecodeArena::addView(const unsigned char *octets,
+                                        unsigned long length,
+                                        bool SCtoMEdirection)
+{
+  SMSMessageView *view = new (allocate(sizeof(SMSMessageView)))
+    SMSMessageView(octets, length, SCtoMEdirection, false);
+  _views.push_back(view);
+  return *view;
+}
+
+void SMSDecodeArena::clear()
+{
+  for (std::vector<SMSMessageView*>::iterator i = _views.begin();
+       i != _views.end(); ++i)
+    (*i)->~SMSMessageView();
+  _views.clear();
+
+  // keep the first block for reuse
+  if (! _blocks.empty())
+  {
+    for (unsigned int i = 1; i < _blocks.size(); ++i)
+      delete[] _blocks[i];
+    _blocks.resize(1);
+    _next = _blocks[0];
+    _available = _blockSize;
+  }
+}
+
+SMSDecodeArena::~SMSDecodeArena()
+{
+  clear();
+  if (! _blocks.empty())
+    delete[] _blocks[0];
+}
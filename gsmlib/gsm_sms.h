@@ -18,8 +18,10 @@
 #include <gsmlib/gsm_error.h>
 #include <gsmlib/gsm_util.h>
 #include <gsmlib/gsm_at.h>
+#include <gsmlib/gsm_alphabet.h>
 #include <string>
 #include <vector>
+#include <map>
 
 namespace gsmlib
 {
@@ -47,6 +49,17 @@ namespace gsmlib
     Address _serviceCentreAddress;
     MessageType _messageTypeIndicator;// 2 bits
     DataCodingScheme _dataCodingScheme;
+    bool _userDataSeptets;      // _userData holds septets, not Latin-1
+    std::string _encoded;       // result of encode(), empty if a field
+                                // has changed since
+
+    SMSMessage() : _userDataSeptets(false) {}
+
+    // discard the cached result of encode(), called by all setters
+    void changed() {_encoded.erase();}
+
+    // return user data as septet string (default alphabet)
+    std::string gsmUserData() const;
 
   public:
     // decode hexadecimal pdu string
@@ -60,7 +73,16 @@ namespace gsmlib
 
     static Ref<SMSMessage> decode(std::istream& s) throw(GsmException);
 
+    // same as above, but decode from a decoder positioned at the start
+    // of the pdu (the service centre address)
+    static Ref<SMSMessage> decode(SMSDecoder &d,
+                                  bool SCtoMEdirection = true,
+                                  GsmAt *at = NULL)
+      throw(GsmException);
+
     // encode pdu, return hexadecimal pdu string
+    // the result is cached until a field is changed; for decoded
+    // messages it is the decoded pdu (if given in upper case hex)
     virtual std::string encode() = 0;
 
     // send this PDU
@@ -71,6 +93,12 @@ namespace gsmlib
     // same as above, but ACK-PDU is discarded
     unsigned char send() throw(GsmException);
 
+    // send an already encoded SMS-SUBMIT or SMS-COMMAND PDU
+    // (including the service centre address) using the given at handler
+    // returns message reference and ACK-PDU (if requested)
+    static unsigned char send(Ref<GsmAt> at, std::string pdu,
+                              Ref<SMSMessage> &ackPdu) throw(GsmException);
+
     // create textual representation of SMS
     virtual std::string toString() const = 0;
 
@@ -90,22 +118,33 @@ namespace gsmlib
     // return recipient, destination etc. address (for sorting by address)
     virtual Address address() const = 0;
 
-    virtual void setUserData(std::string x) {_userData = x;}
+    virtual void setUserData(std::string x)
+      {_userData = x; _userDataSeptets = false; changed();}
     virtual std::string userData() const {return _userData;}
+
+    // set user data in the default alphabet as septet string (one
+    // septet per octet, including escapes), for text that is not
+    // representable in Latin-1 (national language shift tables)
+    // userData() then returns the septets
+    void setUserDataSeptets(std::string septets)
+      {_userData = septets; _userDataSeptets = true; changed();}
+    bool userDataSeptets() const {return _userDataSeptets;}
     
     // return the size of user data (including user data header)
     unsigned char userDataLength() const;
 
     // accessor functions
-    virtual void setUserDataHeader(UserDataHeader x) {_userDataHeader = x;}
+    virtual void setUserDataHeader(UserDataHeader x)
+      {_userDataHeader = x; changed();}
     virtual UserDataHeader userDataHeader() const {return _userDataHeader;}
     
     virtual DataCodingScheme dataCodingScheme() const
       {return _dataCodingScheme;}
     virtual void setDataCodingScheme(DataCodingScheme x)
-      {_dataCodingScheme = x;}
+      {_dataCodingScheme = x; changed();}
 
-    void setServiceCentreAddress(Address &x) {_serviceCentreAddress = x;}
+    void setServiceCentreAddress(Address &x)
+      {_serviceCentreAddress = x; changed();}
     void setAt(Ref<GsmAt> at) {_at = at;}
 
     virtual ~SMSMessage();
@@ -134,6 +173,9 @@ namespace gsmlib
 
     // initialize members to sensible values
     void init();
+
+    // decode the TPDU fields following the message type indicator
+    void decodeBody(SMSDecoder &d) throw(GsmException);
     
   public:
     // constructor, sets sensible default values
@@ -142,6 +184,11 @@ namespace gsmlib
     // constructor with given pdu
     SMSDeliverMessage(std::string pdu) throw(GsmException);
 
+    // constructor continuing with a decoder positioned after the
+    // message type indicator
+    SMSDeliverMessage(SMSDecoder &d, Address serviceCentreAddress)
+      throw(GsmException);
+
     // encode pdu, return hexadecimal pdu string
     virtual std::string encode();
 
@@ -160,12 +207,16 @@ namespace gsmlib
     unsigned char protocolIdentifier() const {return _protocolIdentifier;}
     Timestamp serviceCentreTimestamp() const {return _serviceCentreTimestamp;}
 
-    void setMoreMessagesToSend(bool x) {_moreMessagesToSend = x;}
-    void setReplyPath(bool x) {_replyPath = x;}
-    void setStatusReportIndication(bool x) {_statusReportIndication = x;}
-    void setOriginatingAddress(Address &x) {_originatingAddress = x;}
-    void setProtocolIdentifier(unsigned char x) {_protocolIdentifier = x;}
-    void setServiceCentreTimestamp(Timestamp &x) {_serviceCentreTimestamp = x;}
+    void setMoreMessagesToSend(bool x) {_moreMessagesToSend = x; changed();}
+    void setReplyPath(bool x) {_replyPath = x; changed();}
+    void setStatusReportIndication(bool x)
+      {_statusReportIndication = x; changed();}
+    void setOriginatingAddress(Address &x)
+      {_originatingAddress = x; changed();}
+    void setProtocolIdentifier(unsigned char x)
+      {_protocolIdentifier = x; changed();}
+    void setServiceCentreTimestamp(Timestamp &x)
+      {_serviceCentreTimestamp = x; changed();}
 
     virtual ~SMSDeliverMessage() {}
   };
@@ -186,6 +237,9 @@ namespace gsmlib
 
     // initialize members to sensible values
     void init();
+
+    // decode the TPDU fields following the message type indicator
+    void decodeBody(SMSDecoder &d) throw(GsmException);
     
   public:
     // constructor, sets sensible default values
@@ -194,6 +248,11 @@ namespace gsmlib
     // constructor with given pdu
     SMSSubmitMessage(std::string pdu) throw(GsmException);
 
+    // constructor continuing with a decoder positioned after the
+    // message type indicator
+    SMSSubmitMessage(SMSDecoder &d, Address serviceCentreAddress)
+      throw(GsmException);
+
     // convenience constructor
     // given the text and recipient telephone number
     SMSSubmitMessage(std::string text, std::string number);
@@ -219,15 +278,18 @@ namespace gsmlib
     unsigned char protocolIdentifier() const {return _protocolIdentifier;}
     TimePeriod validityPeriod() const {return _validityPeriod;}
 
-    void setRejectDuplicates(bool x) {_rejectDuplicates = x;}
+    void setRejectDuplicates(bool x) {_rejectDuplicates = x; changed();}
     void setValidityPeriodFormat(TimePeriod::Format &x)
-      {_validityPeriodFormat = x;}
-    void setReplyPath(bool x) {_replyPath = x;}
-    void setStatusReportRequest(bool x) {_statusReportRequest = x;}
-    void setMessageReference(unsigned char x) {_messageReference = x;}
-    void setDestinationAddress(Address &x) {_destinationAddress = x;}
-    void setProtocolIdentifier(unsigned char x) {_protocolIdentifier = x;}
-    void setValidityPeriod(TimePeriod &x) {_validityPeriod = x;}
+      {_validityPeriodFormat = x; changed();}
+    void setReplyPath(bool x) {_replyPath = x; changed();}
+    void setStatusReportRequest(bool x) {_statusReportRequest = x; changed();}
+    void setMessageReference(unsigned char x)
+      {_messageReference = x; changed();}
+    void setDestinationAddress(Address &x)
+      {_destinationAddress = x; changed();}
+    void setProtocolIdentifier(unsigned char x)
+      {_protocolIdentifier = x; changed();}
+    void setValidityPeriod(TimePeriod &x) {_validityPeriod = x; changed();}
     
     virtual ~SMSSubmitMessage() {}
   };
@@ -247,6 +309,9 @@ namespace gsmlib
     
     // initialize members to sensible values
     void init();
+
+    // decode the TPDU fields following the message type indicator
+    void decodeBody(SMSDecoder &d) throw(GsmException);
     
   public:
     // constructor, sets sensible default values
@@ -255,6 +320,11 @@ namespace gsmlib
     // constructor with given pdu
     SMSStatusReportMessage(std::string pdu) throw(GsmException);
 
+    // constructor continuing with a decoder positioned after the
+    // message type indicator
+    SMSStatusReportMessage(SMSDecoder &d, Address serviceCentreAddress)
+      throw(GsmException);
+
     // encode pdu, return hexadecimal pdu string
     virtual std::string encode();
 
@@ -274,13 +344,17 @@ namespace gsmlib
     Timestamp dischargeTime() const {return _dischargeTime;}
     unsigned char status() const {return _status;}
     
-    void setMoreMessagesToSend(bool x) {_moreMessagesToSend = x;}
-    void setStatusReportQualifier(bool x) {_statusReportQualifier = x;}
-    void setMessageReference(unsigned char x) {_messageReference = x;}
-    void setRecipientAddress(Address x) {_recipientAddress = x;}
-    void setServiceCentreTimestamp(Timestamp x) {_serviceCentreTimestamp = x;}
-    void setDischargeTime(Timestamp x) {_serviceCentreTimestamp = x;}
-    void setStatus(unsigned char x) {_status = x;}
+    void setMoreMessagesToSend(bool x) {_moreMessagesToSend = x; changed();}
+    void setStatusReportQualifier(bool x)
+      {_statusReportQualifier = x; changed();}
+    void setMessageReference(unsigned char x)
+      {_messageReference = x; changed();}
+    void setRecipientAddress(Address x) {_recipientAddress = x; changed();}
+    void setServiceCentreTimestamp(Timestamp x)
+      {_serviceCentreTimestamp = x; changed();}
+    void setDischargeTime(Timestamp x)
+      {_serviceCentreTimestamp = x; changed();}
+    void setStatus(unsigned char x) {_status = x; changed();}
 
     virtual ~SMSStatusReportMessage() {}
   };
@@ -306,6 +380,9 @@ namespace gsmlib
 
     // initialize members to sensible values
     void init();
+
+    // decode the TPDU fields following the message type indicator
+    void decodeBody(SMSDecoder &d) throw(GsmException);
     
   public:
     // constructor, sets sensible default values
@@ -314,6 +391,11 @@ namespace gsmlib
     // constructor with given pdu
     SMSCommandMessage(std::string pdu) throw(GsmException);
 
+    // constructor continuing with a decoder positioned after the
+    // message type indicator
+    SMSCommandMessage(SMSDecoder &d, Address serviceCentreAddress)
+      throw(GsmException);
+
     // encode pdu, return hexadecimal pdu string
     virtual std::string encode();
 
@@ -334,14 +416,18 @@ namespace gsmlib
     unsigned char commandDataLength() const {return _commandDataLength;}
     std::string commandData() const {return _commandData;}
 
-    void setMessageReference(unsigned char x) {_messageReference = x;}
-    void setStatusReportRequest(bool x) {_statusReportRequest = x;}
-    void setProtocolIdentifier(unsigned char x) {_protocolIdentifier = x;}
-    void setCommandType(unsigned char x) {_commandType = x;}
-    void setMessageNumber(unsigned char x) {_messageNumber = x;}
-    void setDestinationAddress(Address &x) {_destinationAddress = x;}
-    void setCommandDataLength(unsigned char x) {_commandDataLength = x;}
-    void setCommandData(std::string x) {_commandData = x;}
+    void setMessageReference(unsigned char x)
+      {_messageReference = x; changed();}
+    void setStatusReportRequest(bool x) {_statusReportRequest = x; changed();}
+    void setProtocolIdentifier(unsigned char x)
+      {_protocolIdentifier = x; changed();}
+    void setCommandType(unsigned char x) {_commandType = x; changed();}
+    void setMessageNumber(unsigned char x) {_messageNumber = x; changed();}
+    void setDestinationAddress(Address &x)
+      {_destinationAddress = x; changed();}
+    void setCommandDataLength(unsigned char x)
+      {_commandDataLength = x; changed();}
+    void setCommandData(std::string x) {_commandData = x; changed();}
 
     virtual ~SMSCommandMessage() {}
   };
@@ -358,6 +444,9 @@ namespace gsmlib
     
     // initialize members to sensible values
     void init();
+
+    // decode the TPDU fields following the message type indicator
+    void decodeBody(SMSDecoder &d) throw(GsmException);
     
   public:
     // constructor, sets sensible default values
@@ -366,6 +455,11 @@ namespace gsmlib
     // constructor with given pdu
     SMSDeliverReportMessage(std::string pdu) throw(GsmException);
 
+    // constructor continuing with a decoder positioned after the
+    // message type indicator
+    SMSDeliverReportMessage(SMSDecoder &d, Address serviceCentreAddress)
+      throw(GsmException);
+
     // encode pdu, return hexadecimal pdu string
     virtual std::string encode();
 
@@ -390,18 +484,21 @@ namespace gsmlib
       {assert(_userDataLengthPresent); return _userData;}
     
     void setProtocolIdentifier(unsigned char x)
-      {_protocolIdentifierPresent = true; _protocolIdentifier = x;}
+      {_protocolIdentifierPresent = true; _protocolIdentifier = x; changed();}
     void setDataCodingScheme(DataCodingScheme x)
-      {_dataCodingSchemePresent = true; _dataCodingScheme = x;}
+      {_dataCodingSchemePresent = true; _dataCodingScheme = x; changed();}
     void setUserDataHeader(UserDataHeader x)
     {
       _userDataLengthPresent = true;
       _userDataHeader = x;
+      changed();
     }
     void setUserData(std::string x)
     {
       _userDataLengthPresent = true;
       _userData = x;
+      _userDataSeptets = false;
+      changed();
     }
     
     virtual ~SMSDeliverReportMessage() {}
@@ -421,6 +518,9 @@ namespace gsmlib
 
     // initialize members to sensible values
     void init();
+
+    // decode the TPDU fields following the message type indicator
+    void decodeBody(SMSDecoder &d) throw(GsmException);
     
   public:
     // constructor, sets sensible default values
@@ -429,6 +529,11 @@ namespace gsmlib
     // constructor with given pdu
     SMSSubmitReportMessage(std::string pdu) throw(GsmException);
 
+    // constructor continuing with a decoder positioned after the
+    // message type indicator
+    SMSSubmitReportMessage(SMSDecoder &d, Address serviceCentreAddress)
+      throw(GsmException);
+
     // encode pdu, return hexadecimal pdu string
     virtual std::string encode();
 
@@ -453,26 +558,257 @@ namespace gsmlib
     std::string userData() const
       {assert(_userDataLengthPresent); return _userData;}
 
-    void setServiceCentreTimestamp(Timestamp &x) {_serviceCentreTimestamp = x;}
+    void setServiceCentreTimestamp(Timestamp &x)
+      {_serviceCentreTimestamp = x; changed();}
     void setProtocolIdentifier(unsigned char x)
-      {_protocolIdentifierPresent = true; _protocolIdentifier = x;}
+      {_protocolIdentifierPresent = true; _protocolIdentifier = x; changed();}
     void setDataCodingScheme(DataCodingScheme x)
-      {_dataCodingSchemePresent = true; _dataCodingScheme = x;}
+      {_dataCodingSchemePresent = true; _dataCodingScheme = x; changed();}
     void setUserDataHeader(UserDataHeader x)
     {
       _userDataLengthPresent = true;
       _userDataHeader = x;
+      changed();
     }
     void setUserData(std::string x)
     {
       _userDataLengthPresent = true;
       _userData = x;
+      _userDataSeptets = false;
+      changed();
     }
     virtual ~SMSSubmitReportMessage() {}
   };
 
   // some useful typdefs
   typedef Ref<SMSMessage> SMSMessageRef;
+
+  // text split into the user data of several SMSs
+  // (see segmentSMSText() and MeTa::sendSMSs())
+  struct SMSTextSegments
+  {
+    unsigned char _alphabet;    // DCS_DEFAULT_ALPHABET,
+                                // DCS_EIGHT_BIT_ALPHABET or
+                                // DCS_SIXTEEN_BIT_ALPHABET
+    NationalLanguage _lockingShift; // shift tables (default alphabet only)
+    NationalLanguage _singleShift;
+    bool _concatenated;         // room for concatenation header reserved
+    bool _sixteenBitReference;  // concatenation with 16-bit reference
+                                // (IEI 0x08 instead of 0x00)
+    UserDataHeader _header;     // additional information elements
+                                // (e.g. application port addressing)
+    std::vector<std::string> _userData; // septets (default alphabet) or
+                                // octets of each SMS
+
+    SMSTextSegments() : _alphabet(DCS_DEFAULT_ALPHABET),
+      _lockingShift(DefaultLanguage), _singleShift(DefaultLanguage),
+      _concatenated(false), _sixteenBitReference(false) {}
+
+    // return number of SMSs
+    unsigned int size() const {return _userData.size();}
+
+    // return user data header for SMS i (0..size() - 1) with the
+    // concatenation information element (if concatenatedMessageId
+    // is != -1 and there are several SMSs), the additional information
+    // elements and the national language shift information elements
+    UserDataHeader userDataHeader(unsigned int i,
+                                  int concatenatedMessageId = -1) const;
+  };
+
+  // split UTF-8 text into as few SMSs as possible
+  // the default alphabet (with national language shift tables if
+  // nationalLanguages is true), the 8-bit alphabet (Latin-1, only if
+  // eightBit is true) and UCS2 are tried, the first one with the fewest
+  // SMSs wins
+  // SMSs never end within an escape sequence or an UTF-16 surrogate pair
+  // if concatenated is true, room for the concatenation information
+  // element (with 8-bit or 16-bit reference) is reserved in each SMS of
+  // a multi-part message
+  // the information elements in header are added to every SMS
+  SMSTextSegments segmentSMSText(const std::string &utf8,
+                                 bool concatenated = true,
+                                 bool nationalLanguages = true,
+                                 bool eightBit = false,
+                                 bool sixteenBitReference = false,
+                                 UserDataHeader header = UserDataHeader())
+    throw(GsmException);
+
+  // same as above for user data that is already in the given alphabet
+  // (Latin-1 text for the default alphabet, octets otherwise)
+  SMSTextSegments segmentSMSUserData(const std::string &userData,
+                                     unsigned char alphabet,
+                                     bool concatenated = true,
+                                     bool sixteenBitReference = false,
+                                     UserDataHeader header = UserDataHeader())
+    throw(GsmException);
+
+  // allocates reference numbers for concatenated SMSs
+  // references are counted separately for each destination, so that a
+  // destination receives 256 (8-bit) or 65536 (16-bit) different
+  // references before one is reused; destinations that are seen for the
+  // first time continue from a counter common to all destinations
+  // at most maxDestinations destinations are remembered
+  class SMSReferenceAllocator
+  {
+  private:
+    bool _sixteenBit;
+    unsigned int _maxDestinations;
+    unsigned int _next;         // first reference for new destinations
+    std::map<std::string, unsigned int> _references; // next reference
+
+  public:
+    SMSReferenceAllocator(bool sixteenBit = true, unsigned int first = 0,
+                          unsigned int maxDestinations = 10000) :
+      _sixteenBit(sixteenBit), _maxDestinations(maxDestinations),
+      _next(first) {}
+
+    bool sixteenBit() const {return _sixteenBit;}
+
+    // return next reference for destination
+    unsigned int next(const Address &destination);
+  };
+
+  // pdu to decode with decodeSMSBatch()
+  struct SMSBatchPdu
+  {
+    std::string _pdu;           // hexadecimal pdu string
+    bool _SCtoMEdirection;      // see SMSMessage::decode()
+
+    SMSBatchPdu(std::string pdu = "", bool SCtoMEdirection = true) :
+      _pdu(pdu), _SCtoMEdirection(SCtoMEdirection) {}
+  };
+
+  // result of decoding one pdu with decodeSMSBatch()
+  struct SMSDecodeResult
+  {
+    SMSMessageRef _message;     // decoded message, null if error
+    std::string _error;         // error text if not decoded
+    GsmErrorClass _errorClass;  // error class if not decoded
+
+    SMSDecodeResult() : _errorClass(OtherError) {}
+    bool ok() const {return ! _message.isnull();}
+  };
+
+  // decode count pdus into results[0..count - 1] (same order)
+  // errors are reported per pdu instead of throwing an exception
+  // the work is distributed among threads threads (0 = one per
+  // online CPU), decoding is sequential if threads are not available
+  void decodeSMSBatch(const SMSBatchPdu *pdus, unsigned long count,
+                      SMSDecodeResult *results, unsigned int threads = 0);
+
+  // same as above for vectors, results is resized to pdus.size()
+  void decodeSMSBatch(const std::vector<SMSBatchPdu> &pdus,
+                      std::vector<SMSDecodeResult> &results,
+                      unsigned int threads = 0);
+
+  // read-only view of an encoded SMS TPDU
+  // the header fields needed for listing and sorting (message type,
+  // addresses, timestamp) are parsed on first access without decoding
+  // the user data, the complete SMSMessage is only decoded by message()
+  class SMSMessageView : public RefBase
+  {
+  private:
+    std::string _pdu;           // binary pdu octets (if copied)
+    const unsigned char *_data; // pdu octets
+    unsigned long _length;      // number of pdu octets
+    bool _SCtoMEdirection;
+
+    // header fields, valid if _parsed is true
+    mutable bool _parsed;
+    mutable SMSMessage::MessageType _messageTypeIndicator;
+    mutable Address _serviceCentreAddress;
+    mutable Address _address;
+    mutable Timestamp _serviceCentreTimestamp;
+
+    // fully decoded message, decoded on demand
+    mutable SMSMessageRef _message;
+
+    // parse header fields if not done yet
+    void parse() const throw(GsmException);
+
+  public:
+    // create view of hexadecimal pdu string
+    // differentiate between SMS transfer directions SC to ME, ME to SC
+    SMSMessageView(std::string pdu, bool SCtoMEdirection = true)
+      throw(GsmException);
+
+    // create view of length octets of binary pdu
+    // if copyPdu is false the pdu octets are not copied and must
+    // outlive the view (see SMSDecodeArena)
+    SMSMessageView(const unsigned char *pdu, unsigned long length,
+                   bool SCtoMEdirection = true, bool copyPdu = true);
+
+    // copy constructor and assignment
+    SMSMessageView(const SMSMessageView &v);
+    SMSMessageView &operator=(const SMSMessageView &v);
+
+    // accessor functions, these have the same meaning as the
+    // SMSMessage functions of the same name and can be used to
+    // build SMSMapKeys for the SortedSMSStore
+    SMSMessage::MessageType messageType() const throw(GsmException);
+    Address serviceCentreAddress() const throw(GsmException);
+    Timestamp serviceCentreTimestamp() const throw(GsmException);
+    // empty for SMS-DELIVER-REPORT and SMS-SUBMIT-REPORT
+    Address address() const throw(GsmException);
+
+    // return hexadecimal pdu string
+    std::string pdu() const {return bufToHex(_data, _length);}
+    bool SCtoMEdirection() const {return _SCtoMEdirection;}
+
+    // return fully decoded message
+    SMSMessageRef message() const throw(GsmException);
+
+    // create textual representation of SMS
+    std::string toString() const throw(GsmException)
+      {return message()->toString();}
+  };
+
+  typedef Ref<SMSMessageView> SMSMessageViewRef;
+
+  // monotonic memory arena for decoding many PDUs at once
+  // (eg. a store listing or archive file)
+  // PDUs and their views are placed in large blocks, which are all
+  // freed together by clear() or the destructor
+  class SMSDecodeArena : public NoCopy
+  {
+  private:
+    unsigned long _blockSize;   // size of memory blocks
+    std::vector<unsigned char*> _blocks; // allocated memory blocks
+    unsigned char *_next;       // next free octet in current block
+    unsigned long _available;   // free octets in current block
+    std::vector<SMSMessageView*> _views; // views placed in the arena
+
+    // place view of octets already residing in the arena
+    SMSMessageView &addView(const unsigned char *octets,
+                            unsigned long length, bool SCtoMEdirection);
+
+  public:
+    // create arena with given block size
+    SMSDecodeArena(unsigned long blockSize = 65536);
+
+    // allocate length octets, aligned for any type
+    void *allocate(unsigned long length);
+
+    // add hexadecimal pdu string or length octets of binary pdu
+    // return view that is valid until clear() or destruction of the arena
+    // the view must not be wrapped in a Ref<>
+    SMSMessageView &add(const std::string &pdu, bool SCtoMEdirection = true)
+      throw(GsmException);
+    SMSMessageView &add(const unsigned char *pdu, unsigned long length,
+                        bool SCtoMEdirection = true);
+
+    // access to the views in order of addition
+    unsigned int size() const {return _views.size();}
+    SMSMessageView &operator[](unsigned int i) {return *_views[i];}
+
+    // destroy all views and free all memory blocks but the first one
+    void clear();
+
+    // return number of memory blocks allocated
+    unsigned int blocks() const {return _blocks.size();}
+
+    ~SMSDecodeArena();
+  };
 };
 
 #endif // GSM_SMS_H
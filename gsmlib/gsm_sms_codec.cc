@@ -23,6 +23,10 @@
 #include <climits>
 #include <string>
 #include <cstring>
+#if defined(GSM_CPU_DISPATCH) && defined(__x86_64__)
+#include <immintrin.h>
+#define GSM_BMI2_SEPTETS 1
+#endif
 
 using namespace gsmlib;
 
@@ -245,15 +249,120 @@ std::string DataCodingScheme::toString() const
   return result;
 }
 
+// septet packing helpers
+// septet strings are handled eight septets (seven octets) at a time
+// using a little-endian 64-bit window onto the octet buffer
+
+static inline unsigned_int_8 loadOctets(const unsigned char *p)
+{
+  return (unsigned_int_8)p[0] | ((unsigned_int_8)p[1] << 8) |
+    ((unsigned_int_8)p[2] << 16) | ((unsigned_int_8)p[3] << 24) |
+    ((unsigned_int_8)p[4] << 32) | ((unsigned_int_8)p[5] << 40) |
+    ((unsigned_int_8)p[6] << 48) | ((unsigned_int_8)p[7] << 56);
+}
+
+static inline void storeOctets(unsigned char *p, unsigned_int_8 w)
+{
+  for (int i = 0; i < 8; ++i, w >>= 8)
+    p[i] = (unsigned char)w;
+}
+
+// spread the 56 low bits of w to eight 7-bit values, one per octet
+static inline unsigned_int_8 unpackSeptets(unsigned_int_8 w)
+{
+  w = (w & 0x000000000fffffffULL) | ((w << 4) & 0x0fffffff00000000ULL);
+  w = (w & 0x00003fff00003fffULL) | ((w << 2) & 0x3fff00003fff0000ULL);
+  return (w & 0x007f007f007f007fULL) | ((w << 1) & 0x7f007f007f007f00ULL);
+}
+
+// inverse of unpackSeptets(), bit 7 of each octet is ignored
+static inline unsigned_int_8 packSeptets(unsigned_int_8 w)
+{
+  w = (w & 0x007f007f007f007fULL) | ((w >> 1) & 0x3f803f803f803f80ULL);
+  w = (w & 0x00003fff00003fffULL) | ((w >> 2) & 0x0fffc0000fffc000ULL);
+  return (w & 0x000000000fffffffULL) | ((w >> 4) & 0x00fffffff0000000ULL);
+}
+
+#ifdef GSM_BMI2_SEPTETS
+GSM_TARGET("bmi2")
+static void unpackSeptetsBMI2(const unsigned char *op, short bi,
+                              unsigned char *s, unsigned int groups)
+{
+  for (unsigned int i = 0; i < groups; ++i, op += 7, s += 8)
+    storeOctets(s, _pdep_u64(loadOctets(op) >> bi, 0x7f7f7f7f7f7f7f7fULL));
+}
+
+GSM_TARGET("bmi2")
+static void packSeptetsBMI2(const unsigned char *s, short bi,
+                            unsigned char *op, unsigned int groups)
+{
+  for (unsigned int i = 0; i < groups; ++i, op += 7, s += 8)
+    storeOctets(op, loadOctets(op) |
+                (_pext_u64(loadOctets(s), 0x7f7f7f7f7f7f7f7fULL) << bi));
+}
+
+// PDEP/PEXT are microcoded (slow) on AMD CPUs before Zen 3,
+// so only use them on Intel
+static bool useBMI2Septets = GSM_CPU_IS("intel") && GSM_CPU_SUPPORTS("bmi2");
+#endif
+
+// unpack groups of eight septets starting at bit bi of op to s
+static void unpackSeptetGroups(const unsigned char *op, short bi,
+                               unsigned char *s, unsigned int groups)
+{
+#ifdef GSM_BMI2_SEPTETS
+  if (useBMI2Septets)
+  {
+    unpackSeptetsBMI2(op, bi, s, groups);
+    return;
+  }
+#endif
+  for (unsigned int i = 0; i < groups; ++i, op += 7, s += 8)
+    storeOctets(s, unpackSeptets(loadOctets(op) >> bi));
+}
+
+// pack groups of eight characters from s to bit bi of op
+// the octets following op must be zero
+static void packSeptetGroups(const unsigned char *s, short bi,
+                             unsigned char *op, unsigned int groups)
+{
+#ifdef GSM_BMI2_SEPTETS
+  if (useBMI2Septets)
+  {
+    packSeptetsBMI2(s, bi, op, groups);
+    return;
+  }
+#endif
+  for (unsigned int i = 0; i < groups; ++i, op += 7, s += 8)
+    storeOctets(op, loadOctets(op) | (packSeptets(loadOctets(s)) << bi));
+}
+
   // SMSDecoder members
 
-SMSDecoder::SMSDecoder(std::string pdu) : _bi(0), _septetStart(NULL)
+void SMSDecoder::allocate(unsigned long length)
 {
-  _p = new unsigned char[pdu.length() / 2];
+  _p = length <= InlinePduLength ? _inlineBuffer : new unsigned char[length];
   _op = _p;
+  _maxop = _p + length;
+}
+
+SMSDecoder::SMSDecoder(const std::string &pdu) :
+  _bi(0), _septetStart(NULL)
+{
+  allocate(pdu.length() / 2);
   if (! hexToBuf(pdu, _p))
+  {
+    if (_p != _inlineBuffer)
+      delete[] _p;
     throw GsmException(_("bad hexadecimal PDU format"), SMSFormatError);
-  _maxop = _op + pdu.length() / 2;
+  }
+}
+
+SMSDecoder::SMSDecoder(const unsigned char *pdu, unsigned long length) :
+  _bi(0), _septetStart(NULL)
+{
+  allocate(length);
+  memcpy(_p, pdu, length);
 }
 
 void SMSDecoder::alignOctet()
@@ -391,22 +500,56 @@ unsigned long SMSDecoder::getTimeZone(bool &negativeTimeZone)
 
 unsigned long SMSDecoder::getInteger(unsigned short length)
 {
+  assert(length <= 32);
   unsigned long result = 0;
-  for (unsigned short i = 0; i < length; ++i)
-    result |= (getBit() << i);
+  // take as many bits as possible from the current octet at a time
+  for (unsigned short i = 0; i < length;)
+    {
+      if (_op >= _maxop)
+	throw GsmException(_("premature end of PDU"), SMSFormatError);
+      unsigned short n = MIN(8 - _bi, length - i);
+      result |= (unsigned long)((*_op >> _bi) & ((1 << n) - 1)) << i;
+      i += n;
+      _bi += n;
+      if (_bi == 8)
+	{
+	  _bi = 0;
+	  ++_op;
+	}
+    }
   return result;
 }
 
 std::string SMSDecoder::getString(unsigned short length)
 {
-  std::string result;
   alignSeptet();
-  for (unsigned short i = 0; i < length; ++i)
+  std::string result(length, '\0');
+  if (length == 0)
+    return result;
+  unsigned char *s = (unsigned char*)&result[0];
+
+  // eight septets at a time while the 64-bit window fits into the PDU
+  unsigned int groups = MIN((unsigned int)length / 8,
+                            _maxop - _op >= 8 ?
+                            (unsigned int)(_maxop - _op - 1) / 7 : 0);
+  unpackSeptetGroups(_op, _bi, s, groups);
+  _op += groups * 7;
+
+  // remaining septets one at a time
+  for (unsigned short i = groups * 8; i < length; ++i)
     {
-      unsigned char c = 0;
-      for (unsigned short j = 0; j < 7; ++j)
-	c |= getBit() << j;
-      result += c;
+      if (_op >= _maxop || (_bi > 1 && _op + 1 >= _maxop))
+	throw GsmException(_("premature end of PDU"), SMSFormatError);
+      unsigned int c = *_op >> _bi;
+      if (_bi > 1)
+	c |= _op[1] << (8 - _bi);
+      s[i] = c & 0x7f;
+      _bi += 7;
+      if (_bi >= 8)
+	{
+	  _bi -= 8;
+	  ++_op;
+	}
     }
   return result;
 }
@@ -477,7 +620,8 @@ TimePeriod SMSDecoder::getTimePeriod(TimePeriod::Format format)
 
 SMSDecoder::~SMSDecoder()
 {
-  delete _p;
+  if (_p != _inlineBuffer)
+    delete[] _p;
 }
 
   // SMSEncoder members
@@ -561,18 +705,47 @@ void SMSEncoder::setTimeZone(bool negativeTimeZone, unsigned long timeZone)
 
 void SMSEncoder::setInteger(unsigned long intvalue, unsigned short length)
 {
-  for (unsigned short i = 0; i < length; ++i)
-    setBit((intvalue & (1 << i)) != 0);
+  assert(length <= 32);
+  // fill up the current octet at a time
+  for (unsigned short i = 0; i < length;)
+    {
+      unsigned short n = MIN(8 - _bi, length - i);
+      *_op |= ((intvalue >> i) & ((1 << n) - 1)) << _bi;
+      i += n;
+      _bi += n;
+      if (_bi == 8)
+	{
+	  _bi = 0;
+	  ++_op;
+	}
+    }
 }
 
 void SMSEncoder::setString(std::string stringValue)
 {
   alignSeptet();
-  for (unsigned int i = 0; i < stringValue.length(); ++i)
+  const unsigned char *s = (const unsigned char*)stringValue.data();
+  unsigned int length = stringValue.length();
+
+  // eight septets at a time while the 64-bit window fits into the buffer
+  unsigned int groups = MIN(length / 8, (unsigned int)
+                            (_p + sizeof(_p) - _op - 1) / 7);
+  packSeptetGroups(s, _bi, _op, groups);
+  _op += groups * 7;
+
+  // remaining septets one at a time
+  for (unsigned int i = groups * 8; i < length; ++i)
     {
-      unsigned char c = stringValue[i];
-      for (unsigned short j = 0; j < 7; ++j)
-	setBit(((1 << j) & c) != 0);
+      unsigned int c = (s[i] & 0x7f) << _bi;
+      *_op |= c;
+      if (_bi > 1)
+	_op[1] |= c >> 8;
+      _bi += 7;
+      if (_bi >= 8)
+	{
+	  _bi -= 8;
+	  ++_op;
+	}
     }
 }
 
@@ -594,7 +767,7 @@ void SMSEncoder::setAddress(Address &address, bool scAddressFormat)
   else
     if (address._type == Address::Alphanumeric)
       // address in GSM default encoding, see also comment in getAddress()
-      setOctet((address._number.length() * 7 + 6) / 8 * 2);
+      setOctet((latin1ToGsm(address._number).length() * 7 + 6) / 8 * 2);
     else
       setOctet(address._number.length());
 
@@ -684,17 +857,40 @@ void UserDataHeader::decode(SMSDecoder &d)
   _udh = ss;
 }
 
-std::string UserDataHeader::getIE(unsigned char id)
+std::string UserDataHeader::getIE(unsigned char id) const
 {
   int udhl, pos = 0;
 
   udhl = _udh.length();
-  while (pos < udhl)
+  while (pos + 2 <= udhl)
     {
       unsigned char iei = _udh[pos++];
       unsigned char ieidl = _udh[pos++];
+      if (pos + ieidl > udhl) break; // truncated information element
       if (iei == id) return _udh.substr(pos, ieidl);
       pos += ieidl;
     }
   return "";
 }
+
+void UserDataHeader::addIE(unsigned char id, const std::string &data)
+{
+  assert(data.length() < 256);
+  _udh += (char)id;
+  _udh += (char)data.length();
+  _udh += data;
+}
+
+void UserDataHeader::removeIE(unsigned char id)
+{
+  std::string result;
+  unsigned int pos = 0;
+  while (pos + 2 <= _udh.length())
+  {
+    unsigned int length = 2 + (unsigned char)_udh[pos + 1];
+    if ((unsigned char)_udh[pos] != id)
+      result += _udh.substr(pos, length);
+    pos += length;
+  }
+  _udh = result;
+}
@@ -150,6 +150,11 @@ namespace gsmlib
   // utility class facilitate SMS TPDU decoding
   class SMSDecoder
   {
+  public:
+    // PDUs up to this length (in octets) are decoded without
+    // allocating memory (largest SMS TPDU with SC address is 176 octets)
+    static const unsigned int InlinePduLength = 192;
+
   private:
     unsigned char *_p;          // buffer to hold pdu
     short _bi;                  // bit index (0..7)
@@ -157,10 +162,21 @@ namespace gsmlib
     unsigned char *_septetStart; // start of septet string
 
     unsigned char *_maxop;      // pointer to last byte after _p
+    unsigned char _inlineBuffer[InlinePduLength];
+
+    // allocate buffer for length octets
+    void allocate(unsigned long length);
+
+    // not copyable
+    SMSDecoder(const SMSDecoder &);
+    SMSDecoder &operator=(const SMSDecoder &);
 
   public:
     // initialize with a hexadecimal octet std::string containing SMS TPDU
-    SMSDecoder(std::string pdu);
+    SMSDecoder(const std::string &pdu);
+
+    // initialize with length octets of binary SMS TPDU
+    SMSDecoder(const unsigned char *pdu, unsigned long length);
 
     // align to octet border
     void alignOctet();
@@ -171,6 +187,9 @@ namespace gsmlib
     // align to septet border
     void alignSeptet();
 
+    // return true if all octets have been decoded
+    bool atEnd() const {return _op + (_bi != 0 ? 1 : 0) >= _maxop;}
+
     // get single bit
     bool getBit()
     {
@@ -322,7 +341,13 @@ namespace gsmlib
     void decode(SMSDecoder &d);
 
     // return a given information element, if present, or an empty string
-    std::string getIE(unsigned char id);
+    std::string getIE(unsigned char id) const;
+
+    // append information element with the given data
+    void addIE(unsigned char id, const std::string &data);
+
+    // remove all information elements with the given id
+    void removeIE(unsigned char id);
 
     // return the size of the header
     unsigned int length() const {return _udh.length();}
@@ -0,0 +1,252 @@
+// *************************************************************************
+// * GSM TA/ME library
+// *
+// * File:    gsm_sms_reassembly.cc
+// *
+// * Purpose: Reassembly of concatenated SMS messages
+// *          (ETSI GSM 03.40 section 9.2.3.24.1 and 9.2.3.24.8)
+// *
+// * Created: 18.10.2026
+// *************************************************************************
+
+#ifdef HAVE_CONFIG_H
+#include <gsm_config.h>
+#endif
+#include <gsmlib/gsm_nls.h>
+#include <gsmlib/gsm_sms_reassembly.h>
+#include <sstream>
+#include <assert.h>
+
+using namespace gsmlib;
+
+// information element identifiers for concatenated messages
+static const unsigned char IEIConcatenated8Bit = 0x00;
+static const unsigned char IEIConcatenated16Bit = 0x08;
+
+bool gsmlib::getConcatenation(UserDataHeader udh,
+                              SMSConcatenation &concatenation)
+{
+  if (udh.length() == 0)
+    return false;
+
+  std::string ie = udh.getIE(IEIConcatenated8Bit);
+  if (ie.length() == 3)
+  {
+    concatenation._reference = (unsigned char)ie[0];
+    concatenation._sixteenBitReference = false;
+  }
+  else
+  {
+    ie = udh.getIE(IEIConcatenated16Bit);
+    if (ie.length() != 4)
+      return false;
+    concatenation._reference =
+      (unsigned char)ie[0] << 8 | (unsigned char)ie[1];
+    concatenation._sixteenBitReference = true;
+    ie.erase(0, 1);
+  }
+  concatenation._total = ie[1];
+  concatenation._sequence = ie[2];
+
+  // information elements with invalid numbers are ignored
+  // (GSM 03.40 section 9.2.3.24.1)
+  return concatenation._total != 0 && concatenation._sequence != 0 &&
+    concatenation._sequence <= concatenation._total;
+}
+
+// ReassembledSMS members
+
+SMSMessageRef ReassembledSMS::firstPart() const
+{
+  for (std::vector<SMSMessageRef>::const_iterator i = _parts.begin();
+       i != _parts.end(); ++i)
+    if (! i->isnull())
+      return *i;
+  assert(0);
+  return SMSMessageRef();
+}
+
+std::string ReassembledSMS::userData() const
+{
+  std::string result;
+  for (std::vector<SMSMessageRef>::const_iterator i = _parts.begin();
+       i != _parts.end(); ++i)
+    if (! i->isnull())
+      result += (*i)->userData();
+  return result;
+}
+
+std::string ReassembledSMS::toString() const
+{
+  // unconcatenated messages are shown as they are
+  if (_parts.size() == 1 && ! _parts[0].isnull())
+    return _parts[0]->toString();
+
+  // concatenated messages are SMS-DELIVER or SMS-SUBMIT
+  SMSMessageRef first = firstPart();
+  bool submit = dynamic_cast<SMSSubmitMessage*>(first.getptr()) != NULL;
+  unsigned int received = 0;
+  for (std::vector<SMSMessageRef>::const_iterator i = _parts.begin();
+       i != _parts.end(); ++i)
+    if (! i->isnull())
+      ++received;
+
+  std::ostringstream os;
+  os << "------------------------------------------------------------"
+    "---------------" << std::endl
+     << (submit ? _("Message type: SMS-SUBMIT") :
+         _("Message type: SMS-DELIVER")) << std::endl
+     << (submit ? _("Destination address: '") :
+         _("Originating address: '")) << address()._number << "'"
+     << std::endl
+     << _("Data coding scheme: ") << dataCodingScheme().toString()
+     << std::endl;
+  if (! submit)
+    os << _("SC timestamp: ") << serviceCentreTimestamp().toString()
+       << std::endl;
+  os << _("Parts: ") << received << _(" of ") << _parts.size()
+     << (_complete ? "" : _(" (incomplete)")) << std::endl
+     << _("User data: '") << userData() << "'" << std::endl
+     << "------------------------------------------------------------"
+    "---------------" << std::endl << std::endl;
+  return os.str();
+}
+
+// SMSReassembler members
+
+bool SMSReassembler::Key::operator<(const Key &k) const
+{
+  if (_reference != k._reference)
+    return _reference < k._reference;
+  if (_total != k._total)
+    return _total < k._total;
+  if (_sixteenBitReference != k._sixteenBitReference)
+    return _sixteenBitReference < k._sixteenBitReference;
+  return _originator < k._originator;
+}
+
+SMSReassembler::SMSReassembler(unsigned int timeout,
+                               unsigned int maxMessages,
+                               unsigned long maxOctets) :
+  _timeout(timeout), _maxMessages(maxMessages == 0 ? 1 : maxMessages),
+  _maxOctets(maxOctets), _pendingOctets(0)
+{
+}
+
+void SMSReassembler::release(std::map<Key, Partial>::iterator i,
+                             bool complete)
+{
+  _ready.push_back(ReassembledSMS());
+  _ready.back()._parts.swap(i->second._parts);
+  _ready.back()._complete = complete;
+  _pendingOctets -= i->second._octets;
+  _lruList.erase(i->second._lru);
+  _partials.erase(i);
+}
+
+bool SMSReassembler::add(SMSMessageRef sms, time_t now)
+{
+  if (now == 0)
+    now = time(NULL);
+
+  SMSConcatenation concatenation;
+  if (! getConcatenation(sms->userDataHeader(), concatenation) ||
+      concatenation._total == 1)
+  {
+    _ready.push_back(ReassembledSMS());
+    _ready.back()._parts.push_back(sms);
+    _ready.back()._complete = true;
+    return true;
+  }
+  ++_statistics._parts;
+
+  Key key;
+  key._originator = sms->address().toString();
+  key._reference = concatenation._reference;
+  key._sixteenBitReference = concatenation._sixteenBitReference;
+  key._total = concatenation._total;
+
+  // evicted messages are ready, too
+  bool released = false;
+  std::map<Key, Partial>::iterator i = _partials.find(key);
+  if (i == _partials.end())
+  {
+    // make room for a new partial message
+    while (_partials.size() >= _maxMessages)
+    {
+      ++_statistics._evicted;
+      release(_partials.find(_lruList.front()), false);
+      released = true;
+    }
+    i = _partials.insert(std::make_pair(key, Partial())).first;
+    i->second._parts.resize(concatenation._total);
+    i->second._received = 0;
+    i->second._octets = 0;
+    i->second._lru = _lruList.insert(_lruList.end(), key);
+  }
+  else
+    _lruList.splice(_lruList.end(), _lruList, i->second._lru);
+  Partial &partial = i->second;
+  partial._lastActivity = now;
+
+  SMSMessageRef &part = partial._parts[concatenation._sequence - 1];
+  if (! part.isnull())
+  {
+    ++_statistics._duplicates;
+    return released;
+  }
+  part = sms;
+  ++partial._received;
+  unsigned long octets = sms->userData().length();
+  partial._octets += octets;
+  _pendingOctets += octets;
+
+  if (partial._received == concatenation._total)
+  {
+    ++_statistics._completed;
+    release(i, true);
+    return true;
+  }
+
+  // keep within the memory limit, the current message goes last
+  while (_pendingOctets > _maxOctets && _partials.size() > 1)
+  {
+    ++_statistics._evicted;
+    release(_partials.find(_lruList.front()), false);
+    released = true;
+  }
+  return released;
+}
+
+void SMSReassembler::expire(time_t now)
+{
+  if (_timeout == 0)
+    return;
+  if (now == 0)
+    now = time(NULL);
+
+  // least recently active partial messages come first
+  while (! _lruList.empty())
+  {
+    std::map<Key, Partial>::iterator i = _partials.find(_lruList.front());
+    if (now - i->second._lastActivity < (time_t)_timeout)
+      break;
+    ++_statistics._expired;
+    release(i, false);
+  }
+}
+
+void SMSReassembler::flush()
+{
+  while (! _lruList.empty())
+    release(_partials.find(_lruList.front()), false);
+}
+
+bool SMSReassembler::next(ReassembledSMS &message)
+{
+  if (_ready.empty())
+    return false;
+  message = _ready.front();
+  _ready.pop_front();
+  return true;
+}
@@ -0,0 +1,159 @@
+// *************************************************************************
+// * GSM TA/ME library
+// *
+// * File:    gsm_sms_reassembly.h
+// *
+// * Purpose: Reassembly of concatenated SMS messages
+// *          (ETSI GSM 03.40 section 9.2.3.24.1 and 9.2.3.24.8)
+// *
+// * Created: 18.10.2026
+// *************************************************************************
+
+#ifndef GSM_SMS_REASSEMBLY_H
+#define GSM_SMS_REASSEMBLY_H
+
+#include <gsmlib/gsm_sms.h>
+#include <gsmlib/gsm_util.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <list>
+#include <map>
+#include <time.h>
+
+namespace gsmlib
+{
+  // concatenation information element of an SMS
+  struct SMSConcatenation
+  {
+    unsigned int _reference;    // reference number of the message
+    bool _sixteenBitReference;  // reference from IEI 0x08 (else IEI 0x00)
+    unsigned char _total;       // number of parts
+    unsigned char _sequence;    // number of this part (1.._total)
+
+    SMSConcatenation() : _reference(0), _sixteenBitReference(false),
+      _total(1), _sequence(1) {}
+  };
+
+  // return true and fill in concatenation if the user data header
+  // contains a valid concatenation information element (IEI 0x00 or 0x08)
+  bool getConcatenation(UserDataHeader udh, SMSConcatenation &concatenation);
+
+  // message reassembled from one or several SMS messages
+  struct ReassembledSMS
+  {
+    std::vector<SMSMessageRef> _parts; // parts in sequence order,
+                                // missing parts are null
+    bool _complete;             // false if parts are missing (timeout)
+
+    ReassembledSMS() : _complete(false) {}
+
+    // return first part that has been received
+    SMSMessageRef firstPart() const;
+
+    // return originating address, data coding scheme and
+    // timestamp of the first part
+    Address address() const {return firstPart()->address();}
+    DataCodingScheme dataCodingScheme() const
+      {return firstPart()->dataCodingScheme();}
+    Timestamp serviceCentreTimestamp() const
+      {return firstPart()->serviceCentreTimestamp();}
+
+    // return user data of all parts that have been received
+    // (Latin-1 for the default alphabet, octets otherwise)
+    std::string userData() const;
+
+    // create textual representation
+    std::string toString() const;
+  };
+
+  // Collects the parts of concatenated SMS messages and returns complete
+  // messages. Parts are grouped by originating address, reference
+  // number and number of parts. Partial messages whose last part
+  // arrived more than timeout seconds ago are returned incomplete by
+  // expire(). If more than maxMessages partial messages or more than
+  // maxOctets octets of user data are pending, the least recently
+  // active partial message is returned incomplete.
+  // SMS messages that are not concatenated are returned unchanged.
+
+  class SMSReassembler : public NoCopy
+  {
+  public:
+    // statistics
+    struct Statistics
+    {
+      unsigned long _parts;     // concatenated parts added
+      unsigned long _duplicates; // parts that were already present
+      unsigned long _completed; // concatenated messages completed
+      unsigned long _expired;   // incomplete messages after timeout
+      unsigned long _evicted;   // incomplete messages due to limits
+
+      Statistics() : _parts(0), _duplicates(0), _completed(0),
+        _expired(0), _evicted(0) {}
+    };
+
+  private:
+    // identification of a partial message
+    struct Key
+    {
+      std::string _originator;  // type and number of originating address
+      unsigned int _reference;
+      bool _sixteenBitReference;
+      unsigned char _total;
+
+      bool operator<(const Key &k) const;
+    };
+
+    // partial message
+    struct Partial
+    {
+      std::vector<SMSMessageRef> _parts;
+      unsigned int _received;   // number of parts received
+      unsigned long _octets;    // user data octets received
+      time_t _lastActivity;     // time last part was added
+      std::list<Key>::iterator _lru; // position in _lruList
+    };
+
+    unsigned int _timeout;
+    unsigned int _maxMessages;
+    unsigned long _maxOctets;
+    std::map<Key, Partial> _partials;
+    std::list<Key> _lruList;    // least recently active first
+    unsigned long _pendingOctets;
+    std::deque<ReassembledSMS> _ready;
+    Statistics _statistics;
+
+    // move partial message i to _ready
+    void release(std::map<Key, Partial>::iterator i, bool complete);
+
+  public:
+    SMSReassembler(unsigned int timeout = 3600,
+                   unsigned int maxMessages = 256,
+                   unsigned long maxOctets = 256 * 1024);
+
+    // add received SMS, return true if a message is ready to be
+    // retrieved with next()
+    // now is the current time (0 = time(NULL))
+    bool add(SMSMessageRef sms, time_t now = 0);
+
+    // release partial messages that have timed out
+    void expire(time_t now = 0);
+
+    // release all partial messages (e.g. at program termination)
+    void flush();
+
+    // return next complete or released message, false if none
+    bool next(ReassembledSMS &message);
+
+    // number of messages ready to be retrieved
+    unsigned int ready() const {return _ready.size();}
+
+    // number of partial messages and their user data octets
+    unsigned int pendingMessages() const {return _partials.size();}
+    unsigned long pendingOctets() const {return _pendingOctets;}
+
+    const Statistics &statistics() const {return _statistics;}
+  };
+};
+
+#endif // GSM_SMS_REASSEMBLY_H
@@ -14,17 +14,20 @@
 #ifdef HAVE_CONFIG_H
 #include <gsm_config.h>
 #endif
+#include <gsmlib/gsm_nls.h>
 #include <gsmlib/gsm_sms_store.h>
 #include <gsmlib/gsm_parser.h>
 #include <gsmlib/gsm_me_ta.h>
 #include <iostream>
+#include <algorithm>
 
 using namespace gsmlib;
 
 // SMSStoreEntry members
 
 SMSStoreEntry::SMSStoreEntry() :
-   _status(Unknown), _cached(false), _mySMSStore(NULL), _index(0)
+   _status(Unknown), _cached(false), _mySMSStore(NULL), _index(0),
+   _pdu(NULL), _pduLength(0), _SCtoMEdirection(true), _changed(false)
 {
 }
 
@@ -33,15 +36,33 @@ SMSMessageRef SMSStoreEntry::message() const throw(GsmException)
 {
   if (! cached())
   {
-    assert(_mySMSStore != NULL);
     // these operations are at least "logically const"
     SMSStoreEntry *thisEntry = const_cast<SMSStoreEntry*>(this);
-    _mySMSStore->readEntry(_index, thisEntry->_message, thisEntry->_status);
+    if (_pdu != NULL)
+      thisEntry->_message =
+        SMSMessage::decode(std::string(_pdu, _pduLength), _SCtoMEdirection);
+    else
+    {
+      assert(_mySMSStore != NULL);
+      _mySMSStore->readEntry(_index, thisEntry->_message,
+                             thisEntry->_status);
+    }
     thisEntry->_cached = true;
   }
   return _message;
 }
 
+Ref<SMSMessageView> SMSStoreEntry::headerView() const throw(GsmException)
+{
+  if (_pdu == NULL || _cached)
+    return Ref<SMSMessageView>();
+
+  // the header fields end within the first 34 octets (maximum
+  // service centre address, address, status report fields, timestamp)
+  unsigned int length = _pduLength < 68 ? _pduLength : 68;
+  return new SMSMessageView(std::string(_pdu, length), _SCtoMEdirection);
+}
+
 CBMessageRef SMSStoreEntry::cbMessage() const throw(GsmException)
 {
   assert(_mySMSStore != NULL);
@@ -59,7 +80,7 @@ CBMessageRef SMSStoreEntry::cbMessage() const throw(GsmException)
 SMSStoreEntry::SMSMemoryStatus SMSStoreEntry::status() const
   throw(GsmException)
 {
-  if (! cached())
+  if (! cached() && _pdu == NULL)
   {
     assert(_mySMSStore != NULL);
     // these operations are at least "logically const"
@@ -97,7 +118,7 @@ bool SMSStoreEntry::cached() const
 
 Ref<SMSStoreEntry> SMSStoreEntry::clone()
 {
-  Ref<SMSStoreEntry> result = new SMSStoreEntry(_message->clone());
+  Ref<SMSStoreEntry> result = new SMSStoreEntry(message()->clone());
   result->_status = _status;
   result->_index = _index;
   return result;
@@ -105,6 +126,8 @@ Ref<SMSStoreEntry> SMSStoreEntry::clone()
 
 bool SMSStoreEntry::operator==(const SMSStoreEntry &e) const
 {
+  if (_pdu != NULL || e._pdu != NULL)
+    return message()->encode() == e.message()->encode();
   if (_message.isnull() || e._message.isnull())
     return _message.isnull() && e._message.isnull();
   else
@@ -118,15 +141,26 @@ SMSStoreEntry::SMSStoreEntry(const SMSStoreEntry &e)
  _cached = e._cached;
  _mySMSStore = e._mySMSStore;
  _index = e._index;
+ _pdu = e._pdu;
+ _pduLength = e._pduLength;
+ _SCtoMEdirection = e._SCtoMEdirection;
+ _changed = false;
 }
 
 SMSStoreEntry &SMSStoreEntry::operator=(const SMSStoreEntry &e)
 {
+ // entries of file-based stores keep their index, it identifies the
+ // message in the file
+ if (_mySMSStore != NULL || e._mySMSStore != NULL)
+   _index = e._index;
  _message = e._message;
  _status = e._status;
  _cached = e._cached;
  _mySMSStore = e._mySMSStore;
- _index = e._index;
+ _pdu = e._pdu;
+ _pduLength = e._pduLength;
+ _SCtoMEdirection = e._SCtoMEdirection;
+ _changed = true;
  return *this;
 }
 
@@ -172,6 +206,7 @@ void SMSStore::readEntry(int index, SMSMessageRef &message,
 {
   // select SMS store
   _meTa.setSMSStore(_storeName, 1);
+  _listedReceived.clear();
 
 #ifndef NDEBUG
   if (debugLevel() >= 1)
@@ -224,6 +259,7 @@ void SMSStore::readEntry(int index, CBMessageRef &message)
 {
   // select SMS store
   _meTa.setSMSStore(_storeName, 1);
+  _listedReceived.clear();
 
 #ifndef NDEBUG
   if (debugLevel() >= 1)
@@ -262,6 +298,7 @@ void SMSStore::writeEntry(int &index, SMSMessageRef message)
 {
   // select SMS store
   _meTa.setSMSStore(_storeName, 2);
+  _listedReceived.clear();
 
 #ifndef NDEBUG
   if (debugLevel() >= 1)
@@ -293,6 +330,7 @@ void SMSStore::eraseEntry(int index) throw(GsmException)
 {
   // Select SMS store
   _meTa.setSMSStore(_storeName, 1);
+  _listedReceived.clear();
 
 #ifndef NDEBUG
   if (debugLevel() >= 1)
@@ -479,6 +517,105 @@ void SMSStore::clear() throw(GsmException)
     erase(i);
 }
 
+std::vector<int> SMSStore::readAll() throw(GsmException)
+{
+  // select SMS store
+  _meTa.setSMSStore(_storeName, 1);
+
+#ifndef NDEBUG
+  if (debugLevel() >= 1)
+    std::cerr << "*** Listing SMS entries" << std::endl;
+#endif // NDEBUG
+
+  // each entry is a line "<index>,<stat>,[<alpha>],<length>" followed
+  // by the PDU
+  std::vector<std::string> lines =
+    _at->chatv("+CMGL=" + intToStr(SMSStoreEntry::All), "+CMGL:");
+
+  for (std::vector<SMSStoreEntry*>::iterator i = _store.begin();
+       i != _store.end(); ++i)
+  {
+    (*i)->_message = SMSMessageRef();
+    (*i)->_status = SMSStoreEntry::Unknown;
+    (*i)->_cached = true;
+  }
+
+  std::vector<int> result;
+  std::vector<int> received;
+  for (std::vector<std::string>::iterator i = lines.begin();
+       i != lines.end(); i += 2)
+  {
+    if (i + 1 == lines.end())
+      throw GsmException(_("missing PDU in +CMGL response"), ParserError);
+    Parser p(*i);
+    int index = p.parseInt() - 1;
+    p.parseComma();
+    SMSStoreEntry::SMSMemoryStatus status =
+      (SMSStoreEntry::SMSMemoryStatus)p.parseInt();
+    if (index < 0)
+      throw GsmException(
+        stringPrintf(_("invalid index %d in +CMGL response"), index + 1),
+        ParserError);
+
+    // add missing service centre address if required by ME
+    std::string pdu = *(i + 1);
+    if (! _at->getMeTa().getCapabilities()._hasSMSSCAprefix)
+      pdu = "00" + pdu;
+
+    resizeStore(index + 1);
+    SMSStoreEntry &entry = *_store[index];
+    entry._message =
+      SMSMessage::decode(pdu,
+                         !(status == SMSStoreEntry::StoredUnsent ||
+                           status == SMSStoreEntry::StoredSent),
+                         _at.getptr());
+    entry._status = status;
+    entry._cached = true;
+    result.push_back(index);
+    if (status == SMSStoreEntry::ReceivedUnread ||
+        status == SMSStoreEntry::ReceivedRead)
+      received.push_back(index);
+  }
+  std::sort(received.begin(), received.end());
+  _listedReceived.swap(received);
+  return result;
+}
+
+void SMSStore::erase(std::vector<int> indices) throw(GsmException)
+{
+  std::sort(indices.begin(), indices.end());
+  bool allListed = indices.size() > 1 && indices == _listedReceived;
+  _listedReceived.clear();
+
+  if (allListed)
+  {
+    _meTa.setSMSStore(_storeName, 1);
+
+#ifndef NDEBUG
+    if (debugLevel() >= 1)
+      std::cerr << "*** Erasing all read SMS entries" << std::endl;
+#endif
+
+    // MEs that do not support the delete flag report an error,
+    // then the entries are erased one by one
+    try
+    {
+      _at->chat("+CMGD=" + intToStr(indices.front() + 1) + ",1");
+      for (std::vector<int>::iterator i = indices.begin();
+           i != indices.end(); ++i)
+        _store[*i]->_cached = false;
+      return;
+    }
+    catch (GsmException &)
+    {
+    }
+  }
+
+  for (std::vector<int>::iterator i = indices.begin();
+       i != indices.end(); ++i)
+    erase(SMSStoreIterator(*i, this));
+}
+
 SMSStore::~SMSStore()
 {
   for (std::vector<SMSStoreEntry*>::iterator i = _store.begin();
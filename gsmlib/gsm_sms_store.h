@@ -43,6 +43,10 @@ namespace gsmlib
     bool _cached;
     SMSStore *_mySMSStore;
     int _index;
+    const char *_pdu;           // hexadecimal pdu decoded on first access
+    unsigned int _pduLength;
+    bool _SCtoMEdirection;
+    bool _changed;              // set by assignment
 
   public:
     // this constructor is only used by SMSStore
@@ -51,20 +55,38 @@ namespace gsmlib
     // create new entry given a SMS message
     SMSStoreEntry(SMSMessageRef message) :
       _message(message), _status(Unknown), _cached(true), _mySMSStore(NULL),
-      _index(0) {}
+      _index(0), _pdu(NULL), _pduLength(0), _SCtoMEdirection(true),
+      _changed(false) {}
 
     // create new entry given a SMS message and an index
     // only to be used for file-based stores (see gsm_sorted_sms_store)
     SMSStoreEntry(SMSMessageRef message, int index) :
       _message(message), _status(Unknown), _cached(true), _mySMSStore(NULL),
-      _index(index) {}
-   
+      _index(index), _pdu(NULL), _pduLength(0), _SCtoMEdirection(true),
+      _changed(false) {}
+
+    // create new entry given pduLength characters of hexadecimal pdu
+    // that is only decoded when the message is accessed, the pdu must
+    // outlive the entry
+    // only to be used for file-based stores (see gsm_sorted_sms_store)
+    SMSStoreEntry(const char *pdu, unsigned int pduLength,
+                  bool SCtoMEdirection, int index) :
+      _status(Unknown), _cached(false), _mySMSStore(NULL), _index(index),
+      _pdu(pdu), _pduLength(pduLength), _SCtoMEdirection(SCtoMEdirection),
+      _changed(false) {}
+
     // clear cached flag
     void clearCached() { _cached = false; }
 
     // return SMS message stored in the entry
     SMSMessageRef message() const throw(GsmException);
 
+    // return view of the header of an entry created from a hexadecimal
+    // pdu that has not been decoded yet, null otherwise
+    // only the header fields of the view (messageType(), address(),
+    // serviceCentreTimestamp()) may be used
+    Ref<SMSMessageView> headerView() const throw(GsmException);
+
     // return CB message stored in the entry
     CBMessageRef cbMessage() const throw(GsmException);
 
@@ -89,6 +111,12 @@ namespace gsmlib
     // return true if entry is cached (and caching is enabled)
     bool cached() const;
 
+    // return true if the entry has been assigned to since the last
+    // resetChanged() (the key of the entry in a SortedSMSStore may be
+    // outdated then)
+    bool changed() const {return _changed;}
+    void resetChanged() {_changed = false;}
+
     // return deep copy of this entry
     Ref<SMSStoreEntry> clone();
 
@@ -99,6 +127,7 @@ namespace gsmlib
     SMSStore *getStore() {return _mySMSStore;}
 
     // copy constructor and assignment
+    // assignment keeps the index of entries of file-based stores
     SMSStoreEntry(const SMSStoreEntry &e);
     SMSStoreEntry &operator=(const SMSStoreEntry &e);
 
@@ -195,6 +224,9 @@ namespace gsmlib
     Ref<GsmAt> _at;             // my GsmAt class
     MeTa &_meTa;                // my MeTa class
     bool _useCache;             // true if entries should be cached
+    std::vector<int> _listedReceived; // received messages listed by the
+                                // last readAll() (sorted, empty if other
+                                // accesses have happened since)
 
     // internal access functions
     // read/write entry from/to ME
@@ -279,6 +311,18 @@ namespace gsmlib
     iterator erase(iterator first, iterator last) throw(GsmException);
     void clear() throw(GsmException);
 
+    // read all entries with a single +CMGL and cache them (regardless
+    // of the cache mode), entries not listed are cached as empty
+    // the ME marks received unread messages as read when listing them
+    // return indices of the entries read
+    std::vector<int> readAll() throw(GsmException);
+
+    // erase the entries with the given indices
+    // if they are exactly the received messages of the preceding
+    // readAll(), a single +CMGD with delete flag 1 (all read messages)
+    // is used, messages received after readAll() are unread and kept
+    void erase(std::vector<int> indices) throw(GsmException);
+
     // destructor
     ~SMSStore();
 
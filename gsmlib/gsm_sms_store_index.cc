@@ -0,0 +1,305 @@
+// *************************************************************************
+// * GSM TA/ME library
+// *
+// * File:    gsm_sms_store_index.cc
+// *
+// * Purpose: Index file with the messages of an SMS store file sorted
+// *          by date and address
+// *
+// * Created: 18.10.2026
+// *************************************************************************
+
+#ifdef HAVE_CONFIG_H
+#include <gsm_config.h>
+#endif
+#include <gsmlib/gsm_nls.h>
+#include <gsmlib/gsm_sms_store_index.h>
+#include <algorithm>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <assert.h>
+
+using namespace gsmlib;
+
+// SMS index file format (all numbers in network byte order):
+// 1. version number of file format, 2 bytes
+// 2. reserved, 2 bytes
+// 3. length of the store file the index was written for, 4 bytes
+// 4. CRC of the last record of that store file, 4 bytes
+// 5. number of messages n, 4 bytes
+// 6. n date entries sorted by key and offset, each consisting of
+//    the key (year, 2 bytes, month, day, hour, minute, seconds, 1 byte
+//    each, 0) and the offset of the insert record in the store file
+//    (4 bytes)
+// 7. n address entries sorted by key and offset, each consisting of the
+//    key (normalized address as used by operator<(Address, Address),
+//    padded with '0' to AddressKeyLength characters) and the offset of
+//    the insert record in the store file (4 bytes)
+// 8. CRC-32 of 1. to 7., 4 bytes
+
+static const unsigned short int SMS_INDEX_FILE_FORMAT_VERSION = 1;
+
+static const unsigned int HeaderLength = 16;
+static const unsigned int DateKeyLength = 8;
+static const unsigned int DateEntryLength = DateKeyLength + 4;
+static const unsigned int AddressEntryLength =
+  SMSStoreIndex::AddressKeyLength + 4;
+
+// aux functions to access numbers in network byte order
+
+static unsigned long getNumber(const char *p)
+{
+  const unsigned char *u = (const unsigned char*)p;
+  return (unsigned long)u[0] << 24 | u[1] << 16 | u[2] << 8 | u[3];
+}
+
+static void appendNumber(std::string &s, unsigned long n)
+{
+  s += (char)(n >> 24);
+  s += (char)(n >> 16);
+  s += (char)(n >> 8);
+  s += (char)n;
+}
+
+// aux functions to create keys
+
+static std::string dateKey(const Timestamp &timestamp)
+{
+  std::string key;
+  key += (char)(timestamp._year >> 8);
+  key += (char)timestamp._year;
+  key += (char)timestamp._month;
+  key += (char)timestamp._day;
+  key += (char)timestamp._hour;
+  key += (char)timestamp._minute;
+  key += (char)timestamp._seconds;
+  key += '\0';
+  return key;
+}
+
+static std::string addressKey(const Address &address)
+{
+  std::string key = address._number;
+  if (address._type == Address::International)
+    key = "+" + key;
+  key.resize(SMSStoreIndex::AddressKeyLength, '0');
+  return key;
+}
+
+// aux function to return position of first entry not less than key
+// (upper = false) or greater than key (upper = true)
+static unsigned long search(const char *entries, unsigned long n,
+                            unsigned int entryLength,
+                            const std::string &key, bool upper)
+{
+  unsigned long first = 0, count = n;
+  while (count > 0)
+  {
+    unsigned long step = count / 2, i = first + step;
+    int c = memcmp(entries + i * entryLength, key.data(), key.length());
+    if (upper ? c <= 0 : c < 0)
+    {
+      first = i + 1;
+      count -= step + 1;
+    }
+    else
+      count = step;
+  }
+  return first;
+}
+
+// aux function to merge n entries of entryLength at old whose offset is
+// not in erased (sorted) with the sorted entries added
+static std::string merge(const char *old, unsigned long n,
+                         unsigned int entryLength,
+                         const std::vector<unsigned long> &erased,
+                         const std::vector<std::string> &added)
+{
+  std::string result;
+  result.reserve((n + added.size()) * entryLength);
+  std::vector<std::string>::const_iterator a = added.begin();
+  for (unsigned long i = 0; i < n; ++i)
+  {
+    const char *entry = old + i * entryLength;
+    if (std::binary_search(erased.begin(), erased.end(),
+                           getNumber(entry + entryLength - 4)))
+      continue;
+    for (; a != added.end() &&
+           memcmp(a->data(), entry, entryLength) < 0; ++a)
+      result += *a;
+    result.append(entry, entryLength);
+  }
+  for (; a != added.end(); ++a)
+    result += *a;
+  return result;
+}
+
+// SMSStoreIndex members
+
+void SMSStoreIndex::create(const char *dateEntries,
+                           const char *addressEntries, unsigned long size,
+                           std::vector<unsigned long> &erasedOffsets,
+                           std::vector<SMSIndexItem> &items)
+{
+  // entries of the new items
+  std::vector<std::string> addedDates, addedAddresses;
+  addedDates.reserve(items.size());
+  addedAddresses.reserve(items.size());
+  for (std::vector<SMSIndexItem>::iterator i = items.begin();
+       i != items.end(); ++i)
+  {
+    std::string offset;
+    appendNumber(offset, i->_offset);
+    addedDates.push_back(dateKey(i->_timestamp) + offset);
+    addedAddresses.push_back(addressKey(i->_address) + offset);
+  }
+  std::sort(addedDates.begin(), addedDates.end());
+  std::sort(addedAddresses.begin(), addedAddresses.end());
+  std::sort(erasedOffsets.begin(), erasedOffsets.end());
+
+  std::string dates =
+    merge(dateEntries, size, DateEntryLength, erasedOffsets, addedDates);
+  std::string addresses = merge(addressEntries, size, AddressEntryLength,
+                                erasedOffsets, addedAddresses);
+
+  _size = dates.length() / DateEntryLength;
+  _contents.reserve(HeaderLength + dates.length() + addresses.length() + 4);
+  _contents += (char)(SMS_INDEX_FILE_FORMAT_VERSION >> 8);
+  _contents += (char)SMS_INDEX_FILE_FORMAT_VERSION;
+  _contents.append(2, '\0');
+  appendNumber(_contents, _storeLength);
+  appendNumber(_contents, _storeTail);
+  appendNumber(_contents, _size);
+  _contents += dates;
+  _contents += addresses;
+  appendNumber(_contents, crc32(_contents.data(), _contents.length()));
+
+  _dateEntries = _contents.data() + HeaderLength;
+  _addressEntries = _dateEntries + _size * DateEntryLength;
+  _valid = true;
+}
+
+SMSStoreIndex::SMSStoreIndex(std::string storeFilename,
+                             unsigned long storeLength,
+                             unsigned long storeTail) throw(GsmException) :
+  _dateEntries(NULL), _addressEntries(NULL), _size(0),
+  _storeLength(storeLength), _storeTail(storeTail), _valid(false)
+{
+  _file = new MappedFile(storeFilename + ".idx", false);
+  const char *p = _file->data();
+  unsigned long length = _file->length();
+  if (length < HeaderLength + 4 ||
+      ((unsigned char)p[0] << 8 | (unsigned char)p[1]) !=
+      SMS_INDEX_FILE_FORMAT_VERSION)
+    return;
+
+  unsigned long size = getNumber(p + 12);
+  if (size > length / (DateEntryLength + AddressEntryLength) ||
+      length != HeaderLength +
+      size * (DateEntryLength + AddressEntryLength) + 4 ||
+      getNumber(p + 4) != storeLength || getNumber(p + 8) != storeTail ||
+      crc32(p, length - 4) != getNumber(p + length - 4))
+    return;
+
+  _size = size;
+  _dateEntries = p + HeaderLength;
+  _addressEntries = _dateEntries + _size * DateEntryLength;
+  _valid = true;
+}
+
+SMSStoreIndex::SMSStoreIndex(std::vector<SMSIndexItem> &items,
+                             unsigned long storeLength,
+                             unsigned long storeTail) :
+  _storeLength(storeLength), _storeTail(storeTail)
+{
+  std::vector<unsigned long> erasedOffsets;
+  create(NULL, NULL, 0, erasedOffsets, items);
+}
+
+SMSStoreIndex::SMSStoreIndex(const SMSStoreIndex &index,
+                             std::vector<unsigned long> erasedOffsets,
+                             std::vector<SMSIndexItem> &items,
+                             unsigned long storeLength,
+                             unsigned long storeTail) :
+  NoCopy(), _storeLength(storeLength), _storeTail(storeTail)
+{
+  assert(index._valid);
+  create(index._dateEntries, index._addressEntries, index._size,
+         erasedOffsets, items);
+}
+
+void SMSStoreIndex::write(std::string storeFilename) throw(GsmException)
+{
+  assert(_valid);
+  std::string filename = storeFilename + ".idx";
+  std::string tempFilename = filename + ".tmp";
+  const char *data = _dateEntries - HeaderLength;
+  unsigned long length = HeaderLength +
+    _size * (DateEntryLength + AddressEntryLength) + 4;
+  writeFileSynced(tempFilename, data, length);
+  replaceFile(tempFilename, filename);
+}
+
+bool SMSStoreIndex::exists(std::string storeFilename)
+{
+  std::ifstream is((storeFilename + ".idx").c_str());
+  return is.good();
+}
+
+void SMSStoreIndex::remove(std::string storeFilename)
+{
+  ::remove((storeFilename + ".idx").c_str());
+}
+
+unsigned long SMSStoreIndex::lowerBound(const Timestamp &timestamp) const
+{
+  return search(_dateEntries, _size, DateEntryLength, dateKey(timestamp),
+                false);
+}
+
+unsigned long SMSStoreIndex::upperBound(const Timestamp &timestamp) const
+{
+  return search(_dateEntries, _size, DateEntryLength, dateKey(timestamp),
+                true);
+}
+
+Timestamp SMSStoreIndex::timestamp(unsigned long i) const
+{
+  assert(i < _size);
+  const unsigned char *key =
+    (const unsigned char*)_dateEntries + i * DateEntryLength;
+  Timestamp result;
+  result._year = key[0] << 8 | key[1];
+  result._month = key[2];
+  result._day = key[3];
+  result._hour = key[4];
+  result._minute = key[5];
+  result._seconds = key[6];
+  return result;
+}
+
+unsigned long SMSStoreIndex::dateOffset(unsigned long i) const
+{
+  assert(i < _size);
+  return getNumber(_dateEntries + i * DateEntryLength + DateKeyLength);
+}
+
+unsigned long SMSStoreIndex::lowerBound(const Address &address) const
+{
+  return search(_addressEntries, _size, AddressEntryLength,
+                addressKey(address), false);
+}
+
+unsigned long SMSStoreIndex::upperBound(const Address &address) const
+{
+  return search(_addressEntries, _size, AddressEntryLength,
+                addressKey(address), true);
+}
+
+unsigned long SMSStoreIndex::addressOffset(unsigned long i) const
+{
+  assert(i < _size);
+  return getNumber(_addressEntries + i * AddressEntryLength +
+                   AddressKeyLength);
+}
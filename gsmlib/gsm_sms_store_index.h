@@ -0,0 +1,108 @@
+// *************************************************************************
+// * GSM TA/ME library
+// *
+// * File:    gsm_sms_store_index.h
+// *
+// * Purpose: Index file with the messages of an SMS store file sorted
+// *          by date and address
+// *
+// * Created: 18.10.2026
+// *************************************************************************
+
+#ifndef GSM_SMS_STORE_INDEX_H
+#define GSM_SMS_STORE_INDEX_H
+
+#include <gsmlib/gsm_sms_codec.h>
+#include <gsmlib/gsm_util.h>
+#include <string>
+#include <vector>
+
+namespace gsmlib
+{
+  // sort keys and location of a message in an SMS store file
+  struct SMSIndexItem
+  {
+    Timestamp _timestamp;       // service centre timestamp
+    Address _address;
+    unsigned long _offset;      // offset of the insert record in the file
+  };
+
+  // Index of an SMS store file (see gsm_sorted_sms_store), residing in
+  // a file next to it (store file name + ".idx"). It holds the record
+  // offsets of the messages sorted by service centre timestamp and by
+  // address, so that lookups can be done by binary search without
+  // reading the store. The index records length and last CRC of the
+  // store file it was written for and is only valid for that contents.
+  // Addresses are compared on their first AddressKeyLength characters
+  // (in the same way as operator<(Address, Address)).
+
+  class SMSStoreIndex : public RefBase, public NoCopy
+  {
+  private:
+    Ref<MappedFile> _file;      // index file, if read
+    std::string _contents;      // index contents, if created
+    const char *_dateEntries;   // entries sorted by timestamp
+    const char *_addressEntries; // entries sorted by address
+    unsigned long _size;        // number of messages
+    unsigned long _storeLength; // store file the index was written for
+    unsigned long _storeTail;
+    bool _valid;
+
+    // create contents from size entries of an index without the
+    // messages at erasedOffsets and with the messages of items added
+    void create(const char *dateEntries, const char *addressEntries,
+                unsigned long size,
+                std::vector<unsigned long> &erasedOffsets,
+                std::vector<SMSIndexItem> &items);
+
+  public:
+    // length of address keys
+    static const unsigned int AddressKeyLength = 32;
+
+    // read index of storeFilename, valid() returns false if it is
+    // missing, damaged or not written for the store file with
+    // storeLength bytes whose last record has the CRC storeTail
+    SMSStoreIndex(std::string storeFilename, unsigned long storeLength,
+                  unsigned long storeTail) throw(GsmException);
+
+    // create index from items for the given store contents
+    SMSStoreIndex(std::vector<SMSIndexItem> &items,
+                  unsigned long storeLength, unsigned long storeTail);
+
+    // create index from index without the messages at erasedOffsets and
+    // with the messages of items added (only the new items are sorted)
+    SMSStoreIndex(const SMSStoreIndex &index,
+                  std::vector<unsigned long> erasedOffsets,
+                  std::vector<SMSIndexItem> &items,
+                  unsigned long storeLength, unsigned long storeTail);
+
+    // write index file of storeFilename
+    void write(std::string storeFilename) throw(GsmException);
+
+    // return true if storeFilename has an index file
+    static bool exists(std::string storeFilename);
+
+    // remove index file of storeFilename
+    static void remove(std::string storeFilename);
+
+    bool valid() const {return _valid;}
+    unsigned long size() const {return _size;}
+
+    // positions in date order, timestamp and record offset of the message
+    // at date position i
+    unsigned long lowerBound(const Timestamp &timestamp) const;
+    unsigned long upperBound(const Timestamp &timestamp) const;
+    Timestamp timestamp(unsigned long i) const;
+    unsigned long dateOffset(unsigned long i) const;
+
+    // positions in address order, record offset of the message at
+    // address position i
+    unsigned long lowerBound(const Address &address) const;
+    unsigned long upperBound(const Address &address) const;
+    unsigned long addressOffset(unsigned long i) const;
+  };
+
+  typedef Ref<SMSStoreIndex> SMSStoreIndexRef;
+};
+
+#endif // GSM_SMS_STORE_INDEX_H
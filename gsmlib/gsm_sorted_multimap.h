@@ -0,0 +1,356 @@
+// *************************************************************************
+// * GSM TA/ME library
+// *
+// * File:    gsm_sorted_multimap.h
+// *
+// * Purpose: Multimap for the sorted stores (gsm_sorted_sms_store and
+// *          gsm_sorted_phonebook) that is either a tree or a sorted
+// *          vector
+// *
+// * Created: 18.10.2026
+// *************************************************************************
+
+#ifndef GSM_SORTED_MULTIMAP_H
+#define GSM_SORTED_MULTIMAP_H
+
+#include <set>
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <utility>
+#include <cstddef>
+
+namespace gsmlib
+{
+  // Multimap of keys to values (pointers to entries) with two backends:
+  // - tree: node per element, iterators remain valid after insert and
+  //   erase (like std::multimap)
+  // - flat: elements in a vector sorted by key, compact and fast to
+  //   iterate and search, inserting or erasing single elements moves
+  //   the elements after them and invalidates all iterators
+  // insertBuffered() adds an element without returning its position,
+  // in the flat backend buffered elements are sorted and merged in one
+  // go on the next access
+  // Elements with equal keys are kept in the order of insertion in both
+  // backends. Values are read-only, use erase() and insert() to change
+  // them.
+
+  template <class Key, class T> class SortedMultimap
+  {
+  public:
+    typedef Key key_type;
+    typedef T mapped_type;
+    typedef std::pair<Key, T> value_type;
+    typedef std::size_t size_type;
+
+  private:
+    // compare elements by key only
+    struct KeyCompare
+    {
+      bool operator()(const value_type &x, const value_type &y) const
+        {return x.first < y.first;}
+      bool operator()(const value_type &x, const Key &y) const
+        {return x.first < y;}
+      bool operator()(const Key &x, const value_type &y) const
+        {return x < y.first;}
+    };
+
+    typedef std::multiset<value_type, KeyCompare> Tree;
+    typedef std::vector<value_type> Vector;
+
+    // compare elements of a vector given by position by key
+    // (positions are sorted instead of the elements to avoid copying
+    // the keys)
+    struct PositionCompare
+    {
+      const Vector *_vector;
+      PositionCompare(const Vector *vector) : _vector(vector) {}
+      bool operator()(size_type x, size_type y) const
+        {return (*_vector)[x].first < (*_vector)[y].first;}
+    };
+
+    bool _flat;                 // use flat backend
+    Tree _tree;                 // elements if tree backend
+    Vector _vector;             // sorted elements if flat backend
+    Vector _buffer;             // elements to be merged into _vector
+
+    // merge buffered elements into _vector, each element is copied once
+    void merge()
+      {
+        if (_buffer.empty())
+          return;
+        std::vector<size_type> order(_buffer.size());
+        bool sorted = true;
+        for (size_type i = 0; i < order.size(); ++i)
+        {
+          order[i] = i;
+          if (i != 0 && _buffer[i].first < _buffer[i - 1].first)
+            sorted = false;
+        }
+        if (! sorted)
+          std::stable_sort(order.begin(), order.end(),
+                           PositionCompare(&_buffer));
+
+        // append if the buffered elements all go after the others
+        // (eg. when loaded in order)
+        size_type j = 0;
+        if (_vector.empty() ||
+            ! (_buffer[order[0]].first < _vector.back().first))
+        {
+          _vector.reserve(_vector.size() + _buffer.size());
+          for (; j < order.size(); ++j)
+            _vector.push_back(_buffer[order[j]]);
+        }
+        else
+        {
+          Vector result;
+          result.reserve(_vector.size() + _buffer.size());
+          typename Vector::iterator i = _vector.begin();
+          for (; j < order.size(); ++j)
+          {
+            const value_type &x = _buffer[order[j]];
+            for (; i != _vector.end() && ! (x.first < i->first); ++i)
+              result.push_back(*i);
+            result.push_back(x);
+          }
+          result.insert(result.end(), i, _vector.end());
+          _vector.swap(result);
+        }
+        Vector().swap(_buffer);
+      }
+
+  public:
+    // bidirectional iterator for both backends
+    class iterator
+    {
+    public:
+      typedef std::bidirectional_iterator_tag iterator_category;
+      typedef typename SortedMultimap<Key, T>::value_type value_type;
+      typedef std::ptrdiff_t difference_type;
+      typedef const value_type *pointer;
+      typedef const value_type &reference;
+
+    private:
+      typename Tree::iterator _node;
+      const value_type *_element;
+      bool _flat;
+
+      friend class SortedMultimap<Key, T>;
+      iterator(typename Tree::iterator node) :
+        _node(node), _element(NULL), _flat(false) {}
+      iterator(const value_type *element) :
+        _element(element), _flat(true) {}
+
+    public:
+      iterator() : _element(NULL), _flat(false) {}
+
+      const value_type &operator*() const
+        {return _flat ? *_element : *_node;}
+      const value_type *operator->() const
+        {return _flat ? _element : &*_node;}
+
+      iterator &operator++()
+        {
+          if (_flat)
+            ++_element;
+          else
+            ++_node;
+          return *this;
+        }
+      iterator operator++(int)
+        {
+          iterator result = *this;
+          ++*this;
+          return result;
+        }
+      iterator &operator--()
+        {
+          if (_flat)
+            --_element;
+          else
+            --_node;
+          return *this;
+        }
+      iterator operator--(int)
+        {
+          iterator result = *this;
+          --*this;
+          return result;
+        }
+
+      bool operator==(const iterator &i) const
+        {return _flat ? _element == i._element : _node == i._node;}
+      bool operator!=(const iterator &i) const
+        {return ! (*this == i);}
+    };
+
+  private:
+    // conversion between iterators and positions in the vector
+    const value_type *data() const
+      {return _vector.empty() ? NULL : &_vector[0];}
+    iterator flatIterator(size_type i) {return iterator(data() + i);}
+    iterator flatIterator(typename Vector::iterator i)
+      {return flatIterator(i - _vector.begin());}
+    typename Vector::iterator vectorIterator(iterator i)
+      {return _vector.begin() + (i._element - data());}
+
+  public:
+    SortedMultimap(bool flat = false) : _flat(flat) {}
+
+    // return true if flat backend is used
+    bool flat() const {return _flat;}
+
+    // change backend, invalidates all iterators
+    void setFlat(bool flat)
+      {
+        if (flat == _flat)
+          return;
+        if (flat)
+        {
+          // the tree is already sorted
+          _vector.assign(_tree.begin(), _tree.end());
+          _tree.clear();
+        }
+        else
+        {
+          merge();
+          _tree.insert(_vector.begin(), _vector.end());
+          Vector().swap(_vector);
+        }
+        _flat = flat;
+      }
+
+    iterator begin()
+      {
+        if (! _flat)
+          return iterator(_tree.begin());
+        merge();
+        return flatIterator(0);
+      }
+    iterator end()
+      {
+        if (! _flat)
+          return iterator(_tree.end());
+        merge();
+        return flatIterator(_vector.size());
+      }
+
+    size_type size() const
+      {return _flat ? _vector.size() + _buffer.size() : _tree.size();}
+    size_type max_size() const
+      {return _flat ? _vector.max_size() : _tree.max_size();}
+    bool empty() const {return size() == 0;}
+
+    // insert element after the elements with the same key
+    iterator insert(const value_type &x)
+      {
+        if (! _flat)
+          return iterator(_tree.insert(x));
+        merge();
+        return flatIterator(
+          _vector.insert(std::upper_bound(_vector.begin(), _vector.end(),
+                                          x.first, KeyCompare()), x));
+      }
+    iterator insert(iterator position, const value_type &x)
+      {
+        if (! _flat)
+          return iterator(_tree.insert(position._node, x));
+        return insert(x);
+      }
+    // reserve space for n buffered elements
+    void reserve(size_type n)
+      {
+        if (_flat)
+          _buffer.reserve(n);
+      }
+    void insertBuffered(const value_type &x)
+      {
+        if (_flat)
+          _buffer.push_back(x);
+        else
+          _tree.insert(_tree.end(), x);
+      }
+
+    void erase(iterator position)
+      {
+        if (_flat)
+          _vector.erase(vectorIterator(position));
+        else
+          _tree.erase(position._node);
+      }
+    void erase(iterator first, iterator last)
+      {
+        if (_flat)
+          _vector.erase(vectorIterator(first), vectorIterator(last));
+        else
+          _tree.erase(first._node, last._node);
+      }
+    size_type erase(const Key &key)
+      {
+        std::pair<iterator, iterator> range = equal_range(key);
+        size_type n = std::distance(range.first, range.second);
+        erase(range.first, range.second);
+        return n;
+      }
+
+    void clear()
+      {
+        _tree.clear();
+        _vector.clear();
+        _buffer.clear();
+      }
+    void swap(SortedMultimap &m)
+      {
+        std::swap(_flat, m._flat);
+        _tree.swap(m._tree);
+        _vector.swap(m._vector);
+        _buffer.swap(m._buffer);
+      }
+
+    // lookup
+    iterator lower_bound(const Key &key)
+      {
+        if (! _flat)
+          return iterator(_tree.lower_bound(value_type(key, T())));
+        merge();
+        return flatIterator(std::lower_bound(_vector.begin(), _vector.end(),
+                                             key, KeyCompare()));
+      }
+    iterator upper_bound(const Key &key)
+      {
+        if (! _flat)
+          return iterator(_tree.upper_bound(value_type(key, T())));
+        merge();
+        return flatIterator(std::upper_bound(_vector.begin(), _vector.end(),
+                                             key, KeyCompare()));
+      }
+    std::pair<iterator, iterator> equal_range(const Key &key)
+      {
+        if (! _flat)
+        {
+          std::pair<typename Tree::iterator, typename Tree::iterator> r =
+            _tree.equal_range(value_type(key, T()));
+          return std::make_pair(iterator(r.first), iterator(r.second));
+        }
+        merge();
+        std::pair<typename Vector::iterator, typename Vector::iterator> r =
+          std::equal_range(_vector.begin(), _vector.end(), key,
+                           KeyCompare());
+        return std::make_pair(flatIterator(r.first), flatIterator(r.second));
+      }
+    iterator find(const Key &key)
+      {
+        iterator i = lower_bound(key);
+        if (i != end() && ! (key < i->first))
+          return i;
+        return end();
+      }
+    size_type count(const Key &key)
+      {
+        std::pair<iterator, iterator> range = equal_range(key);
+        return std::distance(range.first, range.second);
+      }
+  };
+};
+
+#endif // GSM_SORTED_MULTIMAP_H
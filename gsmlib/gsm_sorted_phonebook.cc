@@ -21,114 +21,169 @@
 #include <fstream>
 #include <limits.h>
 #include <cstring>
-
-const int MAX_LINE_SIZE = 1000;
+#include <cstdio>
+#include <cctype>
+#include <vector>
+#include <algorithm>
 
 using namespace gsmlib;
 
-std::string SortedPhonebook::escapeString(std::string s)
+void SortedPhonebook::escapeString(const std::string &s,
+                                   std::string &result)
 {
-  std::string result;
-  
-  for (const char *pp = s.c_str(); *pp != 0; ++pp)
+  // append the characters that need no escaping in runs
+  const char *pp = s.c_str(), *run = pp;
+  for (; *pp != 0; ++pp)
   {
+    const char *escaped = NULL;
     if (*pp == CR)
-      result += "\\r";
+      escaped = "\\r";
     else if (*pp == LF)
-      result += "\\n";
+      escaped = "\\n";
     else if (*pp == '\\')
-      result += "\\\\";
+      escaped = "\\\\";
     else if (*pp == '|')
-      result += "\\|";
-    else
-      result += *pp;
+      escaped = "\\|";
+    if (escaped != NULL)
+    {
+      result.append(run, pp - run);
+      result += escaped;
+      run = pp + 1;
+    }
   }
-  return result;
+  result.append(run, pp - run);
 }
 
-std::string SortedPhonebook::unescapeString(char *line, unsigned int &pos)
+void SortedPhonebook::appendLine(std::string &contents,
+                                 PhonebookEntryBase &entry)
 {
-  std::string result;
-  bool escaped = false;
+  // line format : [index] '|' text '|' number
+  if (_useIndices)
+  {
+    char index[16];
+    sprintf(index, "%d", entry.index());
+    contents += index;
+  }
+  contents += '|';
+  escapeString(entry.text(), contents);
+  contents += '|';
+  escapeString(entry.telephone(), contents);
+  contents += '\n';
+}
 
-  while (! (line[pos] == '|' && ! escaped) && line[pos] != 0 &&
-         line[pos] != CR && line[pos] != LF)
+const char *SortedPhonebook::unescapeString(const char *p,
+                                            const char *end,
+                                            std::string &result)
+{
+  // append the unescaped characters in runs
+  const char *run = p;
+  while (p != end && *p != '|' && *p != 0 && *p != CR && *p != LF)
   {
-    if (escaped)
+    if (*p != '\\')
     {
-      escaped = false;
-      if (line[pos] == 'r')
-        result += CR;
-      else if (line[pos] == 'n')
-        result += LF;
-      else if (line[pos] == '\\')
-        result += '\\';
-      else if (line[pos] == '|')
-        result += '|';
-      else
-        result += line[pos];
+      ++p;
+      continue;
     }
+    result.append(run, p - run);
+    if (++p == end || *p == 0 || *p == CR || *p == LF)
+      return p;                 // trailing '\\' is dropped
+    if (*p == 'r')
+      result += CR;
+    else if (*p == 'n')
+      result += LF;
     else
-      if (line[pos] == '\\')
-        escaped = true;
-      else
-        result += line[pos];
-
-    ++pos;
+      result += *p;
+    run = ++p;
   }
-  return result;
+  result.append(run, p - run);
+  return p;
 }
 
-void SortedPhonebook::readPhonebookFile(std::istream &pbs, std::string filename)
+void SortedPhonebook::readPhonebookFile(const char *p, unsigned long length)
   throw(GsmException)
 {
-  // read entries
-  while (! pbs.eof())
+  const char *end = p + length;
+  std::vector<PhonebookEntryBase*> entries;
+  std::vector<int> indices;
+  try
   {
-    char line[MAX_LINE_SIZE];
-    pbs.getline(line, MAX_LINE_SIZE);
-
-    if (strlen(line) == 0)
-      continue;                 // skip empty lines
+    // parse lines (line format : [index] '|' text '|' number)
+    while (p != end)
+    {
+      const char *line = p;
+      const char *eol = (const char*)memchr(p, LF, end - p);
+      if (eol == NULL)
+        eol = end;
+      p = eol == end ? end : eol + 1;
+
+      if (line == eol || *line == 0)
+        continue;               // skip empty lines
+
+      // parse index
+      std::string indexS, text, telephone;
+      const char *pos = unescapeString(line, eol, indexS);
+      int index = -1;
+      if (indexS.length() == 0)
+      {
+        if (_useIndices)
+          throw GsmException(
+            stringPrintf(_("entry '%s' lacks index"),
+                         std::string(line, eol - line).c_str()),
+            ParserError);
+      }
+      else
+      {
+        index = 0;
+        for (std::string::iterator i = indexS.begin(); i != indexS.end();
+             ++i)
+          if (isdigit(*i))
+            index = index * 10 + (*i - '0');
+          else
+            checkNumber(indexS); // reports the error
+        indices.push_back(index);
+        _useIndices = true;
+      }
+      if (pos == eol || *pos++ != '|')
+        throw GsmException(
+          stringPrintf(_("line '%s' has invalid format"),
+                       std::string(line, eol - line).c_str()),
+          ParserError);
 
-    if (pbs.bad())
-      throw GsmException(stringPrintf(_("error reading from file '%s"),
-                                      filename.c_str()),
-                         OSError);
+      // parse text
+      pos = unescapeString(pos, eol, text);
+      if (pos == eol || *pos++ != '|')
+        throw GsmException(
+          stringPrintf(_("line '%s' has invalid format"),
+                       std::string(line, eol - line).c_str()),
+          ParserError);
 
-    // convert line to newEntry (line format : [index] '|' text '|' number
-    std::string text, telephone;
-    unsigned int pos = 0;
+      // parse telephone number
+      unescapeString(pos, eol, telephone);
 
-    // parse index
-    std::string indexS = unescapeString(line, pos);
-    int index = -1;
-    if (indexS.length() == 0)
-    {
-      if (_useIndices)
-        throw GsmException(stringPrintf(_("entry '%s' lacks index"), line),
-                           ParserError);
-    }
-    else
-    {
-      index = checkNumber(indexS);
-      _useIndices = true;
+      entries.push_back(new PhonebookEntryBase());
+      entries.back()->set(telephone, text, index);
+      entries.back()->resetChanged();
     }
-    if (line[pos++] != '|')
-      throw GsmException(stringPrintf(_("line '%s' has invalid format"), line),
-                         ParserError);
 
-    // parse text
-    text = unescapeString(line, pos);
-    if (line[pos++] != '|')
-      throw GsmException(stringPrintf(_("line '%s' has invalid format"), line),
-                         ParserError);
-
-    // parse telephone number
-    telephone = unescapeString(line, pos);
-
-    insert(PhonebookEntryBase(telephone, text, index));
+    std::sort(indices.begin(), indices.end());
+    if (std::adjacent_find(indices.begin(), indices.end()) != indices.end())
+      throw GsmException(_("indices must be unique in phonebook"),
+                         ParameterError);
+  }
+  catch (GsmException &)
+  {
+    for (std::vector<PhonebookEntryBase*>::iterator i = entries.begin();
+         i != entries.end(); ++i)
+      delete *i;
+    throw;
   }
+
+  // build the map, entries with equal keys remain in file order
+  _sortedPhonebook.reserve(entries.size());
+  for (std::vector<PhonebookEntryBase*>::iterator i = entries.begin();
+       i != entries.end(); ++i)
+    _sortedPhonebook.insertBuffered(
+      PhonebookMap::value_type(mapKey(**i, _sortOrder), *i));
 }
 
 void SortedPhonebook::sync(bool fromDestructor) throw(GsmException)
@@ -140,73 +195,81 @@ void SortedPhonebook::sync(bool fromDestructor) throw(GsmException)
   // (avoids writing to stdout multiple times)
   if (_filename == "" && ! fromDestructor) return;
 
-  // find out if any of the entries have been updated
-  if (! _changed)    // only look if we're not writing the file anyway
+  // find out if any of the entries have been updated, this requires
+  // rewriting the file (only look if we're not rewriting it anyway)
+  bool rewrite = ! _incremental || _mustRewrite || _filename == "";
+  if (! (_changed && rewrite))
     for (iterator i = begin(); i != end(); i++)
       if (i->changed())
       {
-        _changed = true;
+        _changed = rewrite = true;
         break;
       }
 
   if (_changed)
   {
     checkReadonly();
-    // create backup file - but only once
-    if (! _madeBackupFile && _filename != "") // don't make backup of stdout
+
+    // convert all entries or (incremental) the inserted entries to
+    // output lines, they are written in one go
+    std::string contents;
+    if (rewrite)
+      for (PhonebookMap::iterator i = _sortedPhonebook.begin();
+           i != _sortedPhonebook.end(); ++i)
+        appendLine(contents, *i->second);
+    else
+      for (std::vector<PhonebookEntryBase*>::iterator i =
+             _insertedEntries.begin(); i != _insertedEntries.end(); ++i)
+        appendLine(contents, **i);
+
+    if (_filename == "")
     {
-      renameToBackupFile(_filename);
-      _madeBackupFile = true;
+      std::cout.write(contents.data(), contents.length());
+      std::cout.flush();
+      if (std::cout.bad())
+        throw GsmException(stringPrintf(_("error writing to file '%s'"),
+                                        _("<STDOUT>")), OSError);
     }
-
-    // open stream
-    std::ostream *pbs = NULL;
-    try
+    else
     {
-      if (_filename == "")
-        pbs = &std::cout;
+      if (rewrite)
+      {
+        // write to a temporary file first so that a crash leaves either
+        // the old or the new file
+        std::string tempFilename = _filename + ".tmp";
+        writeFileSynced(tempFilename, contents.data(), contents.length());
+
+        // create backup file - but only once
+        if (! _madeBackupFile)
+        {
+          renameToBackupFile(_filename);
+          _madeBackupFile = true;
+        }
+        replaceFile(tempFilename, _filename);
+        _fileLength = contents.length();
+      }
       else
-        pbs = new std::ofstream(_filename.c_str());
-      
-      if (pbs->bad())
-        throw GsmException(
-          stringPrintf(_("error opening file '%s' for writing"),
-                       (_filename == "" ? _("<STDOUT>") :
-                        _filename.c_str())),
-          OSError);
-    
-      // and write the entries
-      for (PhonebookMap::iterator i = _sortedPhonebook.begin();
-           i != _sortedPhonebook.end(); ++i)
       {
-        // convert entry to output line
-        std::string line =
-          (_useIndices ? intToStr(i->second->index()) : "") + "|" +
-          escapeString(i->second->text()) + "|" +
-          escapeString(i->second->telephone());
-      
-        // write out the line
-        *pbs << line << std::endl;
-        if (pbs->bad())
-          throw GsmException(
-            stringPrintf(_("error writing to file '%s'"),
-                         (_filename == "" ? _("<STDOUT>") :
-                          _filename.c_str())),
-            OSError);
+        // an empty file might not exist yet
+        writeFileSynced(_filename, contents.data(), contents.length(),
+                        _fileLength == 0, _fileLength);
+        _fileLength += contents.length();
       }
     }
-    catch(GsmException &)
-    {
-      if (pbs != &std::cout) delete pbs;
-      throw;
-    }
-    // close file
-    if (pbs != &std::cout) delete pbs;
 
     // reset all changed states
     _changed = false;
-    for (iterator j = begin(); j != end(); j++)
-      j->resetChanged();
+    _mustRewrite = false;
+    _insertedEntries.clear();
+    // the changed entries have outdated keys in the maps
+    if (rewrite)
+      for (iterator j = begin(); j != end(); j++)
+        if (j->changed())
+        {
+          j->resetChanged();
+          _otherSortOrders.clear();
+          _outdatedKeys = true;
+        }
   }
 }
 
@@ -221,33 +284,42 @@ SortedPhonebook::SortedPhonebook(std::string filename, bool useIndices)
   throw(GsmException) :
   _changed(false), _fromFile(true), _madeBackupFile(false),
   _sortOrder(ByIndex), _useIndices(useIndices), _readonly(false),
-  _filename(filename)
+  _filename(filename), _incremental(false), _mustRewrite(false),
+  _fileLength(0), _outdatedKeys(false)
 {
-  // open the file
-  std::ifstream pbs(filename.c_str());
-  if (pbs.bad())
-    throw GsmException(stringPrintf(_("cannot open file '%s'"),
-                                    filename.c_str()),
-                       OSError);
-  // and read the file
-  readPhonebookFile(pbs, filename);
+  // read the file, a missing file is an empty phonebook
+  MappedFile file(filename, false);
+  readPhonebookFile(file.data(), file.length());
+  _fileLength = file.length();
+
+  // lines can only be appended after a complete last line
+  _mustRewrite = file.length() != 0 &&
+    file.data()[file.length() - 1] != LF;
 }
 
 SortedPhonebook::SortedPhonebook(bool fromStdin, bool useIndices)
   throw(GsmException) :
   _changed(false), _fromFile(true), _madeBackupFile(false),
-  _sortOrder(ByIndex), _useIndices(useIndices), _readonly(fromStdin)
+  _sortOrder(ByIndex), _useIndices(useIndices), _readonly(fromStdin),
+  _incremental(false), _mustRewrite(false), _fileLength(0),
+  _outdatedKeys(false)
   // _filename is "" - this means stdout
 {
-  // read from stdin
+  // read from stdin, the phonebook cannot be changed and is flat
   if (fromStdin)
-    readPhonebookFile(std::cin, (std::string)_("<STDIN>"));
+  {
+    MappedFile file(std::cin, _("<STDIN>"));
+    _sortedPhonebook.setFlat(true);
+    readPhonebookFile(file.data(), file.length());
+  }
 }
 
 SortedPhonebook::SortedPhonebook(PhonebookRef mePhonebook)
   throw(GsmException) :
   _changed(false), _fromFile(false), _madeBackupFile(false),
-  _sortOrder(ByIndex), _readonly(false), _mePhonebook(mePhonebook)
+  _sortOrder(ByIndex), _readonly(false), _mePhonebook(mePhonebook),
+  _incremental(false), _mustRewrite(false), _fileLength(0),
+  _outdatedKeys(false)
 {
   int entriesRead = 0;
   reportProgress(0, _mePhonebook->end() - _mePhonebook->begin());
@@ -257,8 +329,8 @@ SortedPhonebook::SortedPhonebook(PhonebookRef mePhonebook)
   {
     if (! i->empty())
     {
-      _sortedPhonebook.insert(
-        PhonebookMap::value_type(PhoneMapKey(*this, lowercase(i->text())), i));
+      _sortedPhonebook.insertBuffered(
+        PhonebookMap::value_type(mapKey(*i, _sortOrder), i));
       ++entriesRead;
       if (entriesRead == _mePhonebook->size())
         return;                 // ready
@@ -267,48 +339,79 @@ SortedPhonebook::SortedPhonebook(PhonebookRef mePhonebook)
   }
 }
 
-void SortedPhonebook::setSortOrder(SortOrder newOrder)
+PhoneMapKey SortedPhonebook::mapKey(PhonebookEntryBase &entry,
+                                    SortOrder sortOrder)
 {
-  if (newOrder == _sortOrder) return; // nothing to do
-
-  PhonebookMap savedPhonebook = _sortedPhonebook; // save phonebook
-  _sortedPhonebook = PhonebookMap(); // empty old phonebook
-  _sortOrder = newOrder;
-
-  // re-insert entries
-  switch (newOrder)
+  switch (sortOrder)
   {
   case ByTelephone:
-  {
-    for (PhonebookMap::iterator i = savedPhonebook.begin();
-         i != savedPhonebook.end(); ++i)
-      _sortedPhonebook.
-        insert(PhonebookMap::value_type(
-          PhoneMapKey(*this, lowercase(i->second->telephone())), i->second));
+    return PhoneMapKey(*this, sortOrder, lowercase(entry.telephone()));
+  case ByText:
+    return PhoneMapKey(*this, sortOrder, lowercase(entry.text()));
+  case ByIndex:
+    return PhoneMapKey(*this, sortOrder, entry.index());
+  default:
+    assert(0);
     break;
   }
-  case ByText:
+  return PhoneMapKey(*this, sortOrder, 0);
+}
+
+void SortedPhonebook::setSortOrder(SortOrder newOrder)
+{
+  if (newOrder == _sortOrder) return; // nothing to do
+
+  // entries changed in place have outdated keys in all maps, then the
+  // map of the new sort order is built from scratch and no map is kept
+  bool outdated = outdatedKeys();
+  if (outdated)
   {
-    for (PhonebookMap::iterator i = savedPhonebook.begin();
-         i != savedPhonebook.end(); ++i)
-      _sortedPhonebook.
-        insert(PhonebookMap::value_type(
-          PhoneMapKey(*this, lowercase(i->second->text())), i->second));
-    break;
+    _otherSortOrders.clear();
+    _outdatedKeys = false;
   }
-  case ByIndex:
+
+  // use the map of the new sort order if it has been built before,
+  // otherwise build it, the map of the old sort order is kept
+  PhonebookMap newPhonebook(_sortedPhonebook.flat());
+  std::map<SortOrder, PhonebookMap>::iterator i =
+    _otherSortOrders.find(newOrder);
+  if (i != _otherSortOrders.end())
   {
-    for (PhonebookMap::iterator i = savedPhonebook.begin();
-         i != savedPhonebook.end(); ++i)
-      _sortedPhonebook.
-        insert(PhonebookMap::value_type(
-          PhoneMapKey(*this, i->second->index()), i->second));
-    break;
+    newPhonebook.swap(i->second);
+    _otherSortOrders.erase(i);
   }
-  default:
-    assert(0);
-    break;
+  else
+  {
+    newPhonebook.reserve(_sortedPhonebook.size());
+    for (PhonebookMap::iterator j = _sortedPhonebook.begin();
+         j != _sortedPhonebook.end(); ++j)
+      newPhonebook.insertBuffered(
+        PhonebookMap::value_type(mapKey(*j->second, newOrder), j->second));
   }
+
+  if (! outdated)
+    _otherSortOrders[_sortOrder].swap(_sortedPhonebook);
+  _sortedPhonebook.swap(newPhonebook);
+  _sortOrder = newOrder;
+}
+
+bool SortedPhonebook::outdatedKeys()
+{
+  if (_outdatedKeys)
+    return true;
+  for (PhonebookMap::iterator i = _sortedPhonebook.begin();
+       i != _sortedPhonebook.end(); ++i)
+    if (i->second->changed())
+      return true;
+  return false;
+}
+
+void SortedPhonebook::setFlat(bool flat)
+{
+  _sortedPhonebook.setFlat(flat);
+  for (std::map<SortOrder, PhonebookMap>::iterator i =
+         _otherSortOrders.begin(); i != _otherSortOrders.end(); ++i)
+    i->second.setFlat(flat);
 }
 
 unsigned int SortedPhonebook::getMaxTelephoneLen() const
@@ -383,28 +486,18 @@ SortedPhonebook::insert(const PhonebookEntryBase& x) throw(GsmException)
     PhonebookEntry newMEEntry(x);
     newEntry = _mePhonebook->insert((PhonebookEntry*)NULL, newMEEntry);
   }
-  switch (_sortOrder)
+  if (_fromFile)
   {
-  case ByTelephone:
-    return
-      _sortedPhonebook.
-      insert(PhonebookMap::value_type(
-        PhoneMapKey(*this, lowercase(newEntry->telephone())), newEntry));
-  case ByText:
-    return
-      _sortedPhonebook.
-      insert(PhonebookMap::value_type(
-        PhoneMapKey(*this, lowercase(newEntry->text())), newEntry));
-  case ByIndex:
-    return
-      _sortedPhonebook.
-      insert(PhonebookMap::value_type(
-        PhoneMapKey(*this, newEntry->index()), newEntry));
-  default:
-    assert(0);
-    break;
+    // written on the next sync() as inserted, not as changed
+    newEntry->resetChanged();
+    _insertedEntries.push_back(newEntry);
   }
-  return SortedPhonebook::iterator();
+  for (std::map<SortOrder, PhonebookMap>::iterator i =
+         _otherSortOrders.begin(); i != _otherSortOrders.end(); ++i)
+    i->second.insertBuffered(
+      PhonebookMap::value_type(mapKey(*newEntry, i->first), newEntry));
+  return _sortedPhonebook.insert(
+    PhonebookMap::value_type(mapKey(*newEntry, _sortOrder), newEntry));
 }
 
 SortedPhonebook::iterator
@@ -423,14 +516,7 @@ SortedPhonebook::size_type SortedPhonebook::erase(std::string &key)
        i != _sortedPhonebook.end() &&
          i->first == PhoneMapKey(*this, lowercase(key));
        ++i)
-  {
-    checkReadonly();
-    _changed = true;
-    if (_fromFile)
-      delete i->second;
-    else
-      _mePhonebook->erase((Phonebook::iterator)i->second);
-  }
+    eraseEntry(i->second);
 
   return _sortedPhonebook.erase(PhoneMapKey(*this, lowercase(key)));
 }
@@ -443,29 +529,38 @@ SortedPhonebook::size_type SortedPhonebook::erase(int key)
          _sortedPhonebook.find(PhoneMapKey(*this, key));
        i != _sortedPhonebook.end() && i->first == PhoneMapKey(*this, key);
        ++i)
-  {
-    checkReadonly();
-    _changed = true;
-    if (_fromFile)
-      delete i->second;
-    else
-      _mePhonebook->erase((Phonebook::iterator)i->second);
-  }
+    eraseEntry(i->second);
 
   return _sortedPhonebook.erase(PhoneMapKey(*this, key));
 }
 
-void SortedPhonebook::erase(iterator position)
+void SortedPhonebook::eraseEntry(PhonebookEntryBase *entry)
   throw(GsmException)
 {
   checkReadonly();
   _changed = true;
+  // the entry cannot be found by its key if it has been changed in place
+  if (entry->changed())
+    _otherSortOrders.clear();
+  for (std::map<SortOrder, PhonebookMap>::iterator i =
+         _otherSortOrders.begin(); i != _otherSortOrders.end(); ++i)
+    eraseMapValue(i->second, mapKey(*entry, i->first), entry);
+
   // deallocate memory or remove from underlying ME phonebook
   if (_fromFile)
-    delete ((PhonebookMap::iterator)position)->second;
+  {
+    _mustRewrite = true;
+    _insertedEntries.clear();
+    delete entry;
+  }
   else
-    _mePhonebook->erase((Phonebook::iterator)
-                        ((PhonebookMap::iterator)position)->second);
+    _mePhonebook->erase((Phonebook::iterator)entry);
+}
+
+void SortedPhonebook::erase(iterator position)
+  throw(GsmException)
+{
+  eraseEntry(((PhonebookMap::iterator)position)->second);
   _sortedPhonebook.erase(position);
 }
 
@@ -473,21 +568,16 @@ void SortedPhonebook::erase(iterator first, iterator last)
   throw(GsmException)
 {
   checkReadonly();
-  _changed = true;
+  if (first == begin() && last == end())
+    _otherSortOrders.clear();
   for (PhonebookMap::iterator i = first; i != last; ++i)
-    if (_fromFile)
-      delete i->second;
-    else
-      _mePhonebook->erase((Phonebook::iterator)i->second);
+    eraseEntry(i->second);
   _sortedPhonebook.erase(first, last);
 }
 
 void SortedPhonebook::clear() throw(GsmException)
 {
-  checkReadonly();
-  _changed = true;
-  for (iterator i = begin(); i != end(); i++)
-    erase(i);
+  erase(begin(), end());
 }
 
 SortedPhonebook::~SortedPhonebook()
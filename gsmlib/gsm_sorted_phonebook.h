@@ -20,6 +20,7 @@
 #include <gsmlib/gsm_map_key.h>
 #include <string>
 #include <map>
+#include <vector>
 #include <fstream>
 
 namespace gsmlib
@@ -28,6 +29,12 @@ namespace gsmlib
   // The class SortedPhonebook makes the phonebook more manageable:
   // - empty slots in the ME phonebook are hidden by the API
   // - the class transparently handles phonebooks that reside in files
+  // The maps of all sort orders used so far are kept up to date, so
+  // switching back to a sort order is cheap (they are dropped if
+  // entries have been changed in place, eg. with PhonebookEntryBase::set())
+  // The maps are trees or sorted vectors (flat, see gsm_sorted_multimap)
+  // Files are rewritten in the current sort order on sync(), in
+  // incremental mode inserted entries are appended instead
 
   class SortedPhonebook : public SortedPhonebookBase
   {
@@ -41,20 +48,56 @@ namespace gsmlib
     bool _readonly;             // =true if read from stdin
     std::string _filename;           // name of the file if phonebook from file
     PhonebookMap _sortedPhonebook; // phonebook from file
+    std::map<SortOrder, PhonebookMap> _otherSortOrders;
+                                // maps of the other sort orders used so
+                                // far, kept up to date with the phonebook
     PhonebookRef _mePhonebook;  // phonebook if from ME
 
-    // convert CR and LF in string to "\r" and "\n" respectively
-    std::string escapeString(std::string s);
-
-    // convert "\r" and "\n" to CR and LF respectively
-    // start parsing with pos, stop when CR, LF, 0, or '|' is encountered
-    std::string unescapeString(char *line, unsigned int &pos);
-
-    // initial read of phonebook file
-    void readPhonebookFile(std::istream &pbs, std::string filename) throw(GsmException);
+    // state of file-based phonebook for incremental sync
+    bool _incremental;          // append inserted entries on sync
+    bool _mustRewrite;          // entries erased or file cannot be
+                                // appended to
+    unsigned long _fileLength;  // length of the file after the last read
+                                // or write
+    std::vector<PhonebookEntryBase*> _insertedEntries;
+                                // inserted since last sync
+
+    bool _outdatedKeys;         // entries were changed in place before
+                                // the last sync(), keys in
+                                // _sortedPhonebook may be outdated
+
+    // convert CR and LF in string to "\r" and "\n" respectively and
+    // append to result
+    void escapeString(const std::string &s, std::string &result);
+
+    // append file line of entry to contents
+    void appendLine(std::string &contents, PhonebookEntryBase &entry);
+
+    // convert "\r" and "\n" to CR and LF respectively and append to
+    // result
+    // start parsing with p, stop when end, CR, LF, 0, or '|' is
+    // encountered and return that position
+    const char *unescapeString(const char *p, const char *end,
+                               std::string &result);
+
+    // initial read of length bytes of phonebook file
+    // all entries are parsed before the map is built in one go
+    void readPhonebookFile(const char *data, unsigned long length)
+      throw(GsmException);
 
     // synchronize SortedPhonebook with file (no action if in ME)
     void sync(bool fromDestructor) throw(GsmException);
+
+    // return map key of entry for sortOrder
+    PhoneMapKey mapKey(PhonebookEntryBase &entry, SortOrder sortOrder);
+
+    // return true if entries have been changed in place since they were
+    // put into the maps, their keys are outdated then
+    bool outdatedKeys();
+
+    // deallocate entry or remove it from underlying ME phonebook
+    // and the maps of the other sort orders
+    void eraseEntry(PhonebookEntryBase *entry) throw(GsmException);
     
     // throw an exception if _readonly is set
     void checkReadonly() throw(GsmException);
@@ -85,6 +128,12 @@ namespace gsmlib
     // handle sorting
     void setSortOrder(SortOrder newOrder);
     SortOrder sortOrder() const {return _sortOrder;}
+
+    // use sorted vectors instead of trees for the maps (faster to build,
+    // traverse and search, but each insert or erase moves the entries
+    // after it and invalidates all iterators)
+    void setFlat(bool flat);
+    bool flat() const {return _sortedPhonebook.flat();}
     
     // phonebook traversal commands
     // these are suitable to use stdc++ lib algorithms and iterators
@@ -102,6 +151,7 @@ namespace gsmlib
     bool empty() const throw(GsmException) {return size() == 0;}
 
     // existing iterators remain valid after an insert or erase operation
+    // (unless flat)
     // note: inserting many entries in indexed mode is inefficient
     // if the sort order is not set to indexed before
 
@@ -145,6 +195,12 @@ namespace gsmlib
 
     // synchronize SortedPhonebook with file (no action if in ME)
     void sync() throw(GsmException) {sync(false);}
+
+    // if set, sync() appends the entries inserted since the last sync()
+    // to the file instead of rewriting it, unless entries have been
+    // changed or erased (the file is then no longer in sort order)
+    void setIncremental(bool incremental) {_incremental = incremental;}
+    bool incremental() const {return _incremental;}
     
     // destructor
     // writes back change to file if phonebook is in file
@@ -18,6 +18,7 @@
 
 #include <gsmlib/gsm_util.h>
 #include <gsmlib/gsm_map_key.h>
+#include <gsmlib/gsm_sorted_multimap.h>
 #include <string>
 #include <map>
 #include <fstream>
@@ -94,7 +95,7 @@ namespace gsmlib
 
   // maps text or telephone to entry
   
-  typedef std::multimap<PhoneMapKey, PhonebookEntryBase*> PhonebookMap;
+  typedef SortedMultimap<PhoneMapKey, PhonebookEntryBase*> PhonebookMap;
 
   // iterator for SortedPhonebook that hides the "second" member of the map
   
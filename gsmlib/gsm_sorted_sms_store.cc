@@ -17,7 +17,6 @@
 #include <gsmlib/gsm_sysdep.h>
 #include <gsmlib/gsm_sorted_sms_store.h>
 #include <iostream>
-#include <fstream>
 #include <cstring>
 #ifdef HAVE_NETINET_IN_H
 #include <netinet/in.h>
@@ -28,33 +27,78 @@ using namespace gsmlib;
 // SMS message file format:
 // version number of file format, unsigned short int, 2 bytes in network byte
 // order
-// then comes the message:
+//
+// version 1, then comes the message:
 // 1. length of PDU (see 4. below): unsigned short int,
 //    2 bytes in network byte order
-// 2. index of message, unique for this file: unsigned long,
-//    4 bytes in network byte order
+// 2. reserved, 4 bytes
 // 3. MessageType (1 byte), any of:
 //    0 SMS_DELIVER
 //    1 SMS_SUBMIT
 //    2 SMS_STATUS_REPORT
 // 4. PDU in hexadecimal format
+//
+// version 2, then come the journal records, which are replayed in order:
+// 1. record type (1 byte): 'I' insert message, 'E' erase message
+// 2. index of message, unique for this file: unsigned long,
+//    4 bytes in network byte order
+// 3. for 'I' only: MessageType (1 byte, see above), length of PDU
+//    (2 bytes in network byte order) and PDU in hexadecimal format
+// 4. CRC-32 of 1. to 3., 4 bytes in network byte order
+// reading stops at the first incomplete record or record with a wrong
+// CRC (eg. after a crash while appending), the file is compacted on
+// the next write
+
+static const unsigned short int SMS_STORE_FILE_FORMAT_VERSION = 2;
 
-static const unsigned short int SMS_STORE_FILE_FORMAT_VERSION = 1;
+static const char INSERT_RECORD = 'I';
+static const char ERASE_RECORD = 'E';
 
 // SortedSMSStore members
 
-// aux function read bytes with error handling
-// return false if EOF
-static bool readnbytes(std::string &filename,
-                       std::istream &is, int len, char *buf,
-                       bool eofIsError = true) throw(GsmException)
+// aux functions to access numbers in network byte order
+static unsigned long getNumber(const char *p, int len)
 {
-  is.read(buf, len);
-  if (is.bad() || (is.eof() && eofIsError))
-    throw GsmException(stringPrintf(_("error reading from file '%s'"),
-                                    (filename == "" ? _("<STDIN>") :
-                                     filename.c_str())), OSError);
-  return ! is.eof();
+  if (len == 2)
+  {
+    unsigned_int_2 n;
+    memcpy(&n, p, sizeof(n));
+    return ntohs(n);
+  }
+  unsigned_int_4 n;
+  memcpy(&n, p, sizeof(n));
+  return ntohl(n);
+}
+
+static void appendNumber(std::string &s, unsigned long number, int len)
+{
+  if (len == 2)
+  {
+    unsigned_int_2 n = htons(number);
+    s.append((char*)&n, sizeof(n));
+  }
+  else
+  {
+    unsigned_int_4 n = htonl(number);
+    s.append((char*)&n, sizeof(n));
+  }
+}
+
+// aux function to append a journal record
+static void appendRecord(std::string &s, char type, unsigned int index,
+                         SMSMessageRef message = SMSMessageRef())
+{
+  std::string::size_type start = s.length();
+  s += type;
+  appendNumber(s, index, 4);
+  if (type == INSERT_RECORD)
+  {
+    std::string pdu = message->encode();
+    s += (char)message->messageType();
+    appendNumber(s, pdu.length(), 2);
+    s += pdu;
+  }
+  appendNumber(s, crc32(s.data() + start, s.length() - start), 4);
 }
 
 // aux function write bytes with error handling
@@ -68,175 +112,509 @@ static void writenbytes(std::string &filename, std::ostream &os,
                                      filename.c_str())), OSError);
 }
 
-void SortedSMSStore::readSMSFile(std::istream &pbs, std::string filename)
+void SortedSMSStore::readSMSFile(const char *p, unsigned long length,
+                                 std::string filename, bool lazy)
   throw(GsmException)
 {
-  char numberBuf[4];
+  // file might be empty initially
+  if (length < 2)
+    return;
 
   // check the version
+  unsigned long version = getNumber(p, 2);
+  if (version != 1 && version != SMS_STORE_FILE_FORMAT_VERSION)
+    throw GsmException(stringPrintf(_("file '%s' has wrong version"),
+                                    filename.c_str()), ParameterError);
+
+  // read entries, sorted by index
+  std::map<unsigned int, SMSStoreEntry*> entries;
+  unsigned long pos = 2;
   try
+  {
+    while (pos < length)
+      if (version == 1)
+      {
+        // PDU length, reserved field (was formerly index), message type
+        if (length - pos < 7)
+          throw GsmException(stringPrintf(_("corrupt SMS store file '%s'"),
+                                          filename.c_str()), ParameterError);
+        unsigned long pduLen = getNumber(p + pos, 2);
+        SMSMessage::MessageType messageType =
+          (SMSMessage::MessageType)p[pos + 6];
+        pos += 7;
+        if (pduLen > 500 || messageType > 2 || length - pos < pduLen)
+          throw GsmException(stringPrintf(_("corrupt SMS store file '%s'"),
+                                          filename.c_str()), ParameterError);
+
+        bool SCtoMEdirection = messageType != SMSMessage::SMS_SUBMIT;
+        entries[_nextIndex] = lazy ?
+          new SMSStoreEntry(p + pos, pduLen, SCtoMEdirection, _nextIndex) :
+          new SMSStoreEntry(SMSMessage::decode(std::string(p + pos, pduLen),
+                                               SCtoMEdirection),
+                            _nextIndex);
+        pos += pduLen;
+        ++_nextIndex;
+        _journalLength = pos;
+      }
+      else
+      {
+        // check that the record is complete and intact
+        unsigned long recordLen = 5;
+        if (length - pos < recordLen + 4)
+          break;
+        char type = p[pos];
+        unsigned int index = getNumber(p + pos + 1, 4);
+        unsigned long pduLen = 0;
+        SMSMessage::MessageType messageType = SMSMessage::SMS_DELIVER;
+        if (type == INSERT_RECORD)
+        {
+          if (length - pos < recordLen + 3)
+            break;
+          messageType = (SMSMessage::MessageType)p[pos + 5];
+          pduLen = getNumber(p + pos + 6, 2);
+          recordLen += 3 + pduLen;
+          if (pduLen > 500 || messageType > 2 ||
+              length - pos < recordLen + 4)
+            break;
+        }
+        else if (type != ERASE_RECORD)
+          break;
+        if (crc32(p + pos, recordLen) != getNumber(p + pos + recordLen, 4))
+          break;
+
+        // replay the record
+        std::map<unsigned int, SMSStoreEntry*>::iterator i =
+          entries.find(index);
+        if (i != entries.end())
+        {
+          delete i->second;
+          entries.erase(i);
+          _recordOffsets.erase(index);
+          _deadRecords += 2;
+        }
+        else if (type == ERASE_RECORD)
+          ++_deadRecords;
+        if (type == INSERT_RECORD)
+        {
+          _recordOffsets[index] = pos;
+          bool SCtoMEdirection = messageType != SMSMessage::SMS_SUBMIT;
+          entries[index] = lazy ?
+            new SMSStoreEntry(p + pos + 8, pduLen, SCtoMEdirection, index) :
+            new SMSStoreEntry(
+              SMSMessage::decode(std::string(p + pos + 8, pduLen),
+                                 SCtoMEdirection), index);
+        }
+        if (index >= _nextIndex)
+          _nextIndex = index + 1;
+        _journalTail = getNumber(p + pos + recordLen, 4);
+        pos += recordLen + 4;
+        _journalLength = pos;
+      }
+
+    _mustCompact = version != SMS_STORE_FILE_FORMAT_VERSION ||
+      _journalLength != length;
+
+    std::map<unsigned int, SMSStoreEntry*>::iterator i;
+    _sortedSMSStore.reserve(entries.size());
+    while ((i = entries.begin()) != entries.end())
     {
-      readnbytes(filename, pbs, 2, numberBuf);
+      _sortedSMSStore.insertBuffered(
+        SMSStoreMap::value_type(mapKey(*i->second, _sortOrder), i->second));
+      entries.erase(i);
     }
+  }
   catch (GsmException &)
+  {
+    for (std::map<unsigned int, SMSStoreEntry*>::iterator i =
+           entries.begin(); i != entries.end(); ++i)
+      delete i->second;
+    for (SMSStoreMap::iterator i = _sortedSMSStore.begin();
+         i != _sortedSMSStore.end(); ++i)
+      delete i->second;
+    _sortedSMSStore.clear();
+    _recordOffsets.clear();
+    throw;
+  }
+}
+
+bool SortedSMSStore::readIndexedSMSFile(const char *p, unsigned long length,
+                                        std::string filename)
+  throw(GsmException)
+{
+  if (length < 2 || getNumber(p, 2) != SMS_STORE_FILE_FORMAT_VERSION ||
+      _sortOrder != ByDate)
+    return false;
+  unsigned long tail = length < 6 ? 0 : getNumber(p + length - 4, 4);
+  SMSStoreIndexRef index = new SMSStoreIndex(filename, length, tail);
+  if (! index->valid())
+    return false;
+
+  // the index is only valid for a file that has been written completely,
+  // so only the location of the records is checked
+  // the entries are inserted in date order
+  _sortedSMSStore.reserve(index->size());
+  for (unsigned long i = 0; i < index->size(); ++i)
+  {
+    unsigned long pos = index->dateOffset(i);
+    if (pos < 2 || length < 12 || pos > length - 12 ||
+        p[pos] != INSERT_RECORD || (unsigned char)p[pos + 5] > 2 ||
+        getNumber(p + pos + 6, 2) > length - pos - 12)
     {
-      // ignore error, file might be empty initially
+      for (SMSStoreMap::iterator j = _sortedSMSStore.begin();
+           j != _sortedSMSStore.end(); ++j)
+        delete j->second;
+      _sortedSMSStore.clear();
+      _nextIndex = 0;
+      return false;
     }
-  unsigned_int_2 version;
-  memcpy(&version, numberBuf, sizeof(*numberBuf));
-  version = ntohs(version);
-  if (!pbs.eof() && version != SMS_STORE_FILE_FORMAT_VERSION)
-    throw GsmException(stringPrintf(_("file '%s' has wrong version"),
-                                    filename.c_str()), ParameterError);
 
-  // read entries
-  while (1)
+    SMSMessage::MessageType messageType =
+      (SMSMessage::MessageType)p[pos + 5];
+    unsigned int entryIndex = getNumber(p + pos + 1, 4);
+    _sortedSMSStore.insertBuffered(
+      SMSStoreMap::value_type(
+        SMSMapKey(*this, index->timestamp(i)),
+        new SMSStoreEntry(p + pos + 8, getNumber(p + pos + 6, 2),
+                          messageType != SMSMessage::SMS_SUBMIT,
+                          entryIndex)));
+    if (entryIndex >= _nextIndex)
+      _nextIndex = entryIndex + 1;
+  }
+
+  // record offsets are not needed because the store is not written
+  _journalLength = length;
+  _journalTail = tail;
+  _indexed = true;
+  _index = index;
+  return true;
+}
+
+SMSIndexItem SortedSMSStore::indexItem(SMSStoreEntry &entry,
+                                       unsigned long offset)
+  throw(GsmException)
+{
+  SMSIndexItem item;
+  Ref<SMSMessageView> view = entry.headerView();
+  if (view.isnull())
+  {
+    item._timestamp = entry.message()->serviceCentreTimestamp();
+    item._address = entry.message()->address();
+  }
+  else
+  {
+    item._timestamp = view->serviceCentreTimestamp();
+    item._address = view->address();
+  }
+  item._offset = offset;
+  return item;
+}
+
+void SortedSMSStore::writeIndex() throw(GsmException)
+{
+  // the file must contain exactly the current messages
+  assert(! _changed && ! _mustCompact && _journalLength != 0);
+  _index = SMSStoreIndexRef();
+
+  std::vector<SMSIndexItem> items;
+  items.reserve(_sortedSMSStore.size());
+  for (SMSStoreMap::iterator i = _sortedSMSStore.begin();
+       i != _sortedSMSStore.end(); ++i)
+  {
+    std::map<unsigned int, unsigned long>::iterator offset =
+      _recordOffsets.find(i->second->index());
+    assert(offset != _recordOffsets.end());
+    items.push_back(indexItem(*i->second, offset->second));
+  }
+
+  SMSStoreIndexRef index =
+    new SMSStoreIndex(items, _journalLength, _journalTail);
+  index->write(_filename);
+  _index = index;
+}
+
+SMSMapKey SortedSMSStore::mapKey(SMSStoreEntry &entry, SortOrder sortOrder)
+  throw(GsmException)
+{
+  if (sortOrder == ByIndex)
+    return SMSMapKey(*this, sortOrder, entry.index());
+
+  // only parse the header of entries that have not been decoded yet
+  Ref<SMSMessageView> view = entry.headerView();
+  switch (sortOrder)
+  {
+  case ByDate:
+    return SMSMapKey(*this, sortOrder, view.isnull() ?
+                     entry.message()->serviceCentreTimestamp() :
+                     view->serviceCentreTimestamp());
+  case ByAddress:
+    return SMSMapKey(*this, sortOrder, view.isnull() ?
+                     entry.message()->address() : view->address());
+  case ByType:
+    return SMSMapKey(*this, sortOrder, view.isnull() ?
+                     (int)entry.message()->messageType() :
+                     (int)view->messageType());
+  default:
+    assert(0);
+    break;
+  }
+  return SMSMapKey(*this, sortOrder, 0);
+}
+
+std::string SortedSMSStore::storeFileContents(
+  std::map<unsigned int, unsigned long> &recordOffsets, unsigned long &tail)
+{
+  // write in index order, so that record offsets increase with the index
+  // as they do for appended records
+  std::map<unsigned int, SMSStoreEntry*> entries;
+  for (SMSStoreMap::iterator i = _sortedSMSStore.begin();
+       i != _sortedSMSStore.end(); ++i)
+    entries[i->second->index()] = i->second;
+
+  std::string contents;
+  appendNumber(contents, SMS_STORE_FILE_FORMAT_VERSION, 2);
+  for (std::map<unsigned int, SMSStoreEntry*>::iterator i = entries.begin();
+       i != entries.end(); ++i)
+  {
+    recordOffsets[i->first] = contents.length();
+    appendRecord(contents, INSERT_RECORD, i->first, i->second->message());
+  }
+  tail = entries.empty() ? 0 :
+    getNumber(contents.data() + contents.length() - 4, 4);
+  return contents;
+}
+
+bool SortedSMSStore::takeAssignedEntries()
+{
+  bool assigned = false;
+  for (SMSStoreMap::iterator i = _sortedSMSStore.begin();
+       i != _sortedSMSStore.end(); ++i)
+    if (i->second->changed())
     {
-      // read PDU length and exit loop if EOF
-      if (! readnbytes(filename, pbs, 2, numberBuf, false))
-	break;
-
-      unsigned_int_2 pduLen;
-      memcpy(&pduLen, numberBuf, sizeof(*numberBuf));
-      pduLen = ntohs(pduLen);
-
-      if (pduLen > 500)
-	throw GsmException(stringPrintf(_("corrupt SMS store file '%s'"),
-					filename.c_str()), ParameterError);
-
-      // read reserved integer field of message (was formerly index)
-      readnbytes(filename, pbs, 4, numberBuf);
-      //unsigned_int_4 reserved = ntohl(*((unsigned_int_4*)numberBuf));
-    
-      // read message type
-      readnbytes(filename, pbs, 1, numberBuf);
-      SMSMessage::MessageType messageType =
-	(SMSMessage::MessageType)numberBuf[0];
-      if (messageType > 2)
-	throw GsmException(stringPrintf(_("corrupt SMS store file '%s'"),
-					filename.c_str()), ParameterError);
-
-      char *pduBuf = (char*)alloca(sizeof(char) * pduLen);
-
-      // read pdu
-      readnbytes(filename, pbs, pduLen, pduBuf);
-      SMSMessageRef message =
-	SMSMessage::decode(std::string(pduBuf, pduLen),
-			   (messageType != SMSMessage::SMS_SUBMIT));
-    
-      SMSStoreEntry *newEntry = new SMSStoreEntry(message, _nextIndex++);
-      _sortedSMSStore.insert(
-			     SMSStoreMap::value_type(
-						     SMSMapKey(*this, message->serviceCentreTimestamp()),
-						     newEntry)
-			     );
+      i->second->resetChanged();
+      assigned = true;
+      if (_fromFile)
+      {
+        // a message not yet written to the file is just replaced
+        unsigned int index = i->second->index();
+        if (_pendingInserts.find(index) == _pendingInserts.end())
+          _pendingErases.push_back(index);
+        _pendingInserts[index] = i->second->message();
+        _changed = true;
+      }
     }
+  if (assigned)
+    _otherSortOrders.clear();
+  return assigned;
 }
 
 void SortedSMSStore::sync(bool fromDestructor) throw(GsmException)
 {
+  if (_fromFile)
+    takeAssignedEntries();
   if (_fromFile && _changed)
   {
     checkReadonly();
 
     // if writing to stdout and not called from destructor ignore
     // (avoids writing to stdout multiple times)
-    if (_filename == "" && ! fromDestructor) return;
+    if (_filename == "")
+    {
+      if (fromDestructor)
+      {
+        std::map<unsigned int, unsigned long> recordOffsets;
+        unsigned long tail;
+        std::string contents = storeFileContents(recordOffsets, tail);
+        writenbytes(_filename, std::cout, contents.length(),
+                    contents.data());
+        _changed = false;
+      }
+      return;
+    }
 
-    // create backup file - but only once
-    if (! _madeBackupFile && _filename != "") // don't make backup of stdout
+    // rewrite the file if it is new or mostly consists of records of
+    // erased messages
+    if (_mustCompact || _journalLength == 0 ||
+        _deadRecords + 2 * _pendingErases.size() > _sortedSMSStore.size())
     {
-      renameToBackupFile(_filename);
-      _madeBackupFile = true;
+      compact();
+      return;
     }
 
-    // open stream
-    std::ostream *pbs = NULL;
-    try
+    // otherwise append records of the changes
+    std::string records;
+    std::vector<unsigned long> erasedOffsets;
+    for (std::vector<unsigned int>::iterator i = _pendingErases.begin();
+         i != _pendingErases.end(); ++i)
     {
-      if (_filename == "")
-        pbs = &std::cout;
-      else
-	pbs = new std::ofstream(_filename.c_str(), std::ios::out | std::ios::binary);
-      
-      if (pbs->bad())
-        throw GsmException(
-          stringPrintf(_("error opening file '%s' for writing"),
-                       (_filename == "" ? _("<STDOUT>") :
-                        _filename.c_str())),
-          OSError);
-
-      // write version number
-      unsigned_int_2 version = htons(SMS_STORE_FILE_FORMAT_VERSION);
-      writenbytes(_filename, *pbs, 2, (char*)&version);
-
-      // and write the entries
-      for (SMSStoreMap::iterator i = _sortedSMSStore.begin();
-           i != _sortedSMSStore.end(); ++i)
+      appendRecord(records, ERASE_RECORD, *i);
+      std::map<unsigned int, unsigned long>::iterator offset =
+        _recordOffsets.find(*i);
+      if (offset != _recordOffsets.end())
       {
-        // create PDU and write length
-        std::string pdu = i->second->message()->encode();
-        unsigned_int_2 pduLen = htons(pdu.length());
-        writenbytes(_filename, *pbs, 2, (char*)&pduLen);
-
-        // write reserved field (was formerly index)
-        unsigned_int_4 reserved = htonl(0);
-        writenbytes(_filename, *pbs, 4, (char*)&reserved);
-        
-        // write message type
-        char messageType = i->second->message()->messageType();
-        writenbytes(_filename, *pbs, 1, (char*)&messageType);
-
-        // write PDU
-        writenbytes(_filename, *pbs, pdu.length(), pdu.data());
+        erasedOffsets.push_back(offset->second);
+        _recordOffsets.erase(offset);
       }
     }
-    catch(GsmException &)
+    std::vector<SMSIndexItem> items;
+    for (std::map<unsigned int, SMSMessageRef>::iterator i =
+           _pendingInserts.begin(); i != _pendingInserts.end(); ++i)
     {
-      if (pbs != &std::cout) delete pbs;
-      throw;
+      unsigned long offset = _journalLength + records.length();
+      _recordOffsets[i->first] = offset;
+      if (_indexed)
+      {
+        SMSIndexItem item;
+        item._timestamp = i->second->serviceCentreTimestamp();
+        item._address = i->second->address();
+        item._offset = offset;
+        items.push_back(item);
+      }
+      appendRecord(records, INSERT_RECORD, i->first, i->second);
     }
-    // close file
-    if (pbs != &std::cout) delete pbs;
 
+    // the records must be on the disk before the index refers to them
+    writeFileSynced(_filename, records.data(), records.length(), false,
+                    _journalLength);
+
+    _journalLength += records.length();
+    if (records.length() != 0)
+      _journalTail = getNumber(records.data() + records.length() - 4, 4);
+    _deadRecords += 2 * _pendingErases.size();
+    _pendingInserts.clear();
+    _pendingErases.clear();
     _changed = false;
+
+    // update the index with the changes if it was valid before
+    if (_indexed)
+    {
+      if (_index.isnull())
+        writeIndex();
+      else
+      {
+        SMSStoreIndexRef index =
+          new SMSStoreIndex(_index(), erasedOffsets, items, _journalLength,
+                            _journalTail);
+        _index = SMSStoreIndexRef();
+        index->write(_filename);
+        _index = index;
+      }
+    }
+  }
+}
+
+void SortedSMSStore::compact() throw(GsmException)
+{
+  if (! _fromFile || _filename == "")
+    return;
+  checkReadonly();
+
+  // write to a temporary file first so that a crash leaves either the
+  // old or the new file
+  std::string tempFilename = _filename + ".tmp";
+  std::map<unsigned int, unsigned long> recordOffsets;
+  unsigned long tail;
+  std::string contents = storeFileContents(recordOffsets, tail);
+  writeFileSynced(tempFilename, contents.data(), contents.length());
+  replaceFile(tempFilename, _filename);
+
+  _journalLength = contents.length();
+  _journalTail = tail;
+  _recordOffsets.swap(recordOffsets);
+  _deadRecords = 0;
+  _mustCompact = false;
+  _pendingInserts.clear();
+  _pendingErases.clear();
+  _changed = false;
+  if (_indexed)
+    writeIndex();
+}
+
+void SortedSMSStore::setIndexed(bool indexed) throw(GsmException)
+{
+  if (! _fromFile || _filename == "" || indexed == _indexed)
+    return;
+  checkReadonly();
+  _indexed = indexed;
+  if (! indexed)
+  {
+    _index = SMSStoreIndexRef();
+    SMSStoreIndex::remove(_filename);
   }
+  else if (_mustCompact || _journalLength == 0)
+    _changed = true;            // index is written after compaction
+  else if (! _changed)
+    writeIndex();
 }
 
 void SortedSMSStore::checkReadonly() throw(GsmException)
 {
-  if (_readonly) throw GsmException(
-    _("attempt to change SMS store read from <STDIN>"),
-    ParameterError);
+  if (_readonly)
+  {
+    if (_filename == "")
+      throw GsmException(_("attempt to change SMS store read from <STDIN>"),
+                         ParameterError);
+    throw GsmException(
+      stringPrintf(_("attempt to change read-only SMS store file '%s'"),
+                   _filename.c_str()), ParameterError);
+  }
 }
 
-SortedSMSStore::SortedSMSStore(std::string filename) throw(GsmException) :
-  _changed(false), _fromFile(true), _madeBackupFile(false),
-  _sortOrder(ByDate), _readonly(false), _filename(filename), _nextIndex(0)
+SortedSMSStore::SortedSMSStore(std::string filename, bool readonly)
+  throw(GsmException) :
+  _changed(false), _fromFile(true), _sortOrder(ByDate), _readonly(readonly),
+  _filename(filename), _nextIndex(0), _journalLength(0), _deadRecords(0),
+  _mustCompact(false), _journalTail(0), _indexed(false)
 {
-  // open the file
-  std::ifstream pbs(filename.c_str(), std::ios::in | std::ios::binary);
-  if (pbs.bad())
-    throw GsmException(stringPrintf(_("cannot open file '%s'"),
-                                    filename.c_str()), OSError);
-  // and read the file
-  readSMSFile(pbs, filename);
+  if (readonly)
+  {
+    // map read-only file into memory, use the index if it is valid
+    _sortedSMSStore.setFlat(true);
+    _file = new MappedFile(filename);
+    if (! readIndexedSMSFile(_file->data(), _file->length(), filename))
+      readSMSFile(_file->data(), _file->length(), filename, true);
+    return;
+  }
+
+  // the file might not exist yet
+  MappedFile file(filename, false);
+  readSMSFile(file.data(), file.length(), filename, false);
+
+  // an existing index is maintained, it is rewritten on the next change
+  // if it is not valid
+  if (SMSStoreIndex::exists(filename))
+  {
+    _indexed = true;
+    if (! _mustCompact)
+    {
+      SMSStoreIndexRef index =
+        new SMSStoreIndex(filename, _journalLength, _journalTail);
+      if (index->valid())
+        _index = index;
+    }
+  }
 }
 
 SortedSMSStore::SortedSMSStore(bool fromStdin) throw(GsmException) :
-  _changed(false), _fromFile(true), _madeBackupFile(false),
-  _sortOrder(ByDate), _readonly(fromStdin), _nextIndex(0)
+  _changed(false), _fromFile(true), _sortOrder(ByDate),
+  _readonly(fromStdin), _nextIndex(0), _journalLength(0), _deadRecords(0),
+  _mustCompact(false), _journalTail(0), _indexed(false)
   // _filename is "" - this means stdout
 {
   // read from stdin
   if (fromStdin)
-    readSMSFile(std::cin, (std::string)_("<STDIN>"));
+  {
+    std::string filename = _("<STDIN>");
+    _sortedSMSStore.setFlat(true);
+    _file = new MappedFile(std::cin, filename);
+    readSMSFile(_file->data(), _file->length(), filename, true);
+  }
 }
 
 SortedSMSStore::SortedSMSStore(SMSStoreRef meSMSStore)
   throw(GsmException) :
-  _changed(false), _fromFile(false), _madeBackupFile(false),
-  _sortOrder(ByDate), _readonly(false), _meSMSStore(meSMSStore)
+  _changed(false), _fromFile(false), _sortOrder(ByDate), _readonly(false),
+  _meSMSStore(meSMSStore), _nextIndex(0), _journalLength(0),
+  _deadRecords(0), _mustCompact(false), _journalTail(0), _indexed(false)
 {
   // It is necessary to count the entries read because
   // the maximum index into the SMS store may be larger than smsStore.size()
@@ -249,7 +627,7 @@ SortedSMSStore::SortedSMSStore(SMSStoreRef meSMSStore)
       break;                 // ready
     if (! _meSMSStore()[i].empty())
     {
-      _sortedSMSStore.insert(
+      _sortedSMSStore.insertBuffered(
         SMSStoreMap::value_type(
           SMSMapKey(*this,
                     _meSMSStore()[i].message()->serviceCentreTimestamp()),
@@ -265,55 +643,42 @@ void SortedSMSStore::setSortOrder(SortOrder newOrder)
 {
   if (_sortOrder == newOrder) return; // nothing to be done
 
-  SMSStoreMap savedSMSStore = _sortedSMSStore;
-  _sortedSMSStore = SMSStoreMap();
-  _sortOrder = newOrder;
-
-  switch (newOrder)
-  {
-  case ByIndex:
-  {
-    for (SMSStoreMap::iterator i = savedSMSStore.begin();
-         i != savedSMSStore.end(); ++i)
-      _sortedSMSStore.insert(
-        SMSStoreMap::value_type(SMSMapKey(*this, (i->second->index())),
-                                i->second));
-    break;
-  }
-  case ByDate:
+  // entries that have been assigned to have outdated keys in all maps,
+  // then the map of the new sort order is built from scratch and no map
+  // is kept
+  bool outdated = takeAssignedEntries();
+
+  // use the map of the new sort order if it has been built before,
+  // otherwise build it, the map of the old sort order is kept
+  SMSStoreMap newSMSStore(_sortedSMSStore.flat());
+  std::map<SortOrder, SMSStoreMap>::iterator i =
+    _otherSortOrders.find(newOrder);
+  if (i != _otherSortOrders.end())
   {
-    for (SMSStoreMap::iterator i = savedSMSStore.begin();
-         i != savedSMSStore.end(); ++i)
-      _sortedSMSStore.insert(
-        SMSStoreMap::value_type(
-          SMSMapKey(*this, (i->second->message()->serviceCentreTimestamp())),
-          i->second));
-    break;
-  }
-  case ByAddress:
-  {
-    for (SMSStoreMap::iterator i = savedSMSStore.begin();
-         i != savedSMSStore.end(); ++i)
-      _sortedSMSStore.insert(
-        SMSStoreMap::value_type(
-          SMSMapKey(*this, (i->second->message()->address())),
-          i->second));
-    break;
+    newSMSStore.swap(i->second);
+    _otherSortOrders.erase(i);
   }
-  case ByType:
+  else
   {
-    for (SMSStoreMap::iterator i = savedSMSStore.begin();
-         i != savedSMSStore.end(); ++i)
-      _sortedSMSStore.insert(
-        SMSStoreMap::value_type(
-          SMSMapKey(*this, (i->second->message()->messageType())),
-          i->second));
-    break;
-  }
-  default:
-    assert(0);
-    break;
+    newSMSStore.reserve(_sortedSMSStore.size());
+    for (SMSStoreMap::iterator j = _sortedSMSStore.begin();
+         j != _sortedSMSStore.end(); ++j)
+      newSMSStore.insertBuffered(
+        SMSStoreMap::value_type(mapKey(*j->second, newOrder), j->second));
   }
+
+  if (! outdated)
+    _otherSortOrders[_sortOrder].swap(_sortedSMSStore);
+  _sortedSMSStore.swap(newSMSStore);
+  _sortOrder = newOrder;
+}
+
+void SortedSMSStore::setFlat(bool flat)
+{
+  _sortedSMSStore.setFlat(flat);
+  for (std::map<SortOrder, SMSStoreMap>::iterator i =
+         _otherSortOrders.begin(); i != _otherSortOrders.end(); ++i)
+    i->second.setFlat(flat);
 }
 
 int SortedSMSStore::max_size() const
@@ -340,47 +705,22 @@ SortedSMSStore::insert(const SMSStoreEntry& x) throw(GsmException)
   SMSStoreEntry *newEntry;
 
   if (_fromFile)
+  {
     newEntry = new SMSStoreEntry(x.message(), _nextIndex++);
+    _pendingInserts[newEntry->index()] = x.message();
+  }
   else
   {
     SMSStoreEntry newMEEntry(x.message());
     newEntry = _meSMSStore->insert(newMEEntry);
   }
-  
-  switch (_sortOrder)
-  {
-  case ByIndex:
-    return
-      _sortedSMSStore.
-      insert(SMSStoreMap::value_type(SMSMapKey(*this, newEntry->index()),
-                                     newEntry));
-    break;
-  case ByDate:
-    return
-      _sortedSMSStore.
-      insert(SMSStoreMap::value_type(
-        SMSMapKey(*this, newEntry->message()->serviceCentreTimestamp()),
-        newEntry));
-    break;
-  case ByAddress:
-    return
-      _sortedSMSStore.
-      insert(SMSStoreMap::value_type(
-        SMSMapKey(*this, newEntry->message()->address()),
-        newEntry));
-    break;
-  case ByType:
-    return
-      _sortedSMSStore.
-      insert(SMSStoreMap::value_type(
-        SMSMapKey(*this, newEntry->message()->messageType()),
-        newEntry));
-    break;
-  default:
-    assert(0);
-    break;
-  }
-  return SortedSMSStore::iterator();
+
+  for (std::map<SortOrder, SMSStoreMap>::iterator i =
+         _otherSortOrders.begin(); i != _otherSortOrders.end(); ++i)
+    i->second.insertBuffered(
+      SMSStoreMap::value_type(mapKey(*newEntry, i->first), newEntry));
+  return _sortedSMSStore.insert(
+    SMSStoreMap::value_type(mapKey(*newEntry, _sortOrder), newEntry));
 }
 
 SortedSMSStore::iterator
@@ -397,17 +737,9 @@ SortedSMSStore::size_type SortedSMSStore::erase(Address &key)
 
   SMSMapKey mapKey(*this, key);
 
-  // deallocate memory or remove from underlying ME SMS store
   for (SMSStoreMap::iterator i = _sortedSMSStore.find(mapKey);
        i != _sortedSMSStore.end() && i->first == mapKey; ++i)
-  {
-    checkReadonly();
-    _changed = true;
-    if (_fromFile)
-      delete i->second;
-    else
-      _meSMSStore->erase((SMSStore::iterator)i->second);
-  }
+    eraseEntry(i->second);
 
   return _sortedSMSStore.erase(mapKey);
 }
@@ -419,17 +751,9 @@ SortedSMSStore::size_type SortedSMSStore::erase(int key)
 
   SMSMapKey mapKey(*this, key);
 
-  // deallocate memory or remove from underlying ME SMS store
   for (SMSStoreMap::iterator i = _sortedSMSStore.find(mapKey);
        i != _sortedSMSStore.end() && i->first == mapKey; ++i)
-  {
-    checkReadonly();
-    _changed = true;
-    if (_fromFile)
-      delete i->second;
-    else
-      _meSMSStore->erase((SMSStore::iterator)i->second);
-  }
+    eraseEntry(i->second);
 
   return _sortedSMSStore.erase(mapKey);
 }
@@ -441,32 +765,38 @@ SortedSMSStore::size_type SortedSMSStore::erase(Timestamp &key)
 
   SMSMapKey mapKey(*this, key);
 
-  // deallocate memory or remove from underlying ME SMS store
   for (SMSStoreMap::iterator i = _sortedSMSStore.find(mapKey);
        i != _sortedSMSStore.end() && i->first == mapKey; ++i)
-  {
-    checkReadonly();
-    _changed = true;
-    if (_fromFile)
-      delete i->second;
-    else
-      _meSMSStore->erase((SMSStore::iterator)i->second);
-  }
+    eraseEntry(i->second);
 
   return _sortedSMSStore.erase(mapKey);
 }
 
-void SortedSMSStore::erase(iterator position)
-  throw(GsmException)
+void SortedSMSStore::eraseEntry(SMSStoreEntry *entry) throw(GsmException)
 {
   checkReadonly();
   _changed = true;
-  // deallocate memory or remove from underlying ME SMS store
+  // the entry cannot be found by its key if it has been assigned to
+  if (entry->changed())
+    _otherSortOrders.clear();
+  for (std::map<SortOrder, SMSStoreMap>::iterator i =
+         _otherSortOrders.begin(); i != _otherSortOrders.end(); ++i)
+    eraseMapValue(i->second, mapKey(*entry, i->first), entry);
   if (_fromFile)
-    delete ((SMSStoreMap::iterator)position)->second;
+  {
+    // messages not yet written to the file need no erase record
+    if (_pendingInserts.erase(entry->index()) == 0)
+      _pendingErases.push_back(entry->index());
+    delete entry;
+  }
   else
-    _meSMSStore->erase((SMSStore::iterator)
-                       ((SMSStoreMap::iterator)position)->second);
+    _meSMSStore->erase((SMSStore::iterator)entry);
+}
+
+void SortedSMSStore::erase(iterator position)
+  throw(GsmException)
+{
+  eraseEntry(((SMSStoreMap::iterator)position)->second);
   _sortedSMSStore.erase(position);
 }
 
@@ -474,21 +804,16 @@ void SortedSMSStore::erase(iterator first, iterator last)
   throw(GsmException)
 {
   checkReadonly();
-  _changed = true;
+  if (first == begin() && last == end())
+    _otherSortOrders.clear();
   for (SMSStoreMap::iterator i = first; i != last; ++i)
-    if (_fromFile)
-      delete i->second;
-    else
-      _meSMSStore->erase((SMSStore::iterator)i->second);
+    eraseEntry(i->second);
   _sortedSMSStore.erase(first, last);
 }
 
 void SortedSMSStore::clear() throw(GsmException)
 {
-  checkReadonly();
-  _changed = true;
-  for (iterator i = begin(); i != end(); i++)
-    erase(i);
+  erase(begin(), end());
 }
 
 SortedSMSStore::~SortedSMSStore()
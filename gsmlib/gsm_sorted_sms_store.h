@@ -16,8 +16,11 @@
 #include <gsmlib/gsm_sms_store.h>
 #include <gsmlib/gsm_util.h>
 #include <gsmlib/gsm_map_key.h>
+#include <gsmlib/gsm_sorted_multimap.h>
+#include <gsmlib/gsm_sms_store_index.h>
 #include <string>
 #include <map>
+#include <vector>
 #include <assert.h>
 
 namespace gsmlib
@@ -29,7 +32,7 @@ namespace gsmlib
 
   // maps key (see SortedSMSStore::SortOrder) to entry
   
-  typedef std::multimap<SMSMapKey, SMSStoreEntry*> SMSStoreMap;
+  typedef SortedMultimap<SMSMapKey, SMSStoreEntry*> SMSStoreMap;
 
   // iterator for SortedSMSStore that hides the "second" member of the map
   
@@ -51,6 +54,20 @@ namespace gsmlib
   // The class SortedSMSStore makes the SMS store more manageable:
   // - empty slots in the ME phonebook are hidden by the API
   // - the class transparently handles stores that reside in files
+  // Files are journals: sync() appends records for the inserted and
+  // erased messages (an entry assigned to is erased and inserted again
+  // under its index), the file is only rewritten (compacted) when most
+  // of its records are obsolete
+  // Read-only files are mapped into memory (if supported by the
+  // operating system) and messages are only decoded when accessed
+  // If the store is indexed (see gsm_sms_store_index) the index file is
+  // kept up to date on sync(), read-only files with a valid index are
+  // opened without checking or parsing the messages
+  // The maps of all sort orders used so far are kept up to date, so
+  // switching back to a sort order is cheap (they are dropped if
+  // entries have been assigned to)
+  // The maps are trees or sorted vectors (flat, see gsm_sorted_multimap),
+  // read-only stores are flat
 
   class SortedSMSStore : public RefBase, public NoCopy
   {
@@ -58,21 +75,78 @@ namespace gsmlib
 
     bool _changed;              // true if file has changed after last save
     bool _fromFile;             // true if store read from file
-    bool _madeBackupFile;       // true if backup file was created
     SortOrder _sortOrder;       // sort order of the _sortedSMSStore
                                 // (default is ByDate)
     bool _readonly;             // =true if read from stdin
     std::string _filename;           // name of the file if store from file
     SMSStoreMap _sortedSMSStore; // store from file
+    std::map<SortOrder, SMSStoreMap> _otherSortOrders;
+                                // maps of the other sort orders used so
+                                // far, kept up to date with the store
     SMSStoreRef _meSMSStore;    // store if from ME
 
     unsigned int _nextIndex;    // next index to use for file-based store
 
-    // initial read of SMS file
-    void readSMSFile(std::istream &pbs, std::string filename) throw(GsmException);
-    
+    // journal state of file-based store
+    unsigned long _journalLength; // length of valid part of the file
+    unsigned long _deadRecords; // records of erased messages in the file
+    bool _mustCompact;          // file is old format or has a torn tail
+    std::map<unsigned int, SMSMessageRef> _pendingInserts;
+                                // inserted since last sync, by index
+    std::vector<unsigned int> _pendingErases;
+                                // indices erased since last sync
+
+    unsigned long _journalTail; // CRC of the last record in the file
+    std::map<unsigned int, unsigned long> _recordOffsets;
+                                // offsets of insert records, by index
+
+    // index of the file
+    bool _indexed;              // maintain index file
+    SMSStoreIndexRef _index;    // index of the file contents, if valid
+
+    // contents of read-only file, entries point into it
+    Ref<MappedFile> _file;
+
+    // initial read of length bytes of SMS file
+    // if lazy is set, entries are decoded on access and must not outlive
+    // the file contents
+    void readSMSFile(const char *file, unsigned long length,
+                     std::string filename, bool lazy) throw(GsmException);
+
+    // initial read of SMS file using the index file
+    // return false if there is no valid index
+    bool readIndexedSMSFile(const char *file, unsigned long length,
+                            std::string filename) throw(GsmException);
+
+    // return index item of entry at offset
+    SMSIndexItem indexItem(SMSStoreEntry &entry, unsigned long offset)
+      throw(GsmException);
+
+    // write index file for all messages
+    void writeIndex() throw(GsmException);
+
+    // return map key of entry for sortOrder
+    SMSMapKey mapKey(SMSStoreEntry &entry, SortOrder sortOrder)
+      throw(GsmException);
+
+    // create complete SMS file contents ordered by index, return
+    // offsets of the records and the CRC of the last record
+    std::string storeFileContents(
+      std::map<unsigned int, unsigned long> &recordOffsets,
+      unsigned long &tail);
+
     // synchronize SortedSMSStore with file (no action if in ME)
     void sync(bool fromDestructor) throw(GsmException);
+
+    // reset the changed flags of the entries assigned to, drop the maps
+    // of the other sort orders (their keys are outdated) and record the
+    // entries as pending erases and inserts if the store is file-based
+    // return true if any entry has been assigned to
+    bool takeAssignedEntries();
+
+    // deallocate entry or remove it from underlying ME SMS store
+    // and the maps of the other sort orders
+    void eraseEntry(SMSStoreEntry *entry) throw(GsmException);
     
     // throw an exception if _readonly is set
     void checkReadonly() throw(GsmException);
@@ -83,8 +157,10 @@ namespace gsmlib
     typedef SMSStoreMap::size_type size_type;
 
     // constructor for file-based store
-    // read from file
-    SortedSMSStore(std::string filename) throw(GsmException);
+    // read from file, a read-only store is mapped into memory and
+    // decoded lazily
+    SortedSMSStore(std::string filename, bool readonly = false)
+      throw(GsmException);
     // read from stdin or start empty and write to stdout
     SortedSMSStore(bool fromStdin) throw(GsmException);
 
@@ -203,6 +279,26 @@ namespace gsmlib
 
     // synchronize SortedPhonebook with file (no action if in ME)
     void sync() throw(GsmException) {sync(false);}
+
+    // rewrite file with the current messages only
+    // (no action if in ME or writing to stdout)
+    void compact() throw(GsmException);
+
+    // use sorted vectors instead of trees for the maps (faster to build,
+    // traverse and search, but each insert or erase moves the entries
+    // after it and invalidates all iterators)
+    void setFlat(bool flat);
+    bool flat() const {return _sortedSMSStore.flat();}
+
+    // maintain index file of the store file (storeFilename + ".idx")
+    // the index is written on the next sync() or immediately if the
+    // store is unchanged, unsetting removes the index file
+    // an existing index file sets this when the store is opened
+    void setIndexed(bool indexed) throw(GsmException);
+    bool indexed() const {return _indexed;}
+
+    // return index of the store file, null if not indexed or not valid
+    SMSStoreIndexRef index() const {return _index;}
     
     // destructor
     // writes back change to file if store is in file
@@ -88,5 +88,24 @@ char *alloca ();
 #error "no suitable 4 byte unsigned int available"
 #endif
 #endif
+#ifdef _MSC_VER
+  typedef unsigned __int64 unsigned_int_8;
+#else
+  typedef unsigned long long unsigned_int_8;
+#endif
+
+// selection of CPU specific code paths at runtime (x86 only)
+// GSM_TARGET(isa) compiles a single function for the given instruction
+// set, GSM_CPU_SUPPORTS(feature) checks whether the CPU can execute it
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || \
+     (defined(__GNUC__) && (__GNUC__ > 4 || \
+                            (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define GSM_CPU_DISPATCH 1
+#define GSM_TARGET(isa) __attribute__((target(isa)))
+#define GSM_CPU_SUPPORTS(feature) \
+  (__builtin_cpu_init(), __builtin_cpu_supports(feature))
+#define GSM_CPU_IS(vendor) (__builtin_cpu_init(), __builtin_cpu_is(vendor))
+#endif
 
 #endif // GSM_SYSDEP_H
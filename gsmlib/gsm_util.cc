@@ -42,6 +42,16 @@
 #include <cstdlib>
 #include <stdio.h>
 #include <sys/stat.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#if defined(HAVE_MMAP) && ! defined(WIN32)
+#include <sys/mman.h>
+#endif
+#include <fstream>
+#include <iterator>
+#ifdef GSM_CPU_DISPATCH
+#include <immintrin.h>
+#endif
 
 using namespace gsmlib;
 
@@ -53,7 +63,7 @@ const int GSM_NOP = 16;
 
 // conversion tables, Latin1 to GSM and GSM to Latin1
 
-static unsigned char gsmToLatin1Table[] =
+static const unsigned char gsmToLatin1Table[128] =
 {
   //  0 '@', '', '$', '', '', '', '', '', 
         '@', 163, '$', 165, 232, 233, 249, 236,
@@ -89,76 +99,506 @@ static unsigned char gsmToLatin1Table[] =
          'x', 'y', 'z', 228, 246, 241, 252, 224
 };
 
-static unsigned char latin1ToGsmTable[256];
+// GSM escape to the extension table
+const unsigned char GSM_ESCAPE = 27;
+
+// flag in latin1ToGsmTable for characters from the extension table
+const unsigned char GSM_EXTENSION = 128;
+
+// reverse of gsmToLatin1Table, GSM_NOP for characters without
+// counterpart, extension table characters (form feed, '^', '{', '}',
+// '\\', '[', '~', ']', '|') are flagged with GSM_EXTENSION
+static const unsigned char latin1ToGsmTable[256] =
+{
+   16,  16,  16,  16,  16,  16,  16,  16,
+   16,  16,  10,  16, 138,  13,  16,  16,
+   16,  16,  16,  16,  16,  16,  16,  16,
+   16,  16,  16,  16,  16,  16,  16,  16,
+   32,  33,  34,  35,   2,  37,  38,  39,
+   40,  41,  42,  43,  44,  45,  46,  47,
+   48,  49,  50,  51,  52,  53,  54,  55,
+   56,  57,  58,  59,  60,  61,  62,  63,
+    0,  65,  66,  67,  68,  69,  70,  71,
+   72,  73,  74,  75,  76,  77,  78,  79,
+   80,  81,  82,  83,  84,  85,  86,  87,
+   88,  89,  90, 188, 175, 190, 148,  17,
+   16,  97,  98,  99, 100, 101, 102, 103,
+  104, 105, 106, 107, 108, 109, 110, 111,
+  112, 113, 114, 115, 116, 117, 118, 119,
+  120, 121, 122, 168, 192, 169, 189,  16,
+   16,  16,  16,  16,  16,  16,  16,  16,
+   16,  16,  16,  16,  16,  16,  16,  16,
+   16,  16,  16,  16,  16,  16,  16,  16,
+   16,  16,  16,  16,  16,  16,  16,  16,
+   16,  64,  16,   1,  36,   3,  16,  95,
+   16,  16,  16,  16,  16,  16,  16,  16,
+   16,  16,  16,  16,  16,  16,  16,  16,
+   16,  16,  16,  16,  16,  16,  16,  96,
+   16,  16,  16,  16,  91,  14,  28,   9,
+   16,  31,  16,  16,  16,  16,  16,  16,
+   16,  93,  16,  16,  16,  16,  92,  16,
+   11,  16,  16,  16,  94,  16,  16,  30,
+  127,  16,  16,  16, 123,  15,  29,  16,
+    4,   5,  16,  16,   7,  16,  16,  16,
+   16, 125,   8,  16,  16,  16, 124,  16,
+   12,   6,  16,  16, 126,  16,  16,  16
+};
+
+// Latin-1 characters of the extension table, 0 = none
+static const unsigned char gsmExtensionToLatin1Table[128] =
+{
+    0,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,  12,   0,   0,   0,   0,   0,
+    0,   0,   0,   0,  94,   0,   0,   0,
+    0,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,   0,   0,   0,   0,   0,   0,
+  123, 125,   0,   0,   0,   0,   0,  92,
+    0,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,   0,   0,  91, 126,  93,   0,
+  124,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,   0,   0,   0,   0,   0,   0
+};
+
+// convert GSM characters s[i] while i < end, an escape at end - 1 also
+// consumes the following character
+static inline void gsmToLatin1Scalar(const unsigned char *s,
+                                     unsigned long length,
+                                     unsigned long &i, unsigned long end,
+                                     unsigned char *result, unsigned long &j)
+{
+  for (; i < end; ++i)
+  {
+    unsigned char c = s[i];
+    if (c == GSM_ESCAPE && i + 1 < length)
+    {
+      // characters missing in the extension table are displayed
+      // as the corresponding character of the default table
+      c = s[++i];
+      if (c < 128 && gsmExtensionToLatin1Table[c] != 0)
+      {
+        result[j++] = gsmExtensionToLatin1Table[c];
+        continue;
+      }
+    }
+    result[j++] = c > 127 ? NOP : gsmToLatin1Table[c];
+  }
+}
+
+static inline void latin1ToGsmScalar(const unsigned char *s,
+                                     unsigned long length,
+                                     unsigned char *result, unsigned long &j)
+{
+  for (unsigned long i = 0; i < length; ++i)
+  {
+    unsigned char c = latin1ToGsmTable[s[i]];
+    if (c & GSM_EXTENSION)
+      result[j++] = GSM_ESCAPE;
+    result[j++] = c & ~GSM_EXTENSION;
+  }
+}
+
+static unsigned long gsmToLatin1Buffer(const unsigned char *s,
+                                       unsigned long length,
+                                       unsigned char *result)
+{
+  unsigned long i = 0, j = 0;
+  gsmToLatin1Scalar(s, length, i, length, result, j);
+  return j;
+}
+
+static unsigned long latin1ToGsmBuffer(const unsigned char *s,
+                                       unsigned long length,
+                                       unsigned char *result)
+{
+  unsigned long j = 0;
+  latin1ToGsmScalar(s, length, result, j);
+  return j;
+}
+
+#ifdef GSM_CPU_DISPATCH
+
+// look up 16 octets in a table of 16 * parts octets (octets must be
+// smaller than the table), one shuffle per 16 table entries
+template <int parts>
+GSM_TARGET("ssse3")
+static inline __m128i lookupSSSE3(const unsigned char *table, __m128i v)
+{
+  __m128i low = _mm_and_si128(v, _mm_set1_epi8(0x0f));
+  __m128i high = _mm_srli_epi16(_mm_andnot_si128(_mm_set1_epi8(0x0f), v), 4);
+  __m128i result = _mm_setzero_si128();
+  for (int i = 0; i < parts; ++i)
+  {
+    __m128i entries = _mm_loadu_si128((const __m128i*)(table + 16 * i));
+    __m128i select = _mm_cmpeq_epi8(high, _mm_set1_epi8(i));
+    result = _mm_or_si128(result,
+                          _mm_and_si128(select,
+                                        _mm_shuffle_epi8(entries, low)));
+  }
+  return result;
+}
+
+// blocks of 16 characters without escapes and invalid characters are
+// converted with table lookups, the others character by character
+GSM_TARGET("ssse3")
+static unsigned long gsmToLatin1SSSE3(const unsigned char *s,
+                                      unsigned long length,
+                                      unsigned char *result)
+{
+  unsigned long i = 0, j = 0;
+  while (length - i >= 16)
+  {
+    __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+    __m128i special = _mm_or_si128(
+      v, _mm_cmpeq_epi8(v, _mm_set1_epi8(GSM_ESCAPE)));
+    if (_mm_movemask_epi8(special) != 0)
+    {
+      gsmToLatin1Scalar(s, length, i, i + 16, result, j);
+      continue;
+    }
+    _mm_storeu_si128((__m128i*)(result + j),
+                     lookupSSSE3<8>(gsmToLatin1Table, v));
+    i += 16;
+    j += 16;
+  }
+  gsmToLatin1Scalar(s, length, i, length, result, j);
+  return j;
+}
 
-static class Latin1ToGsmTableInit
+// blocks of 16 characters without extension table characters are
+// converted with table lookups (in the first half of the table only
+// for ASCII text)
+GSM_TARGET("ssse3")
+static unsigned long latin1ToGsmSSSE3(const unsigned char *s,
+                                      unsigned long length,
+                                      unsigned char *result)
 {
-public:
-  Latin1ToGsmTableInit()
+  unsigned long j = 0;
+  for (; length >= 16; length -= 16, s += 16)
   {
-    memset((void*)latin1ToGsmTable, GSM_NOP, 256);
-    for (int i = 0; i < 128; i++)
-      if (gsmToLatin1Table[i] != NOP)
-        latin1ToGsmTable[gsmToLatin1Table[i]] = i;
+    __m128i v = _mm_loadu_si128((const __m128i*)s);
+    __m128i gsm = _mm_movemask_epi8(v) == 0 ?
+      lookupSSSE3<8>(latin1ToGsmTable, v) :
+      lookupSSSE3<16>(latin1ToGsmTable, v);
+    if (_mm_movemask_epi8(gsm) != 0)
+      latin1ToGsmScalar(s, 16, result, j);
+    else
+    {
+      _mm_storeu_si128((__m128i*)(result + j), gsm);
+      j += 16;
+    }
   }
-} latin1ToGsmTableInit;
+  latin1ToGsmScalar(s, length, result, j);
+  return j;
+}
+#endif // GSM_CPU_DISPATCH
+
+typedef unsigned long (*CharsetFunction)(const unsigned char*, unsigned long,
+                                         unsigned char*);
+
+static CharsetFunction selectGsmToLatin1()
+{
+#ifdef GSM_CPU_DISPATCH
+  if (GSM_CPU_SUPPORTS("ssse3"))
+    return gsmToLatin1SSSE3;
+#endif
+  return gsmToLatin1Buffer;
+}
+
+static CharsetFunction selectLatin1ToGsm()
+{
+#ifdef GSM_CPU_DISPATCH
+  if (GSM_CPU_SUPPORTS("ssse3"))
+    return latin1ToGsmSSSE3;
+#endif
+  return latin1ToGsmBuffer;
+}
+
+unsigned long gsmlib::gsmToLatin1(const char *s, unsigned long length,
+                                  char *result)
+{
+  static const CharsetFunction convert = selectGsmToLatin1();
+  return convert((const unsigned char*)s, length, (unsigned char*)result);
+}
+
+unsigned long gsmlib::latin1ToGsm(const char *s, unsigned long length,
+                                  char *result)
+{
+  static const CharsetFunction convert = selectLatin1ToGsm();
+  return convert((const unsigned char*)s, length, (unsigned char*)result);
+}
 
 std::string gsmlib::gsmToLatin1(std::string s)
 {
-  std::string result(s.length(), 0);
-  for (std::string::size_type i = 0; i < s.length(); i++)
-    result[i] = (unsigned char)s[i] > 127 ? NOP : gsmToLatin1Table[static_cast<unsigned int>(s[i])];
+  std::string result(s.length(), '\0');
+  if (s.length() > 0)
+    result.resize(gsmToLatin1(s.data(), s.length(), &result[0]));
   return result;
 }
 
 std::string gsmlib::latin1ToGsm(std::string s)
 {
-  std::string result(s.length(), 0);
-  for (std::string::size_type i = 0; i < s.length(); i++)
-    result[i] = latin1ToGsmTable[(unsigned char)s[i]];
+  std::string result(2 * s.length(), '\0');
+  if (s.length() > 0)
+    result.resize(latin1ToGsm(s.data(), s.length(), &result[0]));
   return result;
 }
 
-static unsigned char byteToHex[] =
+// hexadecimal conversion tables and functions
+// the scalar versions are table-driven, on x86 SSE2 and AVX2 versions
+// are selected at runtime for longer strings
+
+// hexadecimal representation of all octets, two characters each
+static const char octetToHex[] =
+  "000102030405060708090A0B0C0D0E0F101112131415161718191A1B1C1D1E1F"
+  "202122232425262728292A2B2C2D2E2F303132333435363738393A3B3C3D3E3F"
+  "404142434445464748494A4B4C4D4E4F505152535455565758595A5B5C5D5E5F"
+  "606162636465666768696A6B6C6D6E6F707172737475767778797A7B7C7D7E7F"
+  "808182838485868788898A8B8C8D8E8F909192939495969798999A9B9C9D9E9F"
+  "A0A1A2A3A4A5A6A7A8A9AAABACADAEAFB0B1B2B3B4B5B6B7B8B9BABBBCBDBEBF"
+  "C0C1C2C3C4C5C6C7C8C9CACBCCCDCECFD0D1D2D3D4D5D6D7D8D9DADBDCDDDEDF"
+  "E0E1E2E3E4E5E6E7E8E9EAEBECEDEEEFF0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF";
+
+// value of hexadecimal digits, 0xff for all other characters
+static const unsigned char hexToNibble[256] =
 {
-  '0', '1', '2', '3', '4', '5', '6', '7', '8', '9',
-  'A', 'B', 'C', 'D', 'E', 'F'
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+     0,    1,    2,    3,    4,    5,    6,    7,
+     8,    9, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff,   10,   11,   12,   13,   14,   15, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff,   10,   11,   12,   13,   14,   15, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff
 };
 
-std::string gsmlib::bufToHex(const unsigned char *buf, unsigned long length)
+static void bufToHexScalar(const unsigned char *buf, unsigned long length,
+                           char *hex)
 {
-  const unsigned char *bb = buf;
-  std::string result;
-  result.reserve(length * 2);
+  for (unsigned long i = 0; i < length; ++i, hex += 2)
+  {
+    const char *h = octetToHex + 2 * buf[i];
+    hex[0] = h[0];
+    hex[1] = h[1];
+  }
+}
 
-  for (unsigned long i = 0; i < length; ++i)
+static bool hexToBufScalar(const char *hex, unsigned long length,
+                           unsigned char *buf)
+{
+  unsigned char invalid = 0;
+  for (unsigned long i = 0; i < length; i += 2)
   {
-    result += byteToHex[*bb >> 4];
-    result += byteToHex[*bb++ & 0xf];
+    unsigned char high = hexToNibble[(unsigned char)hex[i]];
+    unsigned char low = hexToNibble[(unsigned char)hex[i + 1]];
+    invalid |= high | low;
+    *buf++ = (high << 4) | (low & 0xf);
   }
-  return result;
+  return (invalid & 0xf0) == 0;
 }
 
-bool gsmlib::hexToBuf(const std::string &hexString, unsigned char *buf)
+#ifdef GSM_CPU_DISPATCH
+
+// convert 16 nibbles in v to hexadecimal characters
+GSM_TARGET("sse2")
+static inline __m128i nibblesToHexSSE2(__m128i v)
 {
-  if (hexString.length() % 2 != 0)
-    return false;
+  __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(9)),
+                                  _mm_set1_epi8('A' - '0' - 10));
+  return _mm_add_epi8(_mm_add_epi8(v, _mm_set1_epi8('0')), letters);
+}
+
+GSM_TARGET("sse2")
+static void bufToHexSSE2(const unsigned char *buf, unsigned long length,
+                         char *hex)
+{
+  const __m128i lowNibbles = _mm_set1_epi8(0x0f);
+  for (; length >= 16; length -= 16, buf += 16, hex += 32)
+  {
+    __m128i v = _mm_loadu_si128((const __m128i*)buf);
+    __m128i high =
+      nibblesToHexSSE2(_mm_and_si128(_mm_srli_epi16(v, 4), lowNibbles));
+    __m128i low = nibblesToHexSSE2(_mm_and_si128(v, lowNibbles));
+    _mm_storeu_si128((__m128i*)hex, _mm_unpacklo_epi8(high, low));
+    _mm_storeu_si128((__m128i*)(hex + 16), _mm_unpackhi_epi8(high, low));
+  }
+  bufToHexScalar(buf, length, hex);
+}
 
-  unsigned char *bb = buf;
-  for (unsigned int i = 0; i < hexString.length(); i += 2)
+GSM_TARGET("sse2")
+static bool hexToBufSSE2(const char *hex, unsigned long length,
+                         unsigned char *buf)
+{
+  for (; length >= 16; length -= 16, hex += 16, buf += 8)
   {
-    unsigned char c = hexString[i];
-    if (! isdigit(c) && ! ('a' <= c && c <= 'f') && ! ('A' <= c && c <= 'F'))
+    __m128i v = _mm_loadu_si128((const __m128i*)hex);
+    // '0'..'9'
+    __m128i digits = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+                                   _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+    // 'a'..'f' or 'A'..'F'
+    __m128i l = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(l, _mm_set1_epi8('a' - 1)),
+                                    _mm_cmplt_epi8(l, _mm_set1_epi8('f' + 1)));
+    if (_mm_movemask_epi8(_mm_or_si128(digits, letters)) != 0xffff)
       return false;
-    *bb = (isdigit(c) ? c - '0' :
-           ((('a' <= c && c <= 'f') ? c - 'a' : c - 'A')) + 10) << 4;
-    c = hexString[i + 1];
-    if (! isdigit(c) && ! ('a' <= c && c <= 'f') && ! ('A' <= c && c <= 'F'))
+    __m128i digitValues = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+    __m128i letterValues = _mm_sub_epi8(l, _mm_set1_epi8('a' - 10));
+    __m128i nibbles = _mm_or_si128(_mm_and_si128(digits, digitValues),
+                                   _mm_and_si128(letters, letterValues));
+    // combine high (even) and low (odd) nibbles in each 16-bit lane
+    __m128i highNibbles = _mm_and_si128(nibbles, _mm_set1_epi16(0x00ff));
+    __m128i octets = _mm_or_si128(_mm_slli_epi16(highNibbles, 4),
+                                  _mm_srli_epi16(nibbles, 8));
+    _mm_storel_epi64((__m128i*)buf, _mm_packus_epi16(octets, octets));
+  }
+  return hexToBufScalar(hex, length, buf);
+}
+
+GSM_TARGET("avx2")
+static inline __m256i nibblesToHexAVX2(__m256i v)
+{
+  __m256i letters = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(9)),
+                                     _mm256_set1_epi8('A' - '0' - 10));
+  return _mm256_add_epi8(_mm256_add_epi8(v, _mm256_set1_epi8('0')), letters);
+}
+
+GSM_TARGET("avx2")
+static void bufToHexAVX2(const unsigned char *buf, unsigned long length,
+                         char *hex)
+{
+  const __m256i lowNibbles = _mm256_set1_epi8(0x0f);
+  for (; length >= 32; length -= 32, buf += 32, hex += 64)
+  {
+    __m256i v = _mm256_loadu_si256((const __m256i*)buf);
+    __m256i high = nibblesToHexAVX2(_mm256_and_si256(_mm256_srli_epi16(v, 4),
+                                                     lowNibbles));
+    __m256i low = nibblesToHexAVX2(_mm256_and_si256(v, lowNibbles));
+    // unpacking works per 128-bit lane, put the halves back in order
+    __m256i first = _mm256_unpacklo_epi8(high, low);
+    __m256i second = _mm256_unpackhi_epi8(high, low);
+    _mm256_storeu_si256((__m256i*)hex,
+                        _mm256_permute2x128_si256(first, second, 0x20));
+    _mm256_storeu_si256((__m256i*)(hex + 32),
+                        _mm256_permute2x128_si256(first, second, 0x31));
+  }
+  bufToHexSSE2(buf, length, hex);
+}
+
+GSM_TARGET("avx2")
+static bool hexToBufAVX2(const char *hex, unsigned long length,
+                         unsigned char *buf)
+{
+  for (; length >= 32; length -= 32, hex += 32, buf += 16)
+  {
+    __m256i v = _mm256_loadu_si256((const __m256i*)hex);
+    __m256i digits =
+      _mm256_andnot_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('9')),
+                          _mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)));
+    __m256i l = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    __m256i letters =
+      _mm256_andnot_si256(_mm256_cmpgt_epi8(l, _mm256_set1_epi8('f')),
+                          _mm256_cmpgt_epi8(l, _mm256_set1_epi8('a' - 1)));
+    if (_mm256_movemask_epi8(_mm256_or_si256(digits, letters)) != -1)
       return false;
-    *bb++ |= isdigit(c) ? c - '0' :
-      ((('a' <= c && c <= 'f') ? c - 'a' : c - 'A') + 10);
+    __m256i digitValues = _mm256_sub_epi8(v, _mm256_set1_epi8('0'));
+    __m256i letterValues = _mm256_sub_epi8(l, _mm256_set1_epi8('a' - 10));
+    __m256i nibbles =
+      _mm256_or_si256(_mm256_and_si256(digits, digitValues),
+                      _mm256_and_si256(letters, letterValues));
+    __m256i highNibbles =
+      _mm256_and_si256(nibbles, _mm256_set1_epi16(0x00ff));
+    __m256i octets = _mm256_or_si256(_mm256_slli_epi16(highNibbles, 4),
+                                     _mm256_srli_epi16(nibbles, 8));
+    // packing works per 128-bit lane, gather the two low quadwords
+    __m256i packed =
+      _mm256_permute4x64_epi64(_mm256_packus_epi16(octets, octets), 0x08);
+    _mm_storeu_si128((__m128i*)buf, _mm256_castsi256_si128(packed));
   }
-  return true;
+  return hexToBufSSE2(hex, length, buf);
+}
+#endif // GSM_CPU_DISPATCH
+
+typedef void (*BufToHexFunction)(const unsigned char*, unsigned long, char*);
+typedef bool (*HexToBufFunction)(const char*, unsigned long, unsigned char*);
+
+static BufToHexFunction selectBufToHex()
+{
+#ifdef GSM_CPU_DISPATCH
+  if (GSM_CPU_SUPPORTS("avx2"))
+    return bufToHexAVX2;
+  if (GSM_CPU_SUPPORTS("sse2"))
+    return bufToHexSSE2;
+#endif
+  return bufToHexScalar;
+}
+
+static HexToBufFunction selectHexToBuf()
+{
+#ifdef GSM_CPU_DISPATCH
+  if (GSM_CPU_SUPPORTS("avx2"))
+    return hexToBufAVX2;
+  if (GSM_CPU_SUPPORTS("sse2"))
+    return hexToBufSSE2;
+#endif
+  return hexToBufScalar;
+}
+
+void gsmlib::bufToHex(const unsigned char *buf, unsigned long length,
+                      char *hex)
+{
+  static const BufToHexFunction convert = selectBufToHex();
+  convert(buf, length, hex);
+}
+
+std::string gsmlib::bufToHex(const unsigned char *buf, unsigned long length)
+{
+  std::string result(length * 2, '0');
+  if (length > 0)
+    bufToHex(buf, length, &result[0]);
+  return result;
+}
+
+bool gsmlib::hexToBuf(const char *hex, unsigned long length,
+                      unsigned char *buf)
+{
+  static const HexToBufFunction convert = selectHexToBuf();
+  if (length % 2 != 0)
+    return false;
+  return convert(hex, length, buf);
+}
+
+bool gsmlib::hexToBuf(const std::string &hexString, unsigned char *buf)
+{
+  return hexToBuf(hexString.data(), hexString.length(), buf);
 }
 
 std::string gsmlib::intToStr(int i)
@@ -255,6 +695,183 @@ void gsmlib::renameToBackupFile(std::string filename) throw(GsmException)
       OSError, errno);
 }
 
+void gsmlib::replaceFile(std::string tempFilename, std::string filename)
+  throw(GsmException)
+{
+#ifdef WIN32
+  // rename() does not replace existing files under Win32
+  _unlink(filename.c_str());
+#endif
+  if (rename(tempFilename.c_str(), filename.c_str()) < 0)
+    throw GsmException(
+      stringPrintf(_("error renaming '%s' to '%s'"),
+                   tempFilename.c_str(), filename.c_str()),
+      OSError, errno);
+#ifndef WIN32
+  // flush the directory entry to the disk, not all file systems
+  // support this
+  std::string::size_type slash = filename.rfind('/');
+  std::string directory =
+    slash == std::string::npos ? "." : filename.substr(0, slash + 1);
+  int fd = open(directory.c_str(), O_RDONLY);
+  if (fd >= 0)
+  {
+    fsync(fd);
+    close(fd);
+  }
+#endif
+}
+
+void gsmlib::writeFileSynced(std::string filename, const char *buf,
+                             unsigned long length, bool truncate,
+                             unsigned long offset) throw(GsmException)
+{
+#ifdef WIN32
+  int fd = _open(filename.c_str(),
+                 _O_WRONLY | _O_BINARY | (truncate ? _O_CREAT | _O_TRUNC : 0),
+                 _S_IREAD | _S_IWRITE);
+#else
+  int fd = open(filename.c_str(),
+                O_WRONLY | (truncate ? O_CREAT | O_TRUNC : 0), 0666);
+#endif
+  if (fd < 0)
+    throw GsmException(
+      stringPrintf(_("error opening file '%s' for writing"),
+                   filename.c_str()), OSError, errno);
+
+  int error = 0;
+  if (lseek(fd, offset, SEEK_SET) < 0)
+    error = errno;
+  while (error == 0 && length > 0)
+  {
+    int written = write(fd, buf, length);
+    if (written < 0)
+    {
+      if (errno != EINTR)
+        error = errno;
+    }
+    else
+    {
+      buf += written;
+      length -= written;
+    }
+  }
+#ifdef WIN32
+  if (error == 0 && _commit(fd) != 0)
+#else
+  if (error == 0 && fsync(fd) != 0)
+#endif
+    error = errno;
+  if (close(fd) != 0 && error == 0)
+    error = errno;
+  if (error != 0)
+    throw GsmException(stringPrintf(_("error writing to file '%s'"),
+                                    filename.c_str()), OSError, error);
+}
+
+// CRC-32 table for the reflected polynomial 0xedb88320
+static const unsigned_int_4 crc32Table[256] =
+  {
+    0x00000000, 0x77073096, 0xee0e612c, 0x990951ba,
+    0x076dc419, 0x706af48f, 0xe963a535, 0x9e6495a3,
+    0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988,
+    0x09b64c2b, 0x7eb17cbd, 0xe7b82d07, 0x90bf1d91,
+    0x1db71064, 0x6ab020f2, 0xf3b97148, 0x84be41de,
+    0x1adad47d, 0x6ddde4eb, 0xf4d4b551, 0x83d385c7,
+    0x136c9856, 0x646ba8c0, 0xfd62f97a, 0x8a65c9ec,
+    0x14015c4f, 0x63066cd9, 0xfa0f3d63, 0x8d080df5,
+    0x3b6e20c8, 0x4c69105e, 0xd56041e4, 0xa2677172,
+    0x3c03e4d1, 0x4b04d447, 0xd20d85fd, 0xa50ab56b,
+    0x35b5a8fa, 0x42b2986c, 0xdbbbc9d6, 0xacbcf940,
+    0x32d86ce3, 0x45df5c75, 0xdcd60dcf, 0xabd13d59,
+    0x26d930ac, 0x51de003a, 0xc8d75180, 0xbfd06116,
+    0x21b4f4b5, 0x56b3c423, 0xcfba9599, 0xb8bda50f,
+    0x2802b89e, 0x5f058808, 0xc60cd9b2, 0xb10be924,
+    0x2f6f7c87, 0x58684c11, 0xc1611dab, 0xb6662d3d,
+    0x76dc4190, 0x01db7106, 0x98d220bc, 0xefd5102a,
+    0x71b18589, 0x06b6b51f, 0x9fbfe4a5, 0xe8b8d433,
+    0x7807c9a2, 0x0f00f934, 0x9609a88e, 0xe10e9818,
+    0x7f6a0dbb, 0x086d3d2d, 0x91646c97, 0xe6635c01,
+    0x6b6b51f4, 0x1c6c6162, 0x856530d8, 0xf262004e,
+    0x6c0695ed, 0x1b01a57b, 0x8208f4c1, 0xf50fc457,
+    0x65b0d9c6, 0x12b7e950, 0x8bbeb8ea, 0xfcb9887c,
+    0x62dd1ddf, 0x15da2d49, 0x8cd37cf3, 0xfbd44c65,
+    0x4db26158, 0x3ab551ce, 0xa3bc0074, 0xd4bb30e2,
+    0x4adfa541, 0x3dd895d7, 0xa4d1c46d, 0xd3d6f4fb,
+    0x4369e96a, 0x346ed9fc, 0xad678846, 0xda60b8d0,
+    0x44042d73, 0x33031de5, 0xaa0a4c5f, 0xdd0d7cc9,
+    0x5005713c, 0x270241aa, 0xbe0b1010, 0xc90c2086,
+    0x5768b525, 0x206f85b3, 0xb966d409, 0xce61e49f,
+    0x5edef90e, 0x29d9c998, 0xb0d09822, 0xc7d7a8b4,
+    0x59b33d17, 0x2eb40d81, 0xb7bd5c3b, 0xc0ba6cad,
+    0xedb88320, 0x9abfb3b6, 0x03b6e20c, 0x74b1d29a,
+    0xead54739, 0x9dd277af, 0x04db2615, 0x73dc1683,
+    0xe3630b12, 0x94643b84, 0x0d6d6a3e, 0x7a6a5aa8,
+    0xe40ecf0b, 0x9309ff9d, 0x0a00ae27, 0x7d079eb1,
+    0xf00f9344, 0x8708a3d2, 0x1e01f268, 0x6906c2fe,
+    0xf762575d, 0x806567cb, 0x196c3671, 0x6e6b06e7,
+    0xfed41b76, 0x89d32be0, 0x10da7a5a, 0x67dd4acc,
+    0xf9b9df6f, 0x8ebeeff9, 0x17b7be43, 0x60b08ed5,
+    0xd6d6a3e8, 0xa1d1937e, 0x38d8c2c4, 0x4fdff252,
+    0xd1bb67f1, 0xa6bc5767, 0x3fb506dd, 0x48b2364b,
+    0xd80d2bda, 0xaf0a1b4c, 0x36034af6, 0x41047a60,
+    0xdf60efc3, 0xa867df55, 0x316e8eef, 0x4669be79,
+    0xcb61b38c, 0xbc66831a, 0x256fd2a0, 0x5268e236,
+    0xcc0c7795, 0xbb0b4703, 0x220216b9, 0x5505262f,
+    0xc5ba3bbe, 0xb2bd0b28, 0x2bb45a92, 0x5cb36a04,
+    0xc2d7ffa7, 0xb5d0cf31, 0x2cd99e8b, 0x5bdeae1d,
+    0x9b64c2b0, 0xec63f226, 0x756aa39c, 0x026d930a,
+    0x9c0906a9, 0xeb0e363f, 0x72076785, 0x05005713,
+    0x95bf4a82, 0xe2b87a14, 0x7bb12bae, 0x0cb61b38,
+    0x92d28e9b, 0xe5d5be0d, 0x7cdcefb7, 0x0bdbdf21,
+    0x86d3d2d4, 0xf1d4e242, 0x68ddb3f8, 0x1fda836e,
+    0x81be16cd, 0xf6b9265b, 0x6fb077e1, 0x18b74777,
+    0x88085ae6, 0xff0f6a70, 0x66063bca, 0x11010b5c,
+    0x8f659eff, 0xf862ae69, 0x616bffd3, 0x166ccf45,
+    0xa00ae278, 0xd70dd2ee, 0x4e048354, 0x3903b3c2,
+    0xa7672661, 0xd06016f7, 0x4969474d, 0x3e6e77db,
+    0xaed16a4a, 0xd9d65adc, 0x40df0b66, 0x37d83bf0,
+    0xa9bcae53, 0xdebb9ec5, 0x47b2cf7f, 0x30b5ffe9,
+    0xbdbdf21c, 0xcabac28a, 0x53b39330, 0x24b4a3a6,
+    0xbad03605, 0xcdd70693, 0x54de5729, 0x23d967bf,
+    0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94,
+    0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
+  };
+
+// tables for processing 8 bytes at once (slicing-by-8), table k gives
+// the CRC of a byte followed by k zero bytes
+typedef unsigned_int_4 Crc32Tables[8][256];
+
+static const Crc32Tables *makeCrc32Tables()
+{
+  static Crc32Tables tables;
+  for (int i = 0; i < 256; ++i)
+  {
+    unsigned_int_4 c = crc32Table[i];
+    tables[0][i] = c;
+    for (int k = 1; k < 8; ++k)
+      tables[k][i] = c = crc32Table[c & 0xff] ^ (c >> 8);
+  }
+  return &tables;
+}
+
+unsigned long gsmlib::crc32(const void *buf, unsigned long length,
+                            unsigned long crc)
+{
+  static const Crc32Tables &t = *makeCrc32Tables();
+  const unsigned char *p = (const unsigned char*)buf;
+  unsigned_int_4 c = ~(unsigned_int_4)crc;
+  for (; length >= 8; length -= 8, p += 8)
+  {
+    c ^= p[0] | p[1] << 8 | p[2] << 16 | (unsigned_int_4)p[3] << 24;
+    c = t[7][c & 0xff] ^ t[6][(c >> 8) & 0xff] ^ t[5][(c >> 16) & 0xff] ^
+      t[4][c >> 24] ^ t[3][p[4]] ^ t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]];
+  }
+  while (length-- > 0)
+    c = crc32Table[(c ^ *p++) & 0xff] ^ (c >> 8);
+  return ~c & 0xffffffff;
+}
+
 // NoCopy members
 
 #ifndef NDEBUG
@@ -274,6 +891,77 @@ gsmlib::NoCopy &gsmlib::NoCopy::operator=(NoCopy &n)
 
 #endif // NDEBUG
 
+// MappedFile members
+
+// aux function read complete stream with error handling
+static void readStream(std::istream &is, std::string filename,
+                       std::string &contents) throw(GsmException)
+{
+  contents.assign(std::istreambuf_iterator<char>(is),
+                  std::istreambuf_iterator<char>());
+  if (is.bad())
+    throw GsmException(stringPrintf(_("error reading from file '%s'"),
+                                    filename.c_str()), OSError);
+}
+
+MappedFile::MappedFile(std::string filename, bool mustExist)
+  throw(GsmException) : _mapped(NULL), _data(NULL), _length(0)
+{
+#if defined(HAVE_MMAP) && ! defined(WIN32)
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    if (! mustExist && errno == ENOENT)
+      return;
+    throw GsmException(stringPrintf(_("cannot open file '%s'"),
+                                    filename.c_str()), OSError, errno);
+  }
+  struct stat statBuf;
+  if (fstat(fd, &statBuf) == 0 && statBuf.st_size > 0)
+  {
+    void *mapped = mmap(NULL, statBuf.st_size, PROT_READ, MAP_PRIVATE,
+                        fd, 0);
+    if (mapped != MAP_FAILED)
+    {
+      _mapped = (char*)mapped;
+      _data = _mapped;
+      _length = statBuf.st_size;
+    }
+  }
+  close(fd);
+  if (_mapped != NULL)
+    return;
+#endif
+
+  std::ifstream is(filename.c_str(), std::ios::in | std::ios::binary);
+  if (! is)
+  {
+    if (! mustExist)
+      return;
+    throw GsmException(stringPrintf(_("cannot open file '%s'"),
+                                    filename.c_str()), OSError);
+  }
+  readStream(is, filename, _contents);
+  _data = _contents.data();
+  _length = _contents.length();
+}
+
+MappedFile::MappedFile(std::istream &is, std::string filename)
+  throw(GsmException) : _mapped(NULL)
+{
+  readStream(is, filename, _contents);
+  _data = _contents.data();
+  _length = _contents.length();
+}
+
+MappedFile::~MappedFile()
+{
+#if defined(HAVE_MMAP) && ! defined(WIN32)
+  if (_mapped != NULL)
+    munmap(_mapped, _length);
+#endif
+}
+
 std::string gsmlib::lowercase(std::string s)
 {
   std::string result;
@@ -39,19 +39,39 @@ namespace gsmlib
   // convert gsm to Latin-1
   // characters that have no counterpart in Latin-1 are converted to
   // code 172 (Latin-1 boolean not, "")
+  // escape sequences for the extension table are converted to one
+  // character (see gsm_alphabet.h for the complete GSM alphabet)
   std::string gsmToLatin1(std::string s);
 
   // convert Latin-1 to gsm
   // characters that have no counterpart in GSM are converted to
   // code 16 (GSM Delta)
+  // characters of the extension table ('[', '{', etc.) are converted
+  // to two septets (escape and code), so the result may be longer
   std::string latin1ToGsm(std::string s);
 
+  // same as above, but convert length characters at s and write the
+  // result to result (room for length characters for gsmToLatin1(),
+  // 2 * length characters for latin1ToGsm()), return its length
+  unsigned long gsmToLatin1(const char *s, unsigned long length,
+                            char *result);
+  unsigned long latin1ToGsm(const char *s, unsigned long length,
+                            char *result);
+
   // convert byte buffer of length to hexadecimal string
   std::string bufToHex(const unsigned char *buf, unsigned long length);
 
+  // same as above, but write the 2 * length characters (without
+  // trailing zero) to hex
+  void bufToHex(const unsigned char *buf, unsigned long length, char *hex);
+
   // convert hexString to byte buffer, return false if no hexString
   bool hexToBuf(const std::string &hexString, unsigned char *buf);
 
+  // same as above, but convert length characters at hex
+  // to length / 2 bytes
+  bool hexToBuf(const char *hex, unsigned long length, unsigned char *buf);
+
   // indicate that a value is not set
   const int NOT_SET = -1;
 
@@ -140,6 +160,22 @@ namespace gsmlib
   // make backup file adequate for this operating system
   void renameToBackupFile(std::string filename) throw(GsmException);
 
+  // rename tempFilename to filename, replacing filename
+  void replaceFile(std::string tempFilename, std::string filename)
+    throw(GsmException);
+
+  // write length bytes at buf to filename at offset and flush them to
+  // the disk before returning; if truncate is true the file is created
+  // or truncated first, otherwise it must exist
+  void writeFileSynced(std::string filename, const char *buf,
+                       unsigned long length, bool truncate = true,
+                       unsigned long offset = 0) throw(GsmException);
+
+  // return CRC-32 (as used by zlib and Ethernet) of length bytes at buf,
+  // crc is the result for the preceding bytes when computing it piecewise
+  unsigned long crc32(const void *buf, unsigned long length,
+                      unsigned long crc = 0);
+
   // Base class for class for which copying is not allow
   // only used for debugging
 
@@ -155,6 +191,31 @@ namespace gsmlib
 #endif
   };
 
+  // read-only contents of a file, mapped into memory if supported by
+  // the operating system, read into memory otherwise
+
+  class MappedFile : public RefBase, public NoCopy
+  {
+  private:
+    char *_mapped;              // mapped file, NULL if not mapped
+    std::string _contents;      // contents if not mapped
+    const char *_data;
+    unsigned long _length;
+
+  public:
+    // map file, a missing file is an error if mustExist is set,
+    // otherwise it is treated as empty
+    MappedFile(std::string filename, bool mustExist = true)
+      throw(GsmException);
+    // read stream (eg. stdin) into memory, filename is used for messages
+    MappedFile(std::istream &is, std::string filename) throw(GsmException);
+
+    const char *data() const {return _data;}
+    unsigned long length() const {return _length;}
+
+    ~MappedFile();
+  };
+
   // convert std::string to lower case
   std::string lowercase(std::string s);
 
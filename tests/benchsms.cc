@@ -0,0 +1,628 @@
+// *************************************************************************
+// * GSM TA/ME library
+// *
+// * File:    benchsms.cc
+// *
+// * Purpose: Benchmark SMS PDU coding functions
+// *          (not run by "make check", invoke ./benchsms manually)
+// *
+// * Created: 18.10.2026
+// *************************************************************************
+
+#ifdef HAVE_CONFIG_H
+#include <gsm_config.h>
+#endif
+#include <gsmlib/gsm_util.h>
+#include <gsmlib/gsm_sms.h>
+#include <gsmlib/gsm_error.h>
+#include <gsmlib/gsm_sms_reassembly.h>
+#include <gsmlib/gsm_sorted_sms_store.h>
+#include <gsmlib/gsm_sorted_phonebook.h>
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <sys/time.h>
+#include <new>
+#include <vector>
+
+using namespace gsmlib;
+
+// previous implementations, kept for comparison
+
+static unsigned char legacyByteToHex[] =
+{
+  '0', '1', '2', '3', '4', '5', '6', '7', '8', '9',
+  'A', 'B', 'C', 'D', 'E', 'F'
+};
+
+static std::string legacyBufToHex(const unsigned char *buf,
+                                  unsigned long length)
+{
+  const unsigned char *bb = buf;
+  std::string result;
+  result.reserve(length * 2);
+
+  for (unsigned long i = 0; i < length; ++i)
+  {
+    result += legacyByteToHex[*bb >> 4];
+    result += legacyByteToHex[*bb++ & 0xf];
+  }
+  return result;
+}
+
+static bool legacyHexToBuf(const std::string &hexString, unsigned char *buf)
+{
+  if (hexString.length() % 2 != 0)
+    return false;
+
+  unsigned char *bb = buf;
+  for (unsigned int i = 0; i < hexString.length(); i += 2)
+  {
+    unsigned char c = hexString[i];
+    if (! isdigit(c) && ! ('a' <= c && c <= 'f') && ! ('A' <= c && c <= 'F'))
+      return false;
+    *bb = (isdigit(c) ? c - '0' :
+           ((('a' <= c && c <= 'f') ? c - 'a' : c - 'A')) + 10) << 4;
+    c = hexString[i + 1];
+    if (! isdigit(c) && ! ('a' <= c && c <= 'f') && ! ('A' <= c && c <= 'F'))
+      return false;
+    *bb++ |= isdigit(c) ? c - '0' :
+      ((('a' <= c && c <= 'f') ? c - 'a' : c - 'A') + 10);
+  }
+  return true;
+}
+
+// character-wise conversion with a table filled at startup
+static unsigned char legacyLatin1ToGsmTable[256];
+
+static std::string legacyLatin1ToGsm(const std::string &s)
+{
+  std::string result;
+  result.reserve(s.length());
+  for (std::string::size_type i = 0; i < s.length(); i++)
+    result += legacyLatin1ToGsmTable[(unsigned char)s[i]];
+  return result;
+}
+
+// count heap allocations
+
+static unsigned long allocations = 0;
+
+void *operator new(size_t size) throw(std::bad_alloc)
+{
+  ++allocations;
+  void *result = malloc(size == 0 ? 1 : size);
+  if (result == NULL)
+    throw std::bad_alloc();
+  return result;
+}
+
+// not inlined, else GCC 12 pairs the free() with the operator new of
+// the callers and warns with -Wmismatched-new-delete
+#ifdef __GNUC__
+__attribute__((noinline))
+#endif
+void operator delete(void *p) throw()
+{
+  free(p);
+}
+
+// time measurement
+
+static double now()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void report(std::string what, unsigned long n, double seconds)
+{
+  std::cout << stringPrintf("%-32s %10.1f ns/op", what.c_str(),
+                            seconds * 1e9 / n) << std::endl;
+}
+
+static void report(std::string what, unsigned long n, double seconds,
+                   unsigned long allocated)
+{
+  std::cout << stringPrintf("%-32s %10.1f ns/op %8.2f allocations/op",
+                            what.c_str(), seconds * 1e9 / n,
+                            (double)allocated / n) << std::endl;
+}
+
+// building a map of the sorted stores from unsorted values, traversing
+// it and looking up every key, for both backends
+
+template <class Map>
+static void benchMap(std::string map, std::string order,
+                     const std::vector<typename Map::value_type> &values,
+                     unsigned long rounds, unsigned long &checksum)
+{
+  for (int flat = 0; flat < 2; ++flat)
+  {
+    std::string what = order + (flat ? "/flat" : "/tree");
+    Map m;
+    double start = now();
+    for (unsigned long r = 0; r < rounds; ++r)
+    {
+      Map newMap(flat);
+      newMap.reserve(values.size());
+      for (unsigned int i = 0; i < values.size(); ++i)
+        newMap.insertBuffered(values[i]);
+      checksum += newMap.begin() != newMap.end();
+      m.swap(newMap);
+    }
+    report(map + " load " + what, rounds * values.size(), now() - start);
+
+    start = now();
+    for (unsigned long r = 0; r < rounds; ++r)
+      for (typename Map::iterator i = m.begin(); i != m.end(); ++i)
+        checksum += i->second != NULL;
+    report(map + " scan " + what, rounds * values.size(), now() - start);
+
+    start = now();
+    for (unsigned long r = 0; r < rounds; ++r)
+      for (unsigned int i = 0; i < values.size(); ++i)
+      {
+        std::pair<typename Map::iterator, typename Map::iterator> range =
+          m.equal_range(values[i].first);
+        checksum += range.first != range.second;
+      }
+    report(map + " range " + what, rounds * values.size(), now() - start);
+  }
+}
+
+// typical PDU length in octets (SCA + full 140 octet user data)
+const unsigned int PduLength = 176;
+
+int main(int argc, char *argv[])
+{
+  unsigned long iterations = argc > 1 ? atol(argv[1]) : 200000;
+  unsigned char buf[PduLength], back[PduLength];
+  unsigned long checksum = 0;
+
+  srand(1);
+  for (unsigned int i = 0; i < PduLength; ++i)
+    buf[i] = (unsigned char)rand();
+  std::string hex = bufToHex(buf, PduLength);
+  if (hex != legacyBufToHex(buf, PduLength))
+  {
+    std::cerr << "bufToHex differs from previous implementation" << std::endl;
+    return 1;
+  }
+
+  double start = now();
+  for (unsigned long i = 0; i < iterations; ++i)
+    checksum += legacyBufToHex(buf, PduLength)[i % PduLength];
+  report("bufToHex (previous)", iterations, now() - start);
+
+  start = now();
+  for (unsigned long i = 0; i < iterations; ++i)
+    checksum += bufToHex(buf, PduLength)[i % PduLength];
+  report("bufToHex", iterations, now() - start);
+
+  start = now();
+  for (unsigned long i = 0; i < iterations; ++i)
+  {
+    legacyHexToBuf(hex, back);
+    checksum += back[i % PduLength];
+  }
+  report("hexToBuf (previous)", iterations, now() - start);
+
+  start = now();
+  for (unsigned long i = 0; i < iterations; ++i)
+  {
+    hexToBuf(hex, back);
+    checksum += back[i % PduLength];
+  }
+  report("hexToBuf", iterations, now() - start);
+
+  // conversion of a message archive between Latin-1 and GSM
+  for (unsigned int i = 0; i < 256; ++i)
+    legacyLatin1ToGsmTable[i] = latin1ToGsm(std::string(1, (char)i))[0];
+  std::string text;
+  for (unsigned int i = 0; i < 160; ++i)
+    text += "Hello, world! This is a test message "[i % 37];
+  std::string archive;
+  for (unsigned int i = 0; i < 100; ++i)
+    archive += text;
+  start = now();
+  for (unsigned long i = 0; i < iterations / 100; ++i)
+    checksum += legacyLatin1ToGsm(archive)[i % archive.length()];
+  report("latin1ToGsm per SMS (previous)", iterations, now() - start);
+
+  start = now();
+  for (unsigned long i = 0; i < iterations / 100; ++i)
+    checksum += latin1ToGsm(archive)[i % archive.length()];
+  report("latin1ToGsm per SMS", iterations, now() - start);
+
+  std::vector<char> buffer(2 * archive.length());
+  start = now();
+  for (unsigned long i = 0; i < iterations / 100; ++i)
+    checksum += latin1ToGsm(archive.data(), archive.length(), &buffer[0]);
+  report("latin1ToGsm per SMS (buffer)", iterations, now() - start);
+
+  std::string gsmArchive = latin1ToGsm(archive);
+  start = now();
+  for (unsigned long i = 0; i < iterations / 100; ++i)
+    checksum += gsmToLatin1(gsmArchive)[i % archive.length()];
+  report("gsmToLatin1 per SMS", iterations, now() - start);
+
+  start = now();
+  for (unsigned long i = 0; i < iterations / 100; ++i)
+    checksum += gsmToLatin1(gsmArchive.data(), gsmArchive.length(),
+                            &buffer[0]);
+  report("gsmToLatin1 per SMS (buffer)", iterations, now() - start);
+
+  // decoding of a complete SMS-DELIVER message
+  const std::string deliverPdu =
+    "0791947101671200040B851008050001F23900892171410155409FCEF4184D07D9"
+    "CBF273793E2FBB432062BA0CC2D2E5E16B398D7687C768FADC5E96B3DFF3BAFB0C"
+    "62EFEB663AC8FD1EA341E2F41CA4AFB741329A2B2673819C75BABEEC064DD36590"
+    "BA4CD7D34149B4BC0C3A96EF69B77B8C0EBBC76550DD4D0699C3F8B21B344D9741"
+    "49B4BCEC0651CB69B6DBD53AD6E9F331BA9C7683C26E102C8683BD6A30180C04AB"
+    "D900";
+  iterations /= 10;
+  try
+  {
+    // previous scheme: determine type, then decode the pdu again
+    start = now();
+    for (unsigned long i = 0; i < iterations; ++i)
+    {
+      SMSDecoder d(deliverPdu);
+      d.getAddress(true);
+      d.get2Bits();
+      SMSMessageRef sms = new SMSDeliverMessage(deliverPdu);
+      checksum += sms->userData().length();
+    }
+    report("decode (type and message)", iterations, now() - start);
+
+    start = now();
+    for (unsigned long i = 0; i < iterations; ++i)
+      checksum += SMSMessage::decode(deliverPdu)->userData().length();
+    report("SMSMessage::decode", iterations, now() - start);
+
+    // listing needs only address and timestamp
+    start = now();
+    for (unsigned long i = 0; i < iterations; ++i)
+    {
+      SMSMessageRef sms = SMSMessage::decode(deliverPdu);
+      checksum += sms->address()._number.length() +
+        sms->serviceCentreTimestamp()._day;
+    }
+    report("address and timestamp (message)", iterations, now() - start);
+
+    start = now();
+    for (unsigned long i = 0; i < iterations; ++i)
+    {
+      SMSMessageView view(deliverPdu);
+      checksum += view.address()._number.length() +
+        view.serviceCentreTimestamp()._day;
+    }
+    report("address and timestamp (view)", iterations, now() - start);
+
+    // listing a store of 1000 messages, decoded in one batch
+    const unsigned int BatchSize = 1000;
+    std::vector<std::string> batch(BatchSize, deliverPdu);
+    unsigned long rounds = iterations / BatchSize + 1;
+
+    start = now();
+    unsigned long allocated = allocations;
+    for (unsigned long r = 0; r < rounds; ++r)
+    {
+      std::vector<SMSMessageRef> messages;
+      for (unsigned int i = 0; i < BatchSize; ++i)
+        messages.push_back(SMSMessage::decode(batch[i]));
+      for (unsigned int i = 0; i < BatchSize; ++i)
+        checksum += messages[i]->address()._number.length() +
+          messages[i]->serviceCentreTimestamp()._day;
+    }
+    report("batch listing (messages)", rounds * BatchSize, now() - start,
+           allocations - allocated);
+
+    start = now();
+    allocated = allocations;
+    SMSDecodeArena arena;
+    for (unsigned long r = 0; r < rounds; ++r)
+    {
+      for (unsigned int i = 0; i < BatchSize; ++i)
+        arena.add(batch[i]);
+      for (unsigned int i = 0; i < BatchSize; ++i)
+        checksum += arena[i].address()._number.length() +
+          arena[i].serviceCentreTimestamp()._day;
+      arena.clear();
+    }
+    report("batch listing (arena)", rounds * BatchSize, now() - start,
+           allocations - allocated);
+
+    // decoding a large archive on several cores
+    std::vector<SMSBatchPdu> archive(iterations, SMSBatchPdu(deliverPdu));
+    std::vector<SMSDecodeResult> results;
+    for (unsigned int threads = 1; threads <= 8; threads *= 2)
+    {
+      start = now();
+      decodeSMSBatch(archive, results, threads);
+      report(stringPrintf("decodeSMSBatch (%d threads)", threads),
+             archive.size(), now() - start);
+      checksum += results.back()._message->userData().length();
+    }
+
+    // reassembly of 3-part messages from 50 senders arriving interleaved
+    const unsigned int Senders = 50, Parts = 3;
+    std::vector<SMSMessageRef> parts;
+    for (unsigned int sender = 0; sender < Senders; ++sender)
+      for (unsigned int p = 1; p <= Parts; ++p)
+      {
+        SMSDeliverMessage *sms = new SMSDeliverMessage();
+        parts.push_back(sms);
+        Address address(stringPrintf("+49170%07d", sender));
+        sms->setOriginatingAddress(address);
+        unsigned char udh[] = {0x00, 0x03, (unsigned char)sender, Parts,
+                               (unsigned char)p};
+        sms->setUserDataHeader(UserDataHeader(std::string((char*)udh, 5)));
+        sms->setUserData(std::string(153, 'a'));
+      }
+    rounds = iterations / parts.size() + 1;
+    SMSReassembler reassembler;
+    unsigned long peakOctets = 0;
+    start = now();
+    allocated = allocations;
+    for (unsigned long r = 0; r < rounds; ++r)
+    {
+      // first parts of all messages, then the second ones etc.
+      for (unsigned int p = 0; p < Parts; ++p)
+      {
+        for (unsigned int sender = 0; sender < Senders; ++sender)
+          reassembler.add(parts[sender * Parts + p], 1);
+        peakOctets = std::max(peakOctets, reassembler.pendingOctets());
+      }
+      ReassembledSMS m;
+      while (reassembler.next(m))
+        checksum += m._parts.size();
+    }
+    report("SMSReassembler::add", rounds * parts.size(), now() - start,
+           allocations - allocated);
+    std::cout << stringPrintf("%-32s %10lu octets", "  peak pending user data",
+                              peakOctets) << std::endl;
+
+    // encoding a message again, unchanged and after a change
+    SMSMessageRef sms = SMSMessage::decode(deliverPdu);
+    Address sca = sms->serviceCentreAddress();
+    start = now();
+    for (unsigned long i = 0; i < iterations; ++i)
+    {
+      sms->setServiceCentreAddress(sca);
+      checksum += sms->encode().length();
+    }
+    report("encode (changed)", iterations, now() - start);
+
+    start = now();
+    for (unsigned long i = 0; i < iterations; ++i)
+      checksum += sms->encode().length();
+    report("encode (unchanged)", iterations, now() - start);
+
+    // saving an SMS store file with 1000 messages after one change
+    // (appends a journal record) and rewriting it completely
+    const char *storeFile = "benchsms.sms";
+    std::ofstream(storeFile).close();
+    {
+      SortedSMSStore store((std::string)storeFile);
+      for (unsigned int i = 0; i < BatchSize; ++i)
+        store.insert(SMSStoreEntry(SMSMessage::decode(deliverPdu)));
+      store.sync();
+      rounds = iterations / BatchSize + 1;
+      start = now();
+      for (unsigned long r = 0; r < rounds; ++r)
+      {
+        SortedSMSStore::iterator i =
+          store.insert(SMSStoreEntry(SMSMessage::decode(deliverPdu)));
+        store.sync();
+        store.erase(i);
+        store.sync();
+      }
+      report("SortedSMSStore::sync (journal)", 2 * rounds, now() - start);
+
+      start = now();
+      for (unsigned long r = 0; r < rounds; ++r)
+        store.compact();
+      report("SortedSMSStore::compact", rounds, now() - start);
+    }
+
+    // opening the file, decoding all messages or (read-only) only the
+    // headers needed for sorting or (indexed) nothing
+    const char *openNames[] = {"SortedSMSStore open",
+                               "SortedSMSStore open (read-only)",
+                               "SortedSMSStore open (indexed)"};
+    for (int mode = 0; mode < 3; ++mode)
+    {
+      if (mode == 2)
+        SortedSMSStore((std::string)storeFile).setIndexed(true);
+      start = now();
+      for (unsigned long r = 0; r < rounds; ++r)
+      {
+        SortedSMSStore store((std::string)storeFile, mode != 0);
+        checksum += store.size();
+      }
+      report(openNames[mode], rounds * BatchSize, now() - start);
+    }
+    SMSStoreIndex::remove(storeFile);
+    remove(storeFile);
+
+    // building the maps of sorted stores with different messages and
+    // entries, and looking up every key in the stores
+    const SortOrder smsOrders[] = {ByDate, ByAddress, ByIndex};
+    const char *smsOrderNames[] = {"date", "address", "index"};
+    std::ofstream(storeFile).close();
+    {
+      SortedSMSStore store((std::string)storeFile);
+      std::vector<Timestamp> timestamps;
+      std::vector<Address> addresses;
+      for (unsigned int i = 0; i < BatchSize; ++i)
+      {
+        SMSDeliverMessage *sms = new SMSDeliverMessage();
+        SMSMessageRef message = sms;
+        Address address(stringPrintf("+49170%07u", i * 7919 % BatchSize));
+        Timestamp timestamp;
+        timestamp._year = 26;
+        timestamp._month = 1 + i % 12;
+        timestamp._day = 1 + i * 13 % 28;
+        timestamp._hour = i % 24;
+        timestamp._minute = i * 7 % 60;
+        sms->setOriginatingAddress(address);
+        sms->setServiceCentreTimestamp(timestamp);
+        store.insert(SMSStoreEntry(message));
+        timestamps.push_back(timestamp);
+        addresses.push_back(address);
+      }
+      rounds = iterations / BatchSize / 10 + 1;
+      store.setSortOrder(ByIndex);
+      for (int o = 0; o < 3; ++o)
+      {
+        std::vector<SMSStoreMap::value_type> values;
+        unsigned int i = 0;
+        for (SortedSMSStore::iterator j = store.begin(); j != store.end();
+             ++j, ++i)
+          if (smsOrders[o] == ByDate)
+            values.push_back(SMSStoreMap::value_type(
+              SMSMapKey(store, ByDate, timestamps[i]), &*j));
+          else if (smsOrders[o] == ByAddress)
+            values.push_back(SMSStoreMap::value_type(
+              SMSMapKey(store, ByAddress, addresses[i]), &*j));
+          else
+            values.push_back(SMSStoreMap::value_type(
+              SMSMapKey(store, ByIndex, (int)i), &*j));
+        benchMap<SMSStoreMap>("SMSStoreMap", smsOrderNames[o], values,
+                              rounds, checksum);
+      }
+      for (int flat = 0; flat < 2; ++flat)
+      {
+        store.setFlat(flat);
+        for (int o = 0; o < 3; ++o)
+        {
+          store.setSortOrder(smsOrders[o]);
+          start = now();
+          for (unsigned long r = 0; r < rounds; ++r)
+            for (unsigned int i = 0; i < BatchSize; ++i)
+              if (smsOrders[o] == ByDate)
+                checksum += store.count(timestamps[i]);
+              else if (smsOrders[o] == ByAddress)
+                checksum += store.count(addresses[i]);
+              else
+                checksum += store.count((int)i);
+          report(stringPrintf("SortedSMSStore lookup (%s/%s)",
+                              smsOrderNames[o], flat ? "flat" : "tree"),
+                 rounds * BatchSize, now() - start);
+        }
+      }
+      store.clear();
+    }
+    remove(storeFile);
+
+    const SortOrder phonebookOrders[] = {ByTelephone, ByText, ByIndex};
+    const char *phonebookOrderNames[] = {"number", "text", "index"};
+    const char *phonebookFile = "benchsms.pb";
+    std::ofstream(phonebookFile).close();
+    {
+      SortedPhonebook phonebook((std::string)phonebookFile, false);
+      std::vector<std::string> telephones, texts;
+      for (unsigned int i = 0; i < BatchSize; ++i)
+      {
+        telephones.push_back(stringPrintf("+49170%07u",
+                                          i * 7919 % BatchSize));
+        texts.push_back(stringPrintf("name %u", i * 4391 % BatchSize));
+        phonebook.insert(PhonebookEntryBase(telephones.back(),
+                                            texts.back()));
+      }
+      phonebook.setSortOrder(ByIndex);
+      for (int o = 0; o < 3; ++o)
+      {
+        std::vector<PhonebookMap::value_type> values;
+        unsigned int i = 0;
+        for (SortedPhonebook::iterator j = phonebook.begin();
+             j != phonebook.end(); ++j, ++i)
+          if (phonebookOrders[o] == ByTelephone)
+            values.push_back(PhonebookMap::value_type(
+              PhoneMapKey(phonebook, ByTelephone, telephones[i]), &*j));
+          else if (phonebookOrders[o] == ByText)
+            values.push_back(PhonebookMap::value_type(
+              PhoneMapKey(phonebook, ByText, texts[i]), &*j));
+          else
+            values.push_back(PhonebookMap::value_type(
+              PhoneMapKey(phonebook, ByIndex, (int)i), &*j));
+        benchMap<PhonebookMap>("PhonebookMap", phonebookOrderNames[o],
+                               values, rounds, checksum);
+      }
+      for (int flat = 0; flat < 2; ++flat)
+      {
+        phonebook.setFlat(flat);
+        for (int o = 0; o < 3; ++o)
+        {
+          phonebook.setSortOrder(phonebookOrders[o]);
+          start = now();
+          for (unsigned long r = 0; r < rounds; ++r)
+            for (unsigned int i = 0; i < BatchSize; ++i)
+              if (phonebookOrders[o] == ByTelephone)
+                checksum += phonebook.count(telephones[i]);
+              else if (phonebookOrders[o] == ByText)
+                checksum += phonebook.count(texts[i]);
+              else
+                checksum += phonebook.count((int)i);
+          report(stringPrintf("SortedPhonebook lookup (%s/%s)",
+                              phonebookOrderNames[o], flat ? "flat" : "tree"),
+                 rounds * BatchSize, now() - start);
+        }
+      }
+      phonebook.clear();
+    }
+    remove(phonebookFile);
+
+    // loading a large phonebook file with indices
+    const unsigned int PhonebookSize = 100000;
+    {
+      std::ofstream os(phonebookFile);
+      for (unsigned int i = 0; i < PhonebookSize; ++i)
+        os << i << "|name " << i * 4391 % PhonebookSize << "|+49170"
+           << i * 7919 % PhonebookSize << std::endl;
+    }
+    rounds = iterations / PhonebookSize + 1;
+    double elapsed = 0;
+    for (unsigned long r = 0; r < rounds; ++r)
+    {
+      start = now();
+      SortedPhonebook *phonebook =
+        new SortedPhonebook((std::string)phonebookFile, true);
+      elapsed += now() - start;
+      checksum += phonebook->size();
+      delete phonebook;
+    }
+    report("SortedPhonebook load", rounds * PhonebookSize, elapsed);
+
+    // saving the phonebook after inserting an entry
+    rounds = iterations / PhonebookSize * 10 + 1;
+    for (int incremental = 0; incremental < 2; ++incremental)
+    {
+      SortedPhonebook phonebook((std::string)phonebookFile, true);
+      phonebook.setIncremental(incremental);
+      start = now();
+      for (unsigned long r = 0; r < rounds; ++r)
+      {
+        phonebook.insert(PhonebookEntryBase("+491701234567", "new name"));
+        phonebook.sync();
+      }
+      report(incremental ? "SortedPhonebook sync (append)" :
+             "SortedPhonebook sync (rewrite)", rounds, now() - start);
+    }
+    remove(phonebookFile);
+    remove((std::string(phonebookFile) + "~").c_str());
+  }
+  catch (GsmException &ge)
+  {
+    std::cerr << "GsmException '" << ge.what() << "'" << std::endl;
+    return 1;
+  }
+
+  // keep the compiler from discarding the loops
+  return checksum == 0 ? 1 : 0;
+}
@@ -0,0 +1,7 @@
+#!/bin/sh
+
+# run the test
+./testalphabet > testalphabet.log
+
+# check if output differs from what it should be
+diff testalphabet.log testalphabet-output.txt
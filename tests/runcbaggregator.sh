@@ -0,0 +1,7 @@
+#!/bin/sh
+
+# run the test
+./testcbaggregator > testcbaggregator.log
+
+# check if output differs from what it should be
+diff testcbaggregator.log testcbaggregator-output.txt
@@ -0,0 +1,7 @@
+#!/bin/sh
+
+# run the test
+./testcodec > testcodec.log
+
+# check if output differs from what it should be
+diff testcodec.log testcodec-output.txt
@@ -0,0 +1,7 @@
+#!/bin/sh
+
+# run the test
+./testreassembly > testreassembly.log
+
+# check if output differs from what it should be
+diff testreassembly.log testreassembly-output.txt
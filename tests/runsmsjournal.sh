@@ -0,0 +1,7 @@
+#!/bin/sh
+
+# run the test
+./testsmsjournal > testsmsjournal.log
+
+# check if output differs from what it should be
+diff testsmsjournal.log testsmsjournal-output.txt
@@ -0,0 +1,7 @@
+#!/bin/sh
+
+# run the test
+./testsmsview > testsmsview.log
+
+# check if output differs from what it should be
+diff testsmsview.log testsmsview-output.txt
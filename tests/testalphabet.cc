@@ -0,0 +1,387 @@
+// *************************************************************************
+// * GSM TA/ME library
+// *
+// * File:    testalphabet.cc
+// *
+// * Purpose: Test GSM alphabet conversion functions
+// *
+// * Created: 18.10.2026
+// *************************************************************************
+
+#ifdef HAVE_CONFIG_H
+#include <gsm_config.h>
+#endif
+#include <gsmlib/gsm_alphabet.h>
+#include <gsmlib/gsm_sms.h>
+#include <gsmlib/gsm_util.h>
+#include <gsmlib/gsm_me_ta.h>
+#include <iostream>
+#include <cstdlib>
+#include "testcheck.h"
+
+using namespace gsmlib;
+
+static std::string hex(const std::string &s)
+{
+  return bufToHex((const unsigned char*)s.data(), s.length());
+}
+
+static const char *languageNames[] =
+  {"default", "Turkish", "Spanish", "Portuguese"};
+
+// port that answers AT commands like a simple ME and records the PDUs
+// of the sent SMSs
+class TestPort : public Port
+{
+private:
+  std::string _output;          // answer to be read
+
+public:
+  std::vector<std::string> _pdus;
+
+  std::string getLine() throw(GsmException)
+  {
+    std::string::size_type eol = _output.find('\n');
+    if (eol == std::string::npos)
+      throw GsmException("timeout", OtherError);
+    std::string result = _output.substr(0, eol + 1);
+    _output.erase(0, eol + 1);
+    return result;
+  }
+  void putLine(std::string line, bool carriageReturn = true)
+    throw(GsmException)
+  {
+    // the first line of every answer is the (empty) echo line
+    if (! carriageReturn)
+    {
+      // PDU followed by CTRL-Z
+      _pdus.push_back(line.substr(0, line.length() - 1));
+      _output += "\r\n+CMGS: 1\r\n\r\nOK\r\n";
+    }
+    else if (line.substr(0, 8) == "AT+CMGS=")
+      _output += "\r\n> ";
+    else if (line == "AT+CSMS?")
+      _output += "\r\n+CSMS: 0,1,1,1\r\n\r\nOK\r\n";
+    else if (line == "AT+CMMS=?")
+      _output += "\r\n+CMMS: (0-2)\r\n\r\nOK\r\n";
+    else if (line == "AT+CMMS?")
+      _output += "\r\n+CMMS: 0\r\n\r\nOK\r\n";
+    else
+      _output += "\r\nOK\r\n";
+  }
+  bool wait(GsmTime timeout) throw(GsmException)
+    {return ! _output.empty();}
+  void putBack(unsigned char c) {_output.insert(0, 1, (char)c);}
+  int readByte() throw(GsmException)
+  {
+    if (_output.empty())
+      throw GsmException("timeout", OtherError);
+    int c = (unsigned char)_output[0];
+    _output.erase(0, 1);
+    return c;
+  }
+  void setTimeOut(unsigned int timeout) {}
+};
+
+int main(int argc, char *argv[])
+{
+  // every character of every table survives the round trip
+  for (int locking = 0; locking < 4; ++locking)
+    for (int single = 0; single < 4; ++single)
+    {
+      GsmAlphabet alphabet((NationalLanguage)locking,
+                           (NationalLanguage)single);
+      unsigned int characters = 0;
+      for (int escaped = 0; escaped < 2; ++escaped)
+        for (unsigned char s = 0; s < 128; ++s)
+        {
+          unsigned long c = alphabet.character(s, escaped);
+          if (c == 0)
+            continue;
+          std::string utf8;
+          appendUtf8Character(utf8, c);
+          std::string septets = alphabet.fromUtf8(utf8);
+          // characters in both tables use the basic septet
+          check(alphabet.toUtf8(septets) == utf8,
+                stringPrintf("round trip %d/%d septet %d escaped %d",
+                             locking, single, s, escaped));
+          check(alphabet.septetCount(utf8) == (int)septets.length(),
+                stringPrintf("septetCount %d/%d septet %d", locking,
+                             single, s));
+          ++characters;
+        }
+      std::cout << languageNames[locking] << "/" << languageNames[single]
+                << ": " << characters << " characters" << std::endl;
+    }
+
+  // default alphabet with extension table
+  GsmAlphabet gsm;
+  std::string text = "{[x]} ~|^\\ \xe2\x82\xac 10 \xc2\xa3 @ \xce\xa9";
+  std::string septets = gsm.fromUtf8(text);
+  std::cout << "septets: " << hex(septets) << std::endl;
+  check(gsm.toUtf8(septets) == text, "extension round trip");
+  check(gsm.septetCount(text) == 30, "extension septetCount");
+
+  // characters not in the alphabet
+  unsigned int unconvertible;
+  septets = gsm.fromUtf8("a\xc4\x9f" "b\xf0\x9f\x98\x80", &unconvertible);
+  check(septets == "a?b?" && unconvertible == 2, "unconvertible");
+  check(gsm.septetCount("a\xc4\x9f") == -1, "septetCount unconvertible");
+
+  // national tables, g breve is in the Turkish single shift table
+  GsmAlphabet turkish(DefaultLanguage, Turkish);
+  check(turkish.septetCount("a\xc4\x9f") == 3, "Turkish single shift");
+  GsmAlphabet turkishLocking(Turkish, Turkish);
+  check(turkishLocking.septetCount("a\xc4\x9f") == 2, "Turkish locking shift");
+
+  // escape followed by a septet not in the extension table and
+  // trailing escape
+  check(gsm.toUtf8("\x1b" "A\x1b") == "A", "unknown escape");
+
+  // ASCII fast path gives the same result as character-wise conversion
+  srand(1);
+  for (int i = 0; i < 1000; ++i)
+  {
+    std::string ascii;
+    unsigned int length = rand() % 40;
+    for (unsigned int j = 0; j < length; ++j)
+      ascii += (char)(rand() % 127 + 1);
+    std::string slow;
+    for (unsigned int j = 0; j < length; ++j)
+      slow += gsm.fromUtf8(ascii.substr(j, 1));
+    check(gsm.fromUtf8(ascii) == slow, "ASCII fast path");
+  }
+
+  // UCS2 conversion with surrogate pairs
+  std::string utf8 = "A\xc3\xa4\xe2\x82\xac\xf0\x9f\x98\x80";
+  std::string ucs2 = utf8ToUcs2(utf8);
+  std::cout << "UCS2: " << hex(ucs2) << std::endl;
+  check(ucs2ToUtf8(ucs2) == utf8, "UCS2 round trip");
+  check(ucs2Length(utf8) == 5, "ucs2Length");
+  check(ucs2ToUtf8(std::string("\xd8\x3d\x00\x41", 4)) == "\xef\xbf\xbd" "A",
+        "unpaired surrogate");
+
+  // invalid UTF-8 yields the replacement character
+  std::string::size_type pos = 0;
+  check(nextUtf8Character("\xc0\xaf", pos) == UnicodeReplacement,
+        "overlong UTF-8");
+  pos = 0;
+  check(nextUtf8Character("\xe2\x82", pos) == UnicodeReplacement,
+        "truncated UTF-8");
+
+  // Latin-1 conversion functions handle escapes
+  std::string latin1 = "[x] {y} \\ ~ | ^";
+  std::string gsmLatin1 = latin1ToGsm(latin1);
+  std::cout << "latin1ToGsm: " << hex(gsmLatin1) << std::endl;
+  check(gsmToLatin1(gsmLatin1) == latin1, "Latin-1 escapes");
+
+  // bulk conversion gives the same result as character-wise conversion,
+  // also for escapes at the end of 16 character blocks
+  for (int i = 0; i < 2000; ++i)
+  {
+    std::string s;
+    unsigned int length = rand() % 70;
+    for (unsigned int j = 0; j < length; ++j)
+      switch (rand() % 4)
+      {
+      case 0:
+        s += (char)(rand() % 256);
+        break;
+      case 1:
+        s += i % 2 ? (char)GSM_ESCAPE : '[';
+        break;
+      default:
+        s += (char)('a' + rand() % 26);
+        break;
+      }
+    std::string latin1, gsm;
+    for (unsigned int j = 0; j < length; ++j)
+      gsm += latin1ToGsm(s.substr(j, 1));
+    for (unsigned int j = 0; j < length; ++j)
+    {
+      if (s[j] == (char)GSM_ESCAPE && j + 1 < length)
+        latin1 += gsmToLatin1(s.substr(j++, 2));
+      else
+        latin1 += gsmToLatin1(s.substr(j, 1));
+    }
+    check(latin1ToGsm(s) == gsm, "bulk latin1ToGsm");
+    check(gsmToLatin1(s) == latin1, "bulk gsmToLatin1");
+  }
+
+  check(latin1ToUtf8("\xe4") == "\xc3\xa4" &&
+        utf8ToLatin1("\xc3\xa4\xe2\x82\xac") == "\xe4?", "Latin-1 UTF-8");
+
+  // SMS user data length counts the escapes
+  try
+  {
+    SMSSubmitMessage submit(std::string(159, 'x') + "[", "12345");
+    check(submit.userDataLength() == 161, "userDataLength");
+    SMSMessageRef sms = SMSMessage::decode(submit.encode(), false);
+    check(sms->userData() == submit.userData(), "user data with escapes");
+  }
+  catch (GsmException &ge)
+  {
+    std::cerr << "GsmException '" << ge.what() << "'" << std::endl;
+    return 1;
+  }
+
+  // segmentation of texts into SMSs
+  try
+  {
+    const char *alphabetNames[] = {"default", "8-bit", "UCS2"};
+    struct
+    {
+      std::string text;
+      bool concatenated;
+      bool eightBit;
+    } texts[] =
+      {{std::string(160, 'a'), true, false},
+       {std::string(161, 'a'), true, false},
+       {std::string(161, 'a'), false, false},
+       {std::string(152, 'a') + "{" + std::string(200, 'b'), true, false},
+       {std::string(100, '{'), true, false},
+       {std::string(100, '{'), true, true},
+       {"a\xc4\x9f" + std::string(150, 'b'), true, false},
+       {"\xc4\xb1\xc4\x9f\xc3\xa7\xc5\x9f\xc4\x9e" + std::string(170, 'i'),
+        true, false},
+       {std::string(66, '\xd0') + "\xf0\x9f\x98\x80" +
+        std::string(100, 'x'), true, false},
+       {"", true, false},
+       {std::string(100, '\xd1'), true, false}};
+    for (unsigned int i = 0; i < sizeof(texts) / sizeof(texts[0]); ++i)
+    {
+      // replace the 0xd0 placeholders by Cyrillic and the 0xd1
+      // placeholders by Turkish characters
+      std::string text;
+      for (unsigned int j = 0; j < texts[i].text.length(); ++j)
+        if (texts[i].text[j] == '\xd0')
+          text += "\xd0\xb6";
+        else if (texts[i].text[j] == '\xd1')
+          text += "\xc4\x9f";
+        else
+          text += texts[i].text[j];
+
+      SMSTextSegments segments =
+        segmentSMSText(text, texts[i].concatenated, true, texts[i].eightBit);
+      std::cout << "text " << i << ": " << segments.size() << " SMS, "
+                << alphabetNames[segments._alphabet >> 2] << " alphabet, "
+                << "shift " << segments._lockingShift << "/"
+                << segments._singleShift << ", sizes";
+      std::string joined;
+      for (unsigned int j = 0; j < segments.size(); ++j)
+      {
+        std::string ud = segments._userData[j];
+        std::cout << " " << ud.length();
+        joined += ud;
+        // no SMS ends with an escape or a high surrogate
+        if (segments._alphabet == DCS_DEFAULT_ALPHABET)
+          check(ud.empty() || ud[ud.length() - 1] != GSM_ESCAPE,
+                stringPrintf("escape at end text %d", i));
+        else if (segments._alphabet == DCS_SIXTEEN_BIT_ALPHABET)
+          check(ud.length() < 2 ||
+                ((unsigned char)ud[ud.length() - 2] & 0xfc) != 0xd8,
+                stringPrintf("surrogate at end text %d", i));
+
+        // user data and header fit into an SMS
+        SMSSubmitMessage submit;
+        submit.setDataCodingScheme(DataCodingScheme(segments._alphabet));
+        submit.setUserDataHeader(
+          segments.userDataHeader(j, texts[i].concatenated ? 42 : -1));
+        if (segments._alphabet == DCS_DEFAULT_ALPHABET)
+          submit.setUserDataSeptets(ud);
+        else
+          submit.setUserData(ud);
+        check(submit.encode().length() / 2 - 1 <= 12 + 140,
+              stringPrintf("SMS too large text %d segment %d", i, j));
+      }
+      std::cout << std::endl;
+
+      if (segments._alphabet == DCS_DEFAULT_ALPHABET)
+        joined = GsmAlphabet(segments._lockingShift,
+                             segments._singleShift).toUtf8(joined);
+      else if (segments._alphabet == DCS_EIGHT_BIT_ALPHABET)
+        joined = latin1ToUtf8(joined);
+      else
+        joined = ucs2ToUtf8(joined);
+      check(joined == text, stringPrintf("segments of text %d", i));
+    }
+
+    // user data header with concatenation and shift information elements
+    SMSTextSegments segments =
+      segmentSMSText("\xc4\x9f" + std::string(200, 'a'));
+    std::cout << "user data header: "
+              << hex(segments.userDataHeader(1, 42)) << ", "
+              << hex(segments.userDataHeader(1)) << std::endl;
+
+    // user data already in the given alphabet
+    segments = segmentSMSUserData(std::string(152, 'a') + "[" +
+                                  std::string(10, 'b'), DCS_DEFAULT_ALPHABET);
+    check(segments.size() == 2 && segments._userData[0].length() == 152,
+          "segmentSMSUserData default alphabet");
+    segments = segmentSMSUserData(std::string(132, 'a') +
+                                  std::string("\xd8\x3d\xde\x00", 4) +
+                                  std::string(10, 'b'),
+                                  DCS_SIXTEEN_BIT_ALPHABET);
+    check(segments.size() == 2 && segments._userData[0].length() == 132,
+          "segmentSMSUserData UCS2");
+    segments = segmentSMSUserData(std::string(200, 'a'),
+                                  DCS_EIGHT_BIT_ALPHABET, false);
+    check(segments.size() == 2 && segments._userData[0].length() == 140,
+          "segmentSMSUserData 8-bit");
+    try
+    {
+      segmentSMSText(std::string(153 * 255 + 1, 'a'));
+      check(false, "more than 255 SMSs");
+    }
+    catch (GsmException &e)
+    {
+      std::cout << "long text: " << e.what() << std::endl;
+    }
+  }
+  catch (GsmException &ge)
+  {
+    std::cerr << "GsmException '" << ge.what() << "'" << std::endl;
+    return 1;
+  }
+
+  // information elements of the template are sent in every SMS
+  try
+  {
+    Ref<TestPort> port = new TestPort();
+    MeTa meTa(port.getptr());
+    Ref<SMSSubmitMessage> sms = new SMSSubmitMessage();
+    Address address("0177123456");
+    sms->setDestinationAddress(address);
+    std::string ports("\x0b\x84\x23\xf0", 4);
+    UserDataHeader udh;
+    udh.addIE(0x05, ports);
+    sms->setUserDataHeader(udh);
+    unsigned int sent = 0;
+    const char *texts[] = {"single", NULL, "single again"};
+    std::string twoSMS(200, 'a');
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+      meTa.sendSMSs(sms, texts[i] == NULL ? twoSMS : texts[i], false,
+                    texts[i] == NULL ? 42 : -1);
+      std::string text;
+      for (; sent < port->_pdus.size(); ++sent)
+      {
+        SMSMessageRef part = SMSMessage::decode(port->_pdus[sent], false);
+        UserDataHeader partUdh = part->userDataHeader();
+        std::cout << "sent " << i << ": " << hex(partUdh) << std::endl;
+        check(partUdh.getIE(0x05) == ports,
+              stringPrintf("port addressing kept %d", i));
+        text += part->userData();
+      }
+      check(text == (texts[i] == NULL ? twoSMS : texts[i]),
+            stringPrintf("text of template %d", i));
+    }
+  }
+  catch (GsmException &ge)
+  {
+    std::cerr << "GsmException '" << ge.what() << "'" << std::endl;
+    return 1;
+  }
+
+  return checkResult();
+}
@@ -0,0 +1,217 @@
+// *************************************************************************
+// * GSM TA/ME library
+// *
+// * File:    testcbaggregator.cc
+// *
+// * Purpose: Test reassembly of cell broadcast pages and suppression of
+// *          repeated broadcasts
+// *
+// * Created: 18.10.2026
+// *************************************************************************
+
+#ifdef HAVE_CONFIG_H
+#include <gsm_config.h>
+#endif
+#include <gsmlib/gsm_cb_aggregator.h>
+#include <iostream>
+#include "testcheck.h"
+
+using namespace gsmlib;
+
+// create CB page in the default alphabet (GSM 03.41 section 9.3)
+static CBMessageRef page(int identifier, int code, int update,
+                         int total, int current, std::string text)
+{
+  SMSEncoder e;
+  e.setInteger(code >> 4, 6);
+  e.set2Bits(CBMessage::PLMNWide);
+  e.setInteger(update, 4);
+  e.setInteger(code & 0xf, 4);
+  e.setInteger(identifier >> 8, 8);
+  e.setInteger(identifier & 0xff, 8);
+  e.setOctet(0x01);             // English
+  e.setInteger(total, 4);
+  e.setInteger(current, 4);
+  e.markSeptet();
+  text.resize(93, '\r');
+  e.setString(latin1ToGsm(text));
+  return new CBMessage(e.getHexString());
+}
+
+// return data of all messages that are ready without the padding
+static std::string drain(CBAggregator &a)
+{
+  std::string result;
+  ReassembledCBM m;
+  while (a.next(m))
+  {
+    std::string data = m.getData();
+    for (std::string::iterator i = data.begin(); i != data.end(); ++i)
+      if (*i != '\r')
+        result += *i;
+    result += "|";
+  }
+  return result;
+}
+
+int main(int argc, char *argv[])
+{
+  try
+  {
+    CBMessageRef p = page(50, 17, 3, 2, 1, "x");
+    check(p->getMessageIdentifier() == 50 && p->getMessageCode() == 17 &&
+          p->getUpdateNumber() == 3 && p->getTotalPageNumber() == 2 &&
+          p->getCurrentPageNumber() == 1, "page header");
+
+    // pages out of order, interleaved with another message, a duplicate
+    // page and repetitions of the complete messages
+    {
+      CBAggregator a;
+      check(! a.add(page(50, 1, 0, 3, 2, "Bb"), 100), "add 1");
+      check(a.add(page(221, 7, 0, 1, 1, "single"), 100), "add 2");
+      check(! a.add(page(50, 1, 0, 3, 1, "Aa"), 100), "add 3");
+      check(! a.add(page(50, 1, 0, 3, 2, "Bb"), 100), "add 4");
+      check(a.add(page(50, 1, 0, 3, 3, "Cc"), 100), "add 5");
+      check(drain(a) == "single|AaBbCc|", "order of messages");
+      for (int i = 1; i <= 3; ++i)
+        check(! a.add(page(50, 1, 0, 3, i, "?"), 200), "repeated page");
+      check(! a.add(page(221, 7, 0, 1, 1, "single"), 200), "repeated single");
+      check(a.ready() == 0 && a.pendingMessages() == 0 &&
+            a.rememberedMessages() == 2, "repeats dropped");
+
+      // new update number
+      check(a.add(page(221, 7, 1, 0, 0, "update"), 300), "update number");
+      std::cout << "update: " << drain(a) << std::endl;
+
+      const CBAggregator::Statistics &s = a.statistics();
+      std::cout << "pages " << s._pages << " duplicates " << s._duplicates
+                << " repeats " << s._repeats << " completed "
+                << s._completed << std::endl;
+    }
+
+    // textual representation of a multi-page message
+    {
+      CBAggregator a;
+      a.add(page(1000, 513, 2, 2, 2, "second page"));
+      a.add(page(1000, 513, 2, 2, 1,
+                 std::string(93, 'x').replace(82, 11, "first page ")));
+      ReassembledCBM m;
+      check(a.next(m), "two pages");
+      std::cout << m.toString();
+    }
+
+    // missing page is taken from the next repetition
+    {
+      CBAggregator a(600);
+      a.add(page(4370, 2, 0, 3, 1, "A"), 1000);
+      a.add(page(4370, 2, 0, 3, 3, "C"), 1000);
+      a.expire(1300);
+      a.add(page(4370, 2, 0, 3, 1, "A"), 1300);
+      a.add(page(4370, 2, 0, 3, 2, "B"), 1300);
+      check(drain(a) == "ABC|", "missing page from repetition");
+      a.add(page(4370, 2, 0, 3, 3, "C"), 1300);
+      check(a.statistics()._duplicates == 1 &&
+            a.statistics()._repeats == 1, "repetition statistics");
+    }
+
+    // partial messages time out, remembered messages are forgotten
+    // after the repeat period
+    {
+      CBAggregator a(600, 3600);
+      a.add(page(1, 1, 0, 2, 1, "first"), 1000);
+      a.add(page(2, 1, 0, 1, 1, "single"), 1000);
+      drain(a);
+      a.add(page(2, 1, 0, 1, 1, "single"), 2000);
+      a.expire(1599);
+      check(a.pendingMessages() == 1, "not yet expired");
+      a.expire(1600);
+      check(a.pendingMessages() == 0 && a.statistics()._expired == 1 &&
+            a.rememberedMessages() == 1, "expired partial");
+      a.expire(5599);
+      check(a.rememberedMessages() == 1, "repeat period from last repeat");
+      a.expire(5600);
+      check(a.rememberedMessages() == 0 &&
+            a.add(page(2, 1, 0, 1, 1, "single"), 5600), "forgotten");
+    }
+
+    // limits on partial and remembered messages
+    {
+      CBAggregator a(0, 0, 2, 2);
+      a.add(page(1, 1, 0, 2, 1, "1"));
+      a.add(page(2, 1, 0, 2, 1, "2"));
+      a.add(page(1, 1, 0, 2, 1, "1"));
+      a.add(page(3, 1, 0, 2, 1, "3"));
+      check(a.pendingMessages() == 2 && a.statistics()._evicted == 1 &&
+            a.add(page(1, 1, 0, 2, 2, "x")) &&
+            ! a.add(page(2, 1, 0, 2, 2, "x")) &&
+            a.add(page(3, 1, 0, 2, 2, "x")), "maxMessages");
+      drain(a);
+      a.add(page(10, 1, 0, 1, 1, "a"));
+      a.add(page(11, 1, 0, 1, 1, "b"));
+      a.add(page(10, 1, 0, 1, 1, "a"));
+      a.add(page(12, 1, 0, 1, 1, "c"));
+      check(a.rememberedMessages() == 2 && drain(a) == "a|b|c|" &&
+            ! a.add(page(10, 1, 0, 1, 1, "a")) &&
+            a.add(page(11, 1, 0, 1, 1, "b")), "maxRepeats");
+    }
+
+    // invalid page numbers are ignored
+    {
+      CBAggregator a;
+      check(! a.add(page(1, 1, 0, 2, 0, "zero")) &&
+            ! a.add(page(1, 1, 0, 2, 3, "beyond")) &&
+            a.pendingMessages() == 0, "invalid page numbers");
+    }
+
+    // channel filter as set with +CSCB
+    {
+      CBChannelFilter f;
+      f.addMessageIdentifiers("0-3, 50,4370-4399");
+      f.addMessageIdentifiers(65535, 65535);
+      std::cout << "channels: '" << f.messageIdentifierRanges() << "' '"
+                << f.dataCodingSchemeRanges() << "'" << std::endl;
+      check(f.accept(50, 0x01) && ! f.accept(51, 0x01) &&
+            f.accept(65535, 0xff), "message identifiers");
+      f.addDataCodingSchemes("1,16-31");
+      std::cout << "data coding schemes: '" << f.dataCodingSchemeRanges()
+                << "'" << std::endl;
+      check(f.accept(50, 0x11) && ! f.accept(50, 0x00), "data coding schemes");
+
+      // the TPDU is checked before decoding
+      std::string pdu = "0010" "1112" "01" "11";
+      check(f.accept(pdu + std::string(164, '0')) &&
+            f.accept("001011120F") == false &&
+            f.accept("00100032") && f.accept("0010XX1201"),
+            "accept TPDU");
+
+      // mode 1 excludes the combinations of the given ranges
+      f.invert();
+      std::cout << "inverted: " << f.inverted() << " '"
+                << f.messageIdentifierRanges() << "' '"
+                << f.dataCodingSchemeRanges() << "'" << std::endl;
+      check(! f.accept(50, 0x11) && f.accept(50, 0x00) &&
+            f.accept(51, 0x11) && f.accept(51, 0x00), "inverted filter");
+      f.invert();
+      check(f.accept(50, 0x11) && ! f.inverted(), "inverted twice");
+      check(CBChannelFilter(true).accept(12345, 0x42), "accept all");
+
+      const char *invalid[] = {"1-", "-1", "3-1", "65536", "1,,2", "a"};
+      for (unsigned int i = 0; i < sizeof(invalid) / sizeof(invalid[0]);
+           ++i)
+        try
+        {
+          f.addMessageIdentifiers(invalid[i]);
+          check(false, stringPrintf("invalid range list %s", invalid[i]));
+        }
+        catch (GsmException &)
+        {
+        }
+    }
+  }
+  catch (GsmException &ge)
+  {
+    std::cerr << "GsmException '" << ge.what() << "'" << std::endl;
+    return 1;
+  }
+  return checkResult();
+}
@@ -0,0 +1,37 @@
+// *************************************************************************
+// * GSM TA/ME library
+// *
+// * File:    testcheck.h
+// *
+// * Purpose: Error counting for the tests that check results themselves
+// *          (the errors are part of the output compared by run*.sh)
+// *
+// * Created: 18.10.2026
+// *************************************************************************
+
+#ifndef TESTCHECK_H
+#define TESTCHECK_H
+
+#include <iostream>
+#include <string>
+
+static unsigned int errors = 0;
+
+// report error if ok is not set
+static void check(bool ok, std::string what)
+{
+  if (! ok)
+  {
+    std::cout << "error: " << what << std::endl;
+    ++errors;
+  }
+}
+
+// print number of errors and return exit code of the test
+static int checkResult()
+{
+  std::cout << errors << " errors" << std::endl;
+  return errors == 0 ? 0 : 1;
+}
+
+#endif // TESTCHECK_H
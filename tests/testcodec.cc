@@ -0,0 +1,208 @@
+// *************************************************************************
+// * GSM TA/ME library
+// *
+// * File:    testcodec.cc
+// *
+// * Purpose: Test low-level SMS TPDU coding functions against
+// *          straightforward reference implementations
+// *
+// * Created: 18.10.2026
+// *************************************************************************
+
+#ifdef HAVE_CONFIG_H
+#include <gsm_config.h>
+#endif
+#include <gsmlib/gsm_sms_codec.h>
+#include <gsmlib/gsm_util.h>
+#include <gsmlib/gsm_error.h>
+#include <iostream>
+#include <cstdlib>
+#include <cctype>
+#include "testcheck.h"
+
+using namespace gsmlib;
+
+// reference septet packing, one bit at a time
+// udhLength octets of user data header (all 0xff) precede the septets
+static std::string referencePack(unsigned int udhLength, std::string s)
+{
+  std::string bits;
+  for (unsigned int i = 0; i < udhLength; ++i)
+    bits += "11111111";
+  while (bits.length() % 7 != 0)
+    bits += '0';
+  for (unsigned int i = 0; i < s.length(); ++i)
+    for (int j = 0; j < 7; ++j)
+      bits += ((s[i] >> j) & 1) ? '1' : '0';
+  while (bits.length() % 8 != 0)
+    bits += '0';
+
+  std::string result;
+  for (unsigned int i = 0; i < bits.length(); i += 8)
+  {
+    unsigned char c = 0;
+    for (int j = 0; j < 8; ++j)
+      if (bits[i + j] == '1')
+        c |= 1 << j;
+    result += stringPrintf("%02X", c);
+  }
+  return result;
+}
+
+// reference hexadecimal conversion
+static std::string referenceHex(const unsigned char *buf, unsigned int length)
+{
+  std::string result;
+  for (unsigned int i = 0; i < length; ++i)
+    result += stringPrintf("%02X", buf[i]);
+  return result;
+}
+
+int main(int argc, char *argv[])
+{
+  try
+  {
+    srand(1);
+
+    // septet strings at every alignment after a user data header
+    unsigned int count = 0;
+    for (unsigned int udhLength = 0; udhLength <= 14; ++udhLength)
+      for (unsigned int length = 0; length <= 160; ++length)
+      {
+        std::string text;
+        for (unsigned int i = 0; i < length; ++i)
+          text += (char)(rand() & 0x7f);
+
+        SMSEncoder e;
+        e.markSeptet();
+        std::string udh(udhLength, (char)0xff);
+        e.setOctets((const unsigned char*)udh.data(), udhLength);
+        e.setString(text);
+        std::string pdu = e.getHexString();
+        check(pdu == referencePack(udhLength, text),
+              stringPrintf("setString udh %d length %d", udhLength, length));
+
+        SMSDecoder d(pdu);
+        d.markSeptet();
+        unsigned char buf[20];
+        d.getOctets(buf, udhLength);
+        check(d.getString(length) == text,
+              stringPrintf("getString udh %d length %d", udhLength, length));
+        ++count;
+      }
+    std::cout << "septet strings: " << count << " checked" << std::endl;
+
+    // characters with bit 7 set only contribute their lower seven bits
+    {
+      SMSEncoder e;
+      e.markSeptet();
+      e.setString(std::string(9, (char)0xff));
+      check(e.getHexString() == referencePack(0, std::string(9, 0x7f)),
+            "setString masks bit 7");
+    }
+
+    // truncated septet strings are rejected
+    try
+    {
+      SMSDecoder d("C3E1");
+      d.markSeptet();
+      d.getString(3);
+      check(false, "getString beyond end of PDU");
+    }
+    catch (GsmException &e)
+    {
+      std::cout << "truncated septet string: " << e.what() << std::endl;
+    }
+
+    // integers of all widths at all bit offsets
+    count = 0;
+    for (unsigned short offset = 0; offset < 8; ++offset)
+      for (unsigned short width = 1; width <= 24; ++width)
+      {
+        unsigned long value = ((unsigned long)rand() << 8 ^ rand()) &
+          ((1UL << width) - 1);
+        SMSEncoder e;
+        for (unsigned short i = 0; i < offset; ++i)
+          e.setBit(i & 1);
+        e.setInteger(value, width);
+        e.setBit(true);
+
+        SMSDecoder d(e.getHexString());
+        for (unsigned short i = 0; i < offset; ++i)
+          check(d.getBit() == (i & 1), "bit before integer");
+        check(d.getInteger(width) == value,
+              stringPrintf("getInteger offset %d width %d", offset, width));
+        check(d.getBit(), "bit after integer");
+        ++count;
+      }
+    std::cout << "integers: " << count << " checked" << std::endl;
+
+    // hexadecimal conversion of all lengths up to a full PDU
+    count = 0;
+    for (unsigned int length = 0; length <= 180; ++length)
+    {
+      unsigned char buf[180], back[180];
+      for (unsigned int i = 0; i < length; ++i)
+        buf[i] = (unsigned char)rand();
+      std::string hex = bufToHex(buf, length);
+      check(hex == referenceHex(buf, length),
+            stringPrintf("bufToHex length %d", length));
+      check(hexToBuf(hex, back) && std::string((char*)buf, length) ==
+            std::string((char*)back, length),
+            stringPrintf("hexToBuf length %d", length));
+
+      // lower case digits are accepted as well
+      std::string lower = hex;
+      for (unsigned int i = 0; i < lower.length(); ++i)
+        lower[i] = tolower(lower[i]);
+      check(hexToBuf(lower, back) && std::string((char*)buf, length) ==
+            std::string((char*)back, length),
+            stringPrintf("hexToBuf lower case length %d", length));
+
+      // a single invalid character anywhere is rejected
+      const char invalid[] = {'G', 'g', '/', ':', '@', '`', ' ', '\xb0'};
+      for (unsigned int i = 0; i < hex.length(); ++i)
+      {
+        std::string bad = hex;
+        bad[i] = invalid[i % sizeof(invalid)];
+        check(! hexToBuf(bad, back),
+              stringPrintf("hexToBuf invalid length %d position %d",
+                           length, i));
+      }
+      ++count;
+    }
+    unsigned char buf[2];
+    check(! hexToBuf("ABC", buf), "hexToBuf odd length");
+
+    // decoders on binary PDUs and on PDUs exceeding the inline buffer
+    for (unsigned int length = SMSDecoder::InlinePduLength - 2;
+         length <= SMSDecoder::InlinePduLength + 2; ++length)
+    {
+      unsigned char pdu[SMSDecoder::InlinePduLength + 2];
+      for (unsigned int i = 0; i < length; ++i)
+        pdu[i] = (unsigned char)rand();
+      SMSDecoder hexDecoder(bufToHex(pdu, length));
+      SMSDecoder binaryDecoder(pdu, length);
+      bool same = true;
+      for (unsigned int i = 0; i < length; ++i)
+        same = same && hexDecoder.getOctet() == pdu[i] &&
+          binaryDecoder.getOctet() == pdu[i];
+      check(same, stringPrintf("SMSDecoder length %d", length));
+      try
+      {
+        binaryDecoder.getOctet();
+        check(false, stringPrintf("SMSDecoder end length %d", length));
+      }
+      catch (GsmException &e)
+      {
+      }
+    }
+    std::cout << "hexadecimal strings: " << count << " checked" << std::endl;
+  }
+  catch (GsmException &ge)
+  {
+    std::cerr << "GsmException '" << ge.what() << "'" << std::endl;
+    return 1;
+  }
+  return checkResult();
+}
@@ -0,0 +1,284 @@
+// *************************************************************************
+// * GSM TA/ME library
+// *
+// * File:    testreassembly.cc
+// *
+// * Purpose: Test reassembly of concatenated SMS messages
+// *
+// * Created: 18.10.2026
+// *************************************************************************
+
+#ifdef HAVE_CONFIG_H
+#include <gsm_config.h>
+#endif
+#include <gsmlib/gsm_sms_reassembly.h>
+#include <iostream>
+#include <cstdlib>
+#include "testcheck.h"
+
+using namespace gsmlib;
+
+// create part of a concatenated message (total == 0: not concatenated)
+// the SMS is encoded and decoded to exercise the user data header coding
+static SMSMessageRef part(std::string originator, std::string text,
+                          unsigned int reference = 0, bool sixteenBit = false,
+                          unsigned char total = 0, unsigned char sequence = 0)
+{
+  SMSDeliverMessage sms;
+  Address address(originator);
+  sms.setOriginatingAddress(address);
+  if (total != 0)
+  {
+    std::string udh;
+    if (sixteenBit)
+    {
+      udh += (char)0x08;
+      udh += (char)4;
+      udh += (char)(reference >> 8);
+      udh += (char)reference;
+    }
+    else
+    {
+      udh += (char)0x00;
+      udh += (char)3;
+      udh += (char)reference;
+    }
+    udh += (char)total;
+    udh += (char)sequence;
+    sms.setUserDataHeader(UserDataHeader(udh));
+  }
+  sms.setUserData(text);
+  return SMSMessage::decode(sms.encode());
+}
+
+// print and return all messages that are ready
+static std::string drain(SMSReassembler &r, bool print = true)
+{
+  std::string result;
+  ReassembledSMS m;
+  while (r.next(m))
+  {
+    if (print)
+      std::cout << "'" << m.address()._number << "' "
+                << (m._complete ? "complete" : "incomplete") << " '"
+                << m.userData() << "'" << std::endl;
+    result += m.userData() + "|";
+  }
+  return result;
+}
+
+int main(int argc, char *argv[])
+{
+  try
+  {
+    // parts arriving out of order, interleaved with other messages with
+    // the same reference number, a duplicate and an unconcatenated SMS
+    {
+      SMSReassembler r;
+      check(! r.add(part("+491111", "C", 7, false, 3, 3), 100), "add 1");
+      check(! r.add(part("+492222", "y", 7, false, 2, 2), 100), "add 2");
+      check(! r.add(part("+491111", "a", 7, true, 2, 1), 100), "add 3");
+      check(! r.add(part("+491111", "A", 7, false, 3, 1), 100), "add 4");
+      check(r.add(part("+493333", "single"), 100), "add 5");
+      check(! r.add(part("+491111", "A", 7, false, 3, 1), 100), "add 6");
+      check(r.pendingMessages() == 3 && r.pendingOctets() == 4,
+            "pending after 6 parts");
+      check(r.add(part("+491111", "B", 7, false, 3, 2), 100), "add 7");
+      check(r.add(part("+491111", "b", 7, true, 2, 2), 100), "add 8");
+      check(r.add(part("+492222", "x", 7, false, 2, 1), 100), "add 9");
+      check(drain(r) == "single|ABC|ab|xy|", "order of messages");
+      check(r.pendingMessages() == 0 && r.pendingOctets() == 0,
+            "nothing pending");
+      const SMSReassembler::Statistics &s = r.statistics();
+      std::cout << "parts " << s._parts << " duplicates " << s._duplicates
+                << " completed " << s._completed << std::endl;
+    }
+
+    // invalid concatenation information elements are ignored
+    {
+      SMSReassembler r;
+      check(r.add(part("+491111", "zero", 1, false, 2, 0)) &&
+            r.add(part("+491111", "beyond", 1, false, 2, 3)) &&
+            r.add(part("+491111", "one part", 1, false, 1, 1)),
+            "invalid concatenation");
+      drain(r);
+    }
+
+    // timeout after the last part
+    {
+      SMSReassembler r(60);
+      r.add(part("+491111", "first", 1, false, 3, 1), 1000);
+      r.add(part("+492222", "other", 2, false, 2, 1), 1030);
+      r.add(part("+491111", "second", 1, false, 3, 2), 1050);
+      r.expire(1100);
+      check(r.ready() == 1, "expire other");
+      r.expire(1110);
+      ReassembledSMS m;
+      r.next(m);
+      r.next(m);
+      std::cout << m.toString();
+      check(r.statistics()._expired == 2 && r.pendingMessages() == 0,
+            "expired");
+    }
+
+    // textual representation of unconcatenated and submitted messages
+    {
+      SMSReassembler r(60);
+      SMSSubmitMessage submit;
+      Address address("+491111");
+      submit.setDestinationAddress(address);
+      submit.setUserData("submitted");
+      SMSMessageRef sms = SMSMessage::decode(submit.encode(), false);
+      r.add(sms);
+      ReassembledSMS m;
+      check(r.next(m) && m.toString() == sms->toString(),
+            "toString single");
+
+      std::string udh("\0\3\1\2\1", 5);
+      submit.setUserDataHeader(UserDataHeader(udh));
+      r.add(SMSMessage::decode(submit.encode(), false), 1000);
+      r.expire(1100);
+      check(r.next(m) &&
+            m.toString().find("SMS-SUBMIT") != std::string::npos &&
+            m.toString().find("Destination address: '491111'") !=
+            std::string::npos, "toString submit");
+    }
+
+    // limits on the number of partial messages and octets
+    {
+      SMSReassembler r(0, 2, 1000);
+      r.add(part("+491111", "1", 1, false, 2, 1));
+      r.add(part("+491111", "2", 2, false, 2, 1));
+      check(r.add(part("+491111", "1", 1, false, 3, 1)),
+            "maxMessages evicted message ready");
+      check(drain(r, false) == "1|" && r.pendingMessages() == 2,
+            "maxMessages");
+      r.flush();
+      drain(r, false);
+
+      SMSReassembler r2(0, 100, 200);
+      r2.add(part("+491111", std::string(100, 'a'), 1, false, 2, 1));
+      r2.add(part("+492222", std::string(100, 'b'), 1, false, 2, 1));
+      check(r2.ready() == 0, "maxOctets not reached");
+      check(r2.add(part("+493333", std::string(100, 'c'), 1, false, 2, 1)) &&
+            r2.statistics()._evicted == 1 && r2.pendingOctets() == 200,
+            "maxOctets");
+    }
+
+    // many interleaved messages in random order
+    {
+      srand(1);
+      const unsigned int Messages = 500;
+      std::vector<SMSMessageRef> parts;
+      for (unsigned int i = 0; i < Messages; ++i)
+      {
+        unsigned char total = 2 + i % 4;
+        for (unsigned char j = 1; j <= total; ++j)
+          parts.push_back(part(stringPrintf("+49%d", i % 7),
+                               stringPrintf("%d.%d ", i, j), i, i % 3 == 0,
+                               total, j));
+      }
+      for (unsigned int i = parts.size() - 1; i > 0; --i)
+        std::swap(parts[i], parts[rand() % (i + 1)]);
+
+      SMSReassembler r(0, Messages);
+      unsigned int complete = 0;
+      for (unsigned int i = 0; i < parts.size(); ++i)
+        r.add(parts[i], 1);
+      ReassembledSMS m;
+      while (r.next(m))
+      {
+        unsigned int n = atoi(m.userData().c_str());
+        std::string expected;
+        for (unsigned int j = 1; j <= m._parts.size(); ++j)
+          expected += stringPrintf("%d.%d ", n, j);
+        if (m._complete && m.userData() == expected)
+          ++complete;
+      }
+      check(complete == Messages && r.pendingOctets() == 0,
+            stringPrintf("random order, %d complete", complete));
+    }
+
+    // adding and removing information elements
+    {
+      UserDataHeader udh;
+      udh.addIE(0x05, std::string("\x0b\x84\x23\xf0", 4));
+      udh.addIE(0x24, std::string(1, '\x01'));
+      udh.addIE(0x05, "");
+      udh.removeIE(0x05);
+      check((std::string)udh == std::string("\x24\x01\x01", 3),
+            "addIE/removeIE");
+    }
+
+    // 16-bit references and additional information elements survive
+    // the send and receive path
+    {
+      UserDataHeader ports;
+      ports.addIE(0x05, std::string("\x0b\x84\x23\xf0", 4));
+      std::string text = "\xc4\x9f" + std::string(300, 'x');
+      SMSTextSegments segments =
+        segmentSMSText(text, true, true, false, true, ports);
+      SMSReassembler r;
+      for (unsigned int i = 0; i < segments.size(); ++i)
+      {
+        SMSSubmitMessage submit;
+        Address destination("+491111");
+        submit.setDestinationAddress(destination);
+        submit.setUserDataHeader(segments.userDataHeader(i, 0x1234));
+        submit.setUserDataSeptets(segments._userData[i]);
+        SMSMessageRef sms = SMSMessage::decode(submit.encode(), false);
+        check(submit.encode().length() / 2 - 1 <= 12 + 140,
+              stringPrintf("SMS %d too large", i));
+        check(sms->userDataHeader().getIE(0x05) ==
+              ports.getIE(0x05), "port addressing");
+        r.add(sms, 1);
+      }
+      std::string udh = segments.userDataHeader(0, 0x1234);
+      std::cout << segments.size() << " SMS, user data header "
+                << bufToHex((const unsigned char*)udh.data(), udh.length())
+                << std::endl;
+      ReassembledSMS m;
+      check(r.next(m) && m._complete && m._parts.size() == segments.size(),
+            "16-bit reassembly");
+      std::string septets;
+      for (unsigned int i = 0; i < m._parts.size(); ++i)
+        septets += segments._userData[i];
+      check(GsmAlphabet(segments._lockingShift, segments._singleShift)
+            .toUtf8(septets) == text, "16-bit segments");
+
+      // a header that leaves no room for user data
+      try
+      {
+        segmentSMSText("x", true, true, false, false,
+                       UserDataHeader(std::string(136, 'a')));
+        check(false, "user data header too long");
+      }
+      catch (GsmException &e)
+      {
+        std::cout << "long header: " << e.what() << std::endl;
+      }
+    }
+
+    // reference numbers are counted per destination
+    {
+      SMSReferenceAllocator eightBit(false, 254);
+      Address a("+491111"), b("+492222");
+      unsigned int r1 = eightBit.next(a), r2 = eightBit.next(a);
+      unsigned int r3 = eightBit.next(b), r4 = eightBit.next(a);
+      std::cout << "8-bit references " << r1 << " " << r2 << " " << r3
+                << " " << r4 << std::endl;
+      check(r1 == 254 && r2 == 255 && r3 == 0 && r4 == 0, "8-bit references");
+
+      SMSReferenceAllocator sixteenBit(true, 65535, 2);
+      check(sixteenBit.next(a) == 65535 && sixteenBit.next(b) == 0 &&
+            sixteenBit.next(a) == 0 && sixteenBit.next(Address("+3")) == 2 &&
+            sixteenBit.next(a) == 3, "16-bit references");
+    }
+  }
+  catch (GsmException &ge)
+  {
+    std::cerr << "GsmException '" << ge.what() << "'" << std::endl;
+    return 1;
+  }
+  return checkResult();
+}
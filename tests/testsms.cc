@@ -9,6 +9,7 @@
 #endif
 #include <gsmlib/gsm_sms.h>
 #include <iostream>
+#include <cctype>
 
 int main(int argc, char *argv[])
 {
@@ -67,5 +68,21 @@ int main(int argc, char *argv[])
   pdu = sms->encode();
   sms = gsmlib::SMSMessage::decode(pdu);
   std::cout << sms->toString() << std::endl;
+
+  // the encoded pdu is kept until the message is changed
+  gsmlib::Ref<gsmlib::SMSSubmitMessage> submit =
+    new gsmlib::SMSSubmitMessage("cached", "12345");
+  pdu = submit->encode();
+  submit->setMessageReference(42);
+  std::cout << "changed: " << (submit->encode() != pdu) << std::endl;
+  std::string lower = submit->encode();
+  for (unsigned int i = 0; i < lower.length(); ++i)
+    lower[i] = tolower(lower[i]);
+  std::cout << "encoded: " << submit->encode() << std::endl
+            << "lower case: "
+            << gsmlib::SMSMessage::decode(lower, false)->encode() << std::endl
+            << "trailing octets: "
+            << gsmlib::SMSMessage::decode(submit->encode() + "FF",
+                                          false)->encode() << std::endl;
   return 0;
 }
@@ -0,0 +1,392 @@
+// *************************************************************************
+// * GSM TA/ME library
+// *
+// * File:    testsmsjournal.cc
+// *
+// * Purpose: Test the journal format and index of SMS store files
+// *
+// * Created: 18.10.2026
+// *************************************************************************
+
+#ifdef HAVE_CONFIG_H
+#include <gsm_config.h>
+#endif
+#include <gsmlib/gsm_sorted_sms_store.h>
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include "testcheck.h"
+
+using namespace gsmlib;
+
+static const char *storeFile = "journal.sms";
+
+static std::string readFile()
+{
+  std::ifstream is(storeFile, std::ios::in | std::ios::binary);
+  return std::string((std::istreambuf_iterator<char>(is)),
+                     std::istreambuf_iterator<char>());
+}
+
+static void writeFile(const std::string &contents)
+{
+  std::ofstream os(storeFile, std::ios::out | std::ios::binary);
+  os.write(contents.data(), contents.length());
+}
+
+// return user data of all messages ordered by index
+static std::string messages()
+{
+  SortedSMSStore store((std::string)storeFile);
+  store.setSortOrder(ByIndex);
+  std::string result;
+  for (SortedSMSStore::iterator i = store.begin(); i != store.end(); ++i)
+    result += i->message()->userData() + "|";
+  return result;
+}
+
+static SMSStoreEntry entry(std::string text)
+{
+  return SMSStoreEntry(new SMSSubmitMessage(text, "0177123456"));
+}
+
+// return received message from number on day of the month
+static SMSStoreEntry deliver(std::string number, int day, std::string text)
+{
+  SMSDeliverMessage *sms = new SMSDeliverMessage();
+  SMSMessageRef message = sms;
+  Address address(number);
+  sms->setOriginatingAddress(address);
+  Timestamp timestamp;
+  timestamp._year = 26;
+  timestamp._month = 10;
+  timestamp._day = day;
+  timestamp._hour = 12;
+  sms->setServiceCentreTimestamp(timestamp);
+  sms->setUserData(text);
+  return SMSStoreEntry(message);
+}
+
+// return indices of the messages in date order
+static std::string dateOrder(SortedSMSStore &store)
+{
+  std::string result;
+  for (SortedSMSStore::iterator i = store.begin(); i != store.end(); ++i)
+    result += stringPrintf(" %d", i->index());
+  return result;
+}
+
+int main(int argc, char *argv[])
+{
+  try
+  {
+    writeFile("");
+
+    // changes are appended, messages survive reopening
+    {
+      SortedSMSStore store((std::string)storeFile);
+      store.insert(entry("one"));
+      store.insert(entry("two"));
+      store.sync();
+      std::string::size_type length = readFile().length();
+      store.insert(entry("three"));
+      store.sync();
+      check(readFile().length() > length &&
+            readFile().compare(0, length, readFile(), 0, length) == 0,
+            "insert appended");
+    }
+    std::cout << "after inserts: " << messages() << std::endl;
+
+    {
+      SortedSMSStore store((std::string)storeFile);
+      store.setSortOrder(ByIndex);
+      std::string::size_type length = readFile().length();
+      store.erase(store.begin());
+      store.sync();
+      check(readFile().length() == length + 9, "erase record appended");
+
+      // messages inserted and erased before syncing leave no trace
+      store.erase(store.insert(entry("transient")));
+      store.insert(entry("four"));
+      store.sync();
+      std::cout << "after erase: " << messages() << std::endl;
+
+      // unchanged store is not written
+      length = readFile().length();
+      store.sync();
+      check(readFile().length() == length, "unchanged store");
+    }
+
+    // torn tail (eg. crash while appending) is ignored
+    std::string file = readFile();
+    writeFile(file.substr(0, file.length() - 3));
+    std::cout << "torn tail: " << messages() << std::endl;
+
+    // record with a wrong CRC and everything after it is ignored
+    writeFile(file.substr(0, 2) + (char)(file[2] ^ 1) + file.substr(3));
+    std::cout << "corrupt first record: " << messages() << std::endl;
+
+    // the next change compacts a damaged file
+    writeFile(file.substr(0, file.length() - 3));
+    {
+      SortedSMSStore store((std::string)storeFile);
+      store.insert(entry("five"));
+    }
+    std::cout << "after compaction: " << messages() << std::endl;
+    check(readFile().length() < file.length() + 20, "compacted");
+
+    // the file is rewritten when most of its records are obsolete
+    {
+      SortedSMSStore store((std::string)storeFile);
+      for (int i = 0; i < 20; ++i)
+      {
+        store.insert(entry("x"));
+        store.sync();
+        store.setSortOrder(ByIndex);
+        store.erase(--store.end());
+        store.sync();
+      }
+      check(readFile().length() < file.length() + 150,
+            "automatic compaction");
+      store.clear();
+      store.compact();
+      check(readFile().length() == 2, "compact() of empty store");
+    }
+
+    // files in the previous format are read and converted on the first
+    // change
+    {
+      std::string pdu = SMSSubmitMessage("old", "0177123456").encode();
+      std::string version("\0\1", 2), old;
+      old += (char)(pdu.length() >> 8);
+      old += (char)(pdu.length() & 0xff);
+      old += std::string(4, '\0');
+      old += (char)SMSMessage::SMS_SUBMIT;
+      old += pdu;
+      writeFile(version + old + old);
+      std::cout << "version 1: " << messages() << std::endl;
+      writeFile(version + old + old.substr(0, old.length() - 1));
+      try
+      {
+        messages();
+        check(false, "truncated version 1 file");
+      }
+      catch (GsmException &)
+      {
+      }
+      writeFile(version + old);
+      {
+        SortedSMSStore store((std::string)storeFile);
+        store.insert(entry("new"));
+      }
+      check(readFile()[1] == 2, "converted to version 2");
+      std::cout << "converted: " << messages() << std::endl;
+    }
+
+    // read-only stores decode messages on access
+    {
+      {
+        SortedSMSStore store((std::string)storeFile);
+        store.insert(entry("third"));
+      }
+      SortedSMSStore store((std::string)storeFile, true);
+      check(store.size() == 3, "read-only size");
+      unsigned int lazy = 0;
+      for (SortedSMSStore::iterator i = store.begin(); i != store.end(); ++i)
+        lazy += ! i->headerView().isnull();
+      check(lazy == 3, "lazy entries");
+      check(store.flat(), "read-only store is flat");
+      store.setSortOrder(ByAddress);
+      check(store.begin()->message()->userData() == "old" &&
+            store.begin()->headerView().isnull(), "decoded on access");
+      store.setSortOrder(ByIndex);
+      std::cout << "read-only:";
+      for (SortedSMSStore::iterator i = store.begin(); i != store.end(); ++i)
+        std::cout << " " << i->index() << " " << i->message()->userData();
+      std::cout << std::endl;
+      try
+      {
+        store.erase(store.begin());
+        check(false, "erase in read-only store");
+      }
+      catch (GsmException &e)
+      {
+        std::cout << e.what() << std::endl;
+      }
+      check(store.size() == 3, "read-only store unchanged");
+    }
+
+    // index files are kept up to date and used by read-only stores
+    {
+      std::string indexFile = (std::string)storeFile + ".idx";
+      writeFile("");
+      {
+        SortedSMSStore store((std::string)storeFile);
+        for (int i = 0; i < 12; ++i)
+          store.insert(deliver(stringPrintf("+4917%d", i % 4), 1 + i % 5,
+                               stringPrintf("m%d", i)));
+        store.setIndexed(true);
+      }
+      check(SMSStoreIndex::exists(storeFile), "index written");
+      {
+        SortedSMSStore store((std::string)storeFile);
+        check(store.indexed() && ! store.index().isnull(), "index valid");
+        store.setSortOrder(ByIndex);
+        store.erase(store.begin());
+        store.insert(deliver("+4917", 3, "new"));
+        store.insert(deliver("0177", 9, "last"));
+        store.sync();
+        check(! store.index().isnull() && store.index()->size() == 13,
+              "index updated");
+      }
+      std::string order;
+      {
+        SortedSMSStore store((std::string)storeFile);
+        order = dateOrder(store);
+      }
+      {
+        SortedSMSStore store((std::string)storeFile, true);
+        SMSStoreIndexRef index = store.index();
+        check(! index.isnull(), "read-only store uses index");
+        check(dateOrder(store) == order, "date order from index");
+        std::cout << "indexed:" << order << std::endl;
+
+        // lookups in the index find the same messages as the store
+        for (int day = 0; day <= 10; ++day)
+        {
+          Timestamp timestamp = store.begin()->message()->
+            serviceCentreTimestamp();
+          timestamp._day = day;
+          std::pair<SortedSMSStore::iterator, SortedSMSStore::iterator> r =
+            store.equal_range(timestamp);
+          unsigned long n = 0;
+          for (; r.first != r.second; ++r.first)
+            ++n;
+          check(index->upperBound(timestamp) - index->lowerBound(timestamp)
+                == n, stringPrintf("index lookup of day %d", day));
+        }
+        store.setSortOrder(ByAddress);
+        const char *numbers[] = {"+4917", "+49170", "+49173", "+49174",
+                                 "0177"};
+        for (unsigned int i = 0; i < sizeof(numbers) / sizeof(numbers[0]);
+             ++i)
+        {
+          Address address(numbers[i]);
+          check(index->upperBound(address) - index->lowerBound(address) ==
+                store.count(address),
+                stringPrintf("index lookup of %s", numbers[i]));
+        }
+        unsigned long first = index->lowerBound(Address("+49172"));
+        check(first < index->size() &&
+              readFile()[index->addressOffset(first)] == 'I',
+              "offset of insert record");
+      }
+
+      // an index that does not match the store file is ignored and
+      // rewritten on the next change
+      std::string file = readFile();
+      writeFile(file.substr(0, file.length() - 3));
+      {
+        SortedSMSStore store((std::string)storeFile, true);
+        check(store.index().isnull() && store.size() == 12, "stale index");
+      }
+      {
+        SortedSMSStore store((std::string)storeFile);
+        check(store.indexed() && store.index().isnull(),
+              "stale index in writable store");
+        store.insert(deliver("+49171", 2, "again"));
+      }
+      {
+        SortedSMSStore store((std::string)storeFile, true);
+        check(! store.index().isnull() && store.size() == 13,
+              "index rewritten");
+      }
+      {
+        SortedSMSStore store((std::string)storeFile);
+        store.setIndexed(false);
+      }
+      check(! SMSStoreIndex::exists(storeFile), "index removed");
+    }
+
+    // flat maps behave like trees
+    {
+      SortedSMSStore store((std::string)storeFile);
+      check(! store.flat(), "writable store is not flat");
+      std::string order = dateOrder(store);
+      store.setSortOrder(ByAddress);
+      store.setSortOrder(ByDate);
+      store.setFlat(true);
+      check(dateOrder(store) == order, "flat date order");
+      store.setSortOrder(ByAddress);
+      Address address("+49171");
+      SortedSMSStore::size_type n = store.count(address);
+      store.insert(deliver("+49171", 4, "flat"));
+      store.insert(deliver("+49179", 4, "flat"));
+      check(store.count(address) == n + 1, "flat insert");
+      check(store.erase(address) == n + 1 && store.count(address) == 0,
+            "flat erase");
+      store.setSortOrder(ByDate);
+      unsigned int size = 0;
+      for (SortedSMSStore::iterator i = store.begin(); i != store.end(); ++i)
+        ++size;
+      check(size == (unsigned int)store.size() && size == 13 - n + 1,
+            "kept flat map updated");
+      order = dateOrder(store);
+      store.setFlat(false);
+      check(dateOrder(store) == order, "tree date order");
+    }
+
+    // entries assigned to are found after switching back to a sort
+    // order used before
+    {
+      SortedSMSStore store((std::string)storeFile);
+      store.setSortOrder(ByAddress);
+      store.setSortOrder(ByDate);
+      *store.begin() = deliver("+49999", 1, "assigned");
+      store.setSortOrder(ByAddress);
+      Address address("+49999");
+      check(store.count(address) == 1, "assigned entry found");
+    }
+
+    // assignments are journalled under the index of the entry
+    writeFile("");
+    {
+      SortedSMSStore store((std::string)storeFile);
+      store.insert(entry("zero"));
+      store.insert(entry("one"));
+      store.insert(entry("two"));
+    }
+    {
+      SortedSMSStore store((std::string)storeFile);
+      store.setSortOrder(ByIndex);
+      SortedSMSStore::iterator last = store.begin();
+      ++++last;
+      *last = entry("second");
+      check(last->index() == 2, "assignment keeps index");
+      std::string::size_type length = readFile().length();
+      store.sync();
+      check(readFile().length() > length, "assignment appended");
+      std::cout << "after assignment: " << messages() << std::endl;
+      store.erase(last);
+      store.sync();
+      std::cout << "after erasing assigned: " << messages() << std::endl;
+
+      // assigned and erased before syncing
+      *store.begin() = entry("first");
+      store.erase(store.begin());
+      store.sync();
+      std::cout << "after assigning and erasing: " << messages()
+                << std::endl;
+    }
+
+    check(crc32("123456789", 9) == 0xcbf43926UL &&
+          crc32("56789", 5, crc32("1234", 4)) == 0xcbf43926UL, "crc32");
+  }
+  catch (GsmException &ge)
+  {
+    std::cerr << "GsmException '" << ge.what() << "'" << std::endl;
+    return 1;
+  }
+  remove(storeFile);
+  return checkResult();
+}
@@ -0,0 +1,182 @@
+// *************************************************************************
+// * GSM TA/ME library
+// *
+// * File:    testsmsview.cc
+// *
+// * Purpose: Test SMSMessageView against fully decoded SMS messages
+// *
+// * Created: 18.10.2026
+// *************************************************************************
+
+#ifdef HAVE_CONFIG_H
+#include <gsm_config.h>
+#endif
+#include <gsmlib/gsm_sms.h>
+#include <gsmlib/gsm_sorted_sms_store.h>
+#include <iostream>
+#include <vector>
+#include "testcheck.h"
+
+using namespace gsmlib;
+
+// compare view of pdu with decoded message
+static void compare(std::string pdu, bool SCtoMEdirection)
+{
+  SMSMessageRef sms = SMSMessage::decode(pdu, SCtoMEdirection);
+  SMSMessageViewRef view = new SMSMessageView(pdu, SCtoMEdirection);
+
+  Timestamp t = view->serviceCentreTimestamp();
+  std::cout << "type " << view->messageType()
+            << " address '" << view->address()._number << "' timestamp "
+            << stringPrintf("%02d-%02d-%02d %02d:%02d:%02d", t._year,
+                            t._month, t._day, t._hour, t._minute,
+                            t._seconds)
+            << std::endl;
+  check(view->messageType() == sms->messageType(), "messageType");
+  check(view->serviceCentreAddress() == sms->serviceCentreAddress(),
+        "serviceCentreAddress");
+  check(view->serviceCentreTimestamp() == sms->serviceCentreTimestamp(),
+        "serviceCentreTimestamp");
+  if (sms->messageType() != SMSMessage::SMS_DELIVER_REPORT &&
+      sms->messageType() != SMSMessage::SMS_SUBMIT_REPORT)
+    check(view->address() == sms->address(), "address");
+  check(view->pdu() == pdu, "pdu");
+
+  // decoded message is created once
+  check(view->message() == view->message(), "message cached");
+  check(view->toString() == sms->toString(), "toString");
+  check(view->message()->encode() == sms->encode(), "encode");
+}
+
+int main(int argc, char *argv[])
+{
+  try
+  {
+    // received messages
+    compare("079194710167120004038571F1390099406180904480A0D41631067296EF7390383D07CD622E58CD95CB81D6EF39BDEC66BFE7207A794E2FBB4320AFB82C07E56020A8FC7D9687DBED32285C9F83A06F769A9E5EB340D7B49C3E1FA3C3663A0B24E4CBE76516680A7FCBE920725A5E5ED341F0B21C346D4E41E1BA790E4286DDE4BC0BD42CA3E5207258EE1797E5A0BA9B5E9683C86539685997EBEF61341B249BC966", true);
+    compare("0791947101671200040B851008050001F23900892171410155409FCEF4184D07D9CBF273793E2FBB432062BA0CC2D2E5E16B398D7687C768FADC5E96B3DFF3BAFB0C62EFEB663AC8FD1EA341E2F41CA4AFB741329A2B2673819C75BABEEC064DD36590BA4CD7D34149B4BC0C3A96EF69B77B8C0EBBC76550DD4D0699C3F8B21B344D974149B4BCEC0651CB69B6DBD53AD6E9F331BA9C7683C26E102C8683BD6A30180C04ABD900", true);
+
+    // all message types
+    SMSSubmitMessage *submit = new SMSSubmitMessage("view test", "+491234567");
+    SMSMessageRef sms = submit;
+    TimePeriod::Format relative = TimePeriod::Relative;
+    submit->setValidityPeriodFormat(relative);
+    compare(sms->encode(), false);
+    sms = new SMSDeliverReportMessage();
+    compare(sms->encode(), false);
+    sms = new SMSCommandMessage();
+    compare(sms->encode(), false);
+    sms = new SMSStatusReportMessage();
+    compare(sms->encode(), true);
+    sms = new SMSSubmitReportMessage();
+    compare(sms->encode(), true);
+
+    // views in an arena with small blocks, reused after clear()
+    {
+      std::vector<std::string> pdus;
+      pdus.push_back(SMSDeliverMessage().encode());
+      pdus.push_back(SMSStatusReportMessage().encode());
+      pdus.push_back(SMSSubmitReportMessage().encode());
+      pdus.push_back("0791947101671200040B851008050001F23900892171410155409FCEF4184D07D9CBF273793E2FBB432062BA0CC2D2E5E16B398D7687C768FADC5E96B3DFF3BAFB0C62EFEB663AC8FD1EA341E2F41CA4AFB741329A2B2673819C75BABEEC064DD36590BA4CD7D34149B4BC0C3A96EF69B77B8C0EBBC76550DD4D0699C3F8B21B344D974149B4BCEC0651CB69B6DBD53AD6E9F331BA9C7683C26E102C8683BD6A30180C04ABD900");
+      SMSDecodeArena arena(256);
+      for (int round = 0; round < 2; ++round)
+      {
+        for (int i = 0; i < 50; ++i)
+          arena.add(pdus[i % pdus.size()]);
+        bool same = arena.size() == 50;
+        for (unsigned int i = 0; i < arena.size(); ++i)
+        {
+          SMSMessageRef sms = SMSMessage::decode(pdus[i % pdus.size()]);
+          same = same && arena[i].pdu() == pdus[i % pdus.size()] &&
+            arena[i].serviceCentreTimestamp() ==
+            sms->serviceCentreTimestamp() &&
+            arena[i].toString() == sms->toString();
+        }
+        check(same, stringPrintf("arena round %d", round));
+        check(arena.blocks() > 1, "arena blocks");
+        arena.clear();
+        check(arena.size() == 0 && arena.blocks() == 1, "arena clear");
+      }
+      try
+      {
+        arena.add("07919");
+        check(false, "arena odd length pdu");
+      }
+      catch (GsmException &e)
+      {
+        std::cout << "arena odd length pdu: " << e.what() << std::endl;
+      }
+    }
+
+    // batch decoding in several threads keeps order and reports errors
+    {
+      std::vector<SMSBatchPdu> pdus;
+      for (int i = 0; i < 1000; ++i)
+        switch (i % 5)
+        {
+        case 0:
+          pdus.push_back(SMSBatchPdu(SMSDeliverMessage().encode()));
+          break;
+        case 1:
+        {
+          SMSSubmitMessage submit(stringPrintf("message %d", i), "12345");
+          pdus.push_back(SMSBatchPdu(submit.encode(), false));
+          break;
+        }
+        case 2:
+          pdus.push_back(SMSBatchPdu(SMSStatusReportMessage().encode()));
+          break;
+        case 3:
+          pdus.push_back(SMSBatchPdu("0791XX"));
+          break;
+        case 4:
+          pdus.push_back(SMSBatchPdu("0000", true));
+          break;
+        }
+
+      unsigned int threads[] = {1, 4, 0};
+      for (unsigned int t = 0; t < 3; ++t)
+      {
+        std::vector<SMSDecodeResult> results;
+        decodeSMSBatch(pdus, results, threads[t]);
+        bool same = results.size() == pdus.size();
+        for (unsigned int i = 0; same && i < results.size(); ++i)
+          if (i % 5 < 3)
+            same = results[i].ok() &&
+              results[i]._message->encode() == pdus[i]._pdu;
+          else
+            same = ! results[i].ok() &&
+              results[i]._errorClass == SMSFormatError;
+        check(same, stringPrintf("decodeSMSBatch threads %d", threads[t]));
+        if (t == 0)
+          std::cout << "batch errors: " << results[3]._error << ", "
+                    << results[4]._error << std::endl;
+      }
+    }
+
+    // binary pdu
+    std::string pdu = SMSDeliverMessage().encode();
+    unsigned char buf[200];
+    hexToBuf(pdu, buf);
+    SMSMessageView view(buf, pdu.length() / 2);
+    check(view.pdu() == pdu, "binary pdu");
+
+    // malformed pdus are rejected on first access
+    SMSMessageView truncated(buf, 10);
+    try
+    {
+      truncated.serviceCentreTimestamp();
+      check(false, "truncated pdu");
+    }
+    catch (GsmException &e)
+    {
+      std::cout << "truncated pdu: " << e.what() << std::endl;
+    }
+  }
+  catch (GsmException &ge)
+  {
+    std::cerr << "GsmException '" << ge.what() << "'" << std::endl;
+    return 1;
+  }
+  return checkResult();
+}
@@ -4,6 +4,8 @@
 #include <gsmlib/gsm_sorted_phonebook.h>
 #include <algorithm>
 #include <iostream>
+#include <fstream>
+#include <cstdio>
 
 void printPb(gsmlib::PhonebookEntry &e)
 {
@@ -11,6 +13,14 @@ void printPb(gsmlib::PhonebookEntry &e)
 	    << " text: " << e.text() << std::endl;
 }
 
+void printFile(const char *filename)
+{
+  std::ifstream is(filename);
+  std::string line;
+  while (getline(is, line))
+    std::cout << "  " << line << std::endl;
+}
+
 int main(int argc, char *argv[])
 {
   try
@@ -60,10 +70,99 @@ int main(int argc, char *argv[])
     
     pb.erase(range.first, range.second);
 
+    // the map of a sort order used before reflects the changes
+    pb.setSortOrder(gsmlib::ByTelephone);
+    std::cout << "Entries in pbs-copy.pb<4>:" << std::endl;
+    for (gsmlib::SortedPhonebook::iterator i = pb.begin(); i != pb.end(); ++i)
+      std::cout << "  Text: " << i->text()
+		<< "  Telephone: " << i->telephone() << std::endl;
+    pb.setSortOrder(gsmlib::ByText);
+
     // write back to file
     std::cout << "Writing back to file" << std::endl;
     pb.sync();
 
+    // lines are not truncated, errors in indexed files are reported
+    {
+      std::ofstream os("spb-long.pb");
+      os << "2|" << std::string(2000, 'x') << "|0815\n\n1|\\|short|12\n";
+    }
+    {
+      gsmlib::SortedPhonebook longPb(std::string("spb-long.pb"), true);
+      for (gsmlib::SortedPhonebook::iterator i = longPb.begin();
+           i != longPb.end(); ++i)
+        std::cout << "  Index: " << i->index() << "  Text length: "
+                  << i->text().length() << std::endl;
+    }
+    const char *badFiles[] = {"1|a|1\n|b|2\n", "1|a|1\n1|b|2\n",
+                              "x|a|1\n", "1|a\n"};
+    for (unsigned int i = 0; i < 4; ++i)
+    {
+      {
+        std::ofstream os("spb-long.pb");
+        os << badFiles[i];
+      }
+      try
+      {
+        gsmlib::SortedPhonebook badPb(std::string("spb-long.pb"), false);
+        std::cout << "no error" << std::endl;
+      }
+      catch (gsmlib::GsmException &ge)
+      {
+        std::cout << ge.what() << std::endl;
+      }
+    }
+
+    // in incremental mode inserted entries are appended
+    {
+      std::ofstream os("spb-long.pb");
+      os << "|b|2\n|a|1\n";
+    }
+    {
+      gsmlib::SortedPhonebook incPb(std::string("spb-long.pb"), false);
+      incPb.setIncremental(true);
+      incPb.insert(gsmlib::PhonebookEntryBase("3", "c|new"));
+      incPb.insert(gsmlib::PhonebookEntryBase("0", "aa"));
+      incPb.sync();
+      std::cout << "After appending:" << std::endl;
+      printFile("spb-long.pb");
+      incPb.setSortOrder(gsmlib::ByText);
+      s = "b";
+      incPb.erase(s);
+      incPb.sync();
+      std::cout << "After erasing:" << std::endl;
+      printFile("spb-long.pb");
+    }
+
+    // entries changed in place are found after switching back to a sort
+    // order used before, also after a sync()
+    {
+      std::ofstream os("spb-long.pb");
+      os << "|alice|111\n|bob|222\n";
+    }
+    {
+      gsmlib::SortedPhonebook editPb(std::string("spb-long.pb"), false);
+      editPb.setSortOrder(gsmlib::ByText);
+      editPb.setSortOrder(gsmlib::ByTelephone);
+      s = "222";
+      editPb.find(s)->set("222", "aaron");
+      editPb.setSortOrder(gsmlib::ByText);
+      s = "aaron";
+      std::cout << "Found aaron: " << (editPb.find(s) != editPb.end())
+                << std::endl;
+      editPb.setSortOrder(gsmlib::ByTelephone);
+      s = "111";
+      editPb.find(s)->set("333", "alice");
+      editPb.sync();
+      editPb.setSortOrder(gsmlib::ByText);
+      editPb.setSortOrder(gsmlib::ByTelephone);
+      s = "333";
+      std::cout << "Found 333: " << (editPb.find(s) != editPb.end())
+                << std::endl;
+    }
+    remove("spb-long.pb");
+    remove("spb-long.pb~");
+
     // tests the NoCopy class
     //SortedPhonebook pb2("spb.pb");
     //pb2 = pb;
@@ -85,10 +85,18 @@ LIB32=link.exe -lib
 # PROP Default_Filter "cpp;cc;c;cxx;rc;def;r;odl;idl;hpj;bat"
 # Begin Source File
 
+SOURCE=..\gsmlib\gsm_alphabet.cc
+# End Source File
+# Begin Source File
+
 SOURCE=..\gsmlib\gsm_at.cc
 # End Source File
 # Begin Source File
 
+SOURCE=..\gsmlib\gsm_cb_aggregator.cc
+# End Source File
+# Begin Source File
+
 SOURCE=..\gsmlib\gsm_error.cc
 # End Source File
 # Begin Source File
@@ -125,10 +133,18 @@ SOURCE=..\gsmlib\gsm_sms_codec.cc
 # End Source File
 # Begin Source File
 
+SOURCE=..\gsmlib\gsm_sms_reassembly.cc
+# End Source File
+# Begin Source File
+
 SOURCE=..\gsmlib\gsm_sms_store.cc
 # End Source File
 # Begin Source File
 
+SOURCE=..\gsmlib\gsm_sms_store_index.cc
+# End Source File
+# Begin Source File
+
 SOURCE=..\gsmlib\gsm_sorted_phonebook.cc
 # End Source File
 # Begin Source File
@@ -153,6 +169,10 @@ SOURCE=..\gsmlib\gsm_win32_serial.cc
 # PROP Default_Filter "h;hpp;hxx;hm;inl"
 # Begin Source File
 
+SOURCE=..\gsmlib\gsm_alphabet.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\gsmlib\gsm_at.h
 # End Source File
 # Begin Source File
@@ -161,6 +181,10 @@ SOURCE=..\gsmlib\gsm_cb.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\gsmlib\gsm_cb_aggregator.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\gsmlib\gsm_error.h
 # End Source File
 # Begin Source File
@@ -201,10 +225,22 @@ SOURCE=..\gsmlib\gsm_sms_codec.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\gsmlib\gsm_sms_reassembly.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\gsmlib\gsm_sms_store.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\gsmlib\gsm_sms_store_index.h
+# End Source File
+# Begin Source File
+
+SOURCE=..\gsmlib\gsm_sorted_multimap.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\gsmlib\gsm_sorted_phonebook.h
 # End Source File
 # Begin Source File